@@ -0,0 +1,404 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "BoundingVolumes.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+    #define BOUNDING_VOLUMES_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define BOUNDING_VOLUMES_SSE2 0
+#endif
+
+namespace SampleFramework11
+{
+
+static const float* Position(const float* positions, uint32_t vertexStride, size_t idx)
+{
+    return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + idx * vertexStride);
+}
+
+static float DistanceSq(const float* a, const float* b)
+{
+    const float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// The bounding box, and the first vertex with the smallest and largest position on each axis
+struct VertexExtents
+{
+    BoundingBox Box;
+    uint32_t MinVertex[3];
+    uint32_t MaxVertex[3];
+};
+
+#if BOUNDING_VOLUMES_SSE2
+
+static __m128i Select(__m128 mask, __m128i a, __m128i b)
+{
+    const __m128i maskBits = _mm_castps_si128(mask);
+    return _mm_or_si128(_mm_and_si128(maskBits, a), _mm_andnot_si128(maskBits, b));
+}
+
+// Does all three axes at once. Loading a whole __m128 reads 4 bytes past the position,
+// which is only safe when it's still inside the vertex or the next vertex is in the range.
+static void FindExtents(const float* positions, uint32_t vertexStride, const VertexRange& range,
+                       VertexExtents& extents)
+{
+    const uint32_t end = range.VertexStart + range.VertexCount;
+    const uint32_t lastWideLoad = vertexStride >= 16 ? end : end - 1;
+
+    const float* first = Position(positions, vertexStride, range.VertexStart);
+    __m128 minPos = _mm_set_ps(0.0f, first[2], first[1], first[0]);
+    __m128 maxPos = minPos;
+    __m128i minVertex = _mm_set1_epi32(int32_t(range.VertexStart));
+    __m128i maxVertex = minVertex;
+
+    for (uint32_t v = range.VertexStart + 1; v < end; ++v)
+    {
+        const float* p = Position(positions, vertexStride, v);
+        const __m128 pos = v < lastWideLoad ? _mm_loadu_ps(p) : _mm_set_ps(0.0f, p[2], p[1], p[0]);
+        const __m128i vertex = _mm_set1_epi32(int32_t(v));
+
+        minVertex = Select(_mm_cmplt_ps(pos, minPos), vertex, minVertex);
+        maxVertex = Select(_mm_cmpgt_ps(pos, maxPos), vertex, maxVertex);
+        minPos = _mm_min_ps(minPos, pos);
+        maxPos = _mm_max_ps(maxPos, pos);
+    }
+
+    float minValues[4];
+    float maxValues[4];
+    uint32_t minVertices[4];
+    uint32_t maxVertices[4];
+    _mm_storeu_ps(minValues, minPos);
+    _mm_storeu_ps(maxValues, maxPos);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(minVertices), minVertex);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maxVertices), maxVertex);
+
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        extents.Box.Min[i] = minValues[i];
+        extents.Box.Max[i] = maxValues[i];
+        extents.MinVertex[i] = minVertices[i];
+        extents.MaxVertex[i] = maxVertices[i];
+    }
+}
+
+#else
+
+static void FindExtents(const float* positions, uint32_t vertexStride, const VertexRange& range,
+                       VertexExtents& extents)
+{
+    const float* first = Position(positions, vertexStride, range.VertexStart);
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        extents.Box.Min[i] = extents.Box.Max[i] = first[i];
+        extents.MinVertex[i] = extents.MaxVertex[i] = range.VertexStart;
+    }
+
+    const uint32_t end = range.VertexStart + range.VertexCount;
+    for (uint32_t v = range.VertexStart + 1; v < end; ++v)
+    {
+        const float* p = Position(positions, vertexStride, v);
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            if (p[i] < extents.Box.Min[i])
+            {
+                extents.Box.Min[i] = p[i];
+                extents.MinVertex[i] = v;
+            }
+
+            if (p[i] > extents.Box.Max[i])
+            {
+                extents.Box.Max[i] = p[i];
+                extents.MaxVertex[i] = v;
+            }
+        }
+    }
+}
+
+#endif
+
+// Ritter's algorithm: start with the pair of extreme points that are furthest apart, and
+// then grow the sphere just enough to take in every vertex that's outside of it
+static BoundingSphere RitterSphere(const float* positions, uint32_t vertexStride, const VertexRange& range,
+                                   const VertexExtents& extents)
+{
+    uint32_t axis = 0;
+    float maxDistanceSq = -1.0f;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const float distanceSq = DistanceSq(Position(positions, vertexStride, extents.MinVertex[i]),
+                                            Position(positions, vertexStride, extents.MaxVertex[i]));
+        if (distanceSq > maxDistanceSq)
+        {
+            maxDistanceSq = distanceSq;
+            axis = i;
+        }
+    }
+
+    const float* a = Position(positions, vertexStride, extents.MinVertex[axis]);
+    const float* b = Position(positions, vertexStride, extents.MaxVertex[axis]);
+    BoundingSphere sphere;
+    for (uint32_t i = 0; i < 3; ++i)
+        sphere.Center[i] = (a[i] + b[i]) * 0.5f;
+    sphere.Radius = std::sqrt(maxDistanceSq) * 0.5f;
+
+    const uint32_t end = range.VertexStart + range.VertexCount;
+    for (uint32_t v = range.VertexStart; v < end; ++v)
+    {
+        const float* p = Position(positions, vertexStride, v);
+        const float distanceSq = DistanceSq(p, sphere.Center);
+        if (distanceSq <= sphere.Radius * sphere.Radius)
+            continue;
+
+        // Move the center towards the point, so that the far side of the sphere stays put
+        const float distance = std::sqrt(distanceSq);
+        const float newRadius = (sphere.Radius + distance) * 0.5f;
+        const float shift = (newRadius - sphere.Radius) / distance;
+        for (uint32_t i = 0; i < 3; ++i)
+            sphere.Center[i] += (p[i] - sphere.Center[i]) * shift;
+        sphere.Radius = std::max(newRadius, std::sqrt(DistanceSq(p, sphere.Center)));
+    }
+
+    return sphere;
+}
+
+// Welzl's algorithm works in doubles, since the spheres through 3 and 4 points are
+// sensitive to precision
+struct Double3
+{
+    double x, y, z;
+
+    Double3() {}
+    Double3(double x_, double y_, double z_) : x(x_), y(y_), z(z_) {}
+
+    Double3 operator+(const Double3& v) const { return Double3(x + v.x, y + v.y, z + v.z); }
+    Double3 operator-(const Double3& v) const { return Double3(x - v.x, y - v.y, z - v.z); }
+    Double3 operator*(double s) const { return Double3(x * s, y * s, z * s); }
+};
+
+static double Dot(const Double3& a, const Double3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static Double3 Cross(const Double3& a, const Double3& b)
+{
+    return Double3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+struct ExactSphere
+{
+    Double3 Center;
+    double RadiusSq;
+};
+
+// Points that are a tiny bit outside still count as inside, so that rounding errors
+// can't make the algorithm keep rebuilding the same sphere
+static bool Contains(const ExactSphere& sphere, const Double3& p)
+{
+    const Double3 delta = p - sphere.Center;
+    return Dot(delta, delta) <= sphere.RadiusSq * (1.0 + 1e-10) + 1e-30;
+}
+
+static ExactSphere SphereFromPoints(const Double3& a, const Double3& b)
+{
+    ExactSphere sphere;
+    sphere.Center = (a + b) * 0.5;
+    const Double3 delta = b - a;
+    sphere.RadiusSq = Dot(delta, delta) * 0.25;
+    return sphere;
+}
+
+// The smallest sphere with all three points on its surface, which is centered on their circumcircle
+static ExactSphere SphereFromPoints(const Double3& a, const Double3& b, const Double3& c)
+{
+    const Double3 u = b - a;
+    const Double3 v = c - a;
+    const Double3 n = Cross(u, v);
+    const double nLengthSq = Dot(n, n);
+    if (nLengthSq <= 1e-24 * Dot(u, u) * Dot(v, v))
+    {
+        // The points are in a line, so the two furthest apart define the sphere
+        ExactSphere spheres[3] = { SphereFromPoints(a, b), SphereFromPoints(a, c), SphereFromPoints(b, c) };
+        ExactSphere* largest = std::max_element(spheres, spheres + 3, [](const ExactSphere& s0, const ExactSphere& s1)
+        {
+            return s0.RadiusSq < s1.RadiusSq;
+        });
+        return *largest;
+    }
+
+    const Double3 offset = Cross(v * Dot(u, u) - u * Dot(v, v), n) * (0.5 / nLengthSq);
+    ExactSphere sphere;
+    sphere.Center = a + offset;
+    sphere.RadiusSq = Dot(offset, offset);
+    return sphere;
+}
+
+static ExactSphere SphereFromPoints(const Double3& a, const Double3& b, const Double3& c, const Double3& d)
+{
+    const Double3 u = b - a;
+    const Double3 v = c - a;
+    const Double3 w = d - a;
+    const double det = Dot(u, Cross(v, w));
+    const double scale = std::sqrt(Dot(u, u) * Dot(v, v) * Dot(w, w));
+    if (std::abs(det) <= 1e-12 * scale)
+    {
+        // The points are in a plane, so the smallest sphere through three of them that
+        // also contains the fourth will do
+        const Double3 points[4] = { a, b, c, d };
+        ExactSphere best;
+        best.RadiusSq = -1.0;
+        for (uint32_t skip = 0; skip < 4; ++skip)
+        {
+            const Double3& p0 = points[skip == 0 ? 1 : 0];
+            const Double3& p1 = points[skip <= 1 ? 2 : 1];
+            const Double3& p2 = points[skip <= 2 ? 3 : 2];
+            const ExactSphere sphere = SphereFromPoints(p0, p1, p2);
+            if (Contains(sphere, points[skip]) && (best.RadiusSq < 0.0 || sphere.RadiusSq < best.RadiusSq))
+                best = sphere;
+        }
+
+        return best.RadiusSq >= 0.0 ? best : SphereFromPoints(a, b, c);
+    }
+
+    const Double3 offset = (Cross(v, w) * Dot(u, u) + Cross(w, u) * Dot(v, v) + Cross(u, v) * Dot(w, w)) * (0.5 / det);
+    ExactSphere sphere;
+    sphere.Center = a + offset;
+    sphere.RadiusSq = Dot(offset, offset);
+    return sphere;
+}
+
+// The incremental form of Welzl's algorithm, where each nested loop finds the smallest
+// sphere with one more point fixed on its surface. It takes expected linear time as long
+// as the points are in a random order, which comes from a fixed seed so that the results
+// are always the same.
+static BoundingSphere WelzlSphere(const float* positions, uint32_t vertexStride, const VertexRange& range)
+{
+    std::vector<Double3> points(range.VertexCount);
+    for (uint32_t i = 0; i < range.VertexCount; ++i)
+    {
+        const float* p = Position(positions, vertexStride, range.VertexStart + i);
+        points[i] = Double3(p[0], p[1], p[2]);
+    }
+
+    uint32_t random = 12345;
+    for (uint32_t i = range.VertexCount - 1; i > 0; --i)
+    {
+        random = random * 1664525u + 1013904223u;
+        std::swap(points[i], points[(random >> 8) % (i + 1)]);
+    }
+
+    ExactSphere sphere = SphereFromPoints(points[0], points[0]);
+    for (uint32_t i = 1; i < range.VertexCount; ++i)
+    {
+        if (Contains(sphere, points[i]))
+            continue;
+
+        sphere = SphereFromPoints(points[i], points[i]);
+        for (uint32_t j = 0; j < i; ++j)
+        {
+            if (Contains(sphere, points[j]))
+                continue;
+
+            sphere = SphereFromPoints(points[i], points[j]);
+            for (uint32_t k = 0; k < j; ++k)
+            {
+                if (Contains(sphere, points[k]))
+                    continue;
+
+                sphere = SphereFromPoints(points[i], points[j], points[k]);
+                for (uint32_t l = 0; l < k; ++l)
+                {
+                    if (!Contains(sphere, points[l]))
+                        sphere = SphereFromPoints(points[i], points[j], points[k], points[l]);
+                }
+            }
+        }
+    }
+
+    // Measure the radius from the rounded center, so that every vertex is really inside
+    BoundingSphere result;
+    result.Center[0] = float(sphere.Center.x);
+    result.Center[1] = float(sphere.Center.y);
+    result.Center[2] = float(sphere.Center.z);
+    float radiusSq = 0.0f;
+    const uint32_t end = range.VertexStart + range.VertexCount;
+    for (uint32_t v = range.VertexStart; v < end; ++v)
+        radiusSq = std::max(radiusSq, DistanceSq(Position(positions, vertexStride, v), result.Center));
+    result.Radius = std::sqrt(radiusSq);
+
+    return result;
+}
+
+void ComputeBoundingVolumes(const float* positions, uint32_t vertexStride, const VertexRange* ranges,
+                            size_t numRanges, bool exactSpheres, BoundingBox* boxes, BoundingSphere* spheres)
+{
+    ParallelFor(0, numRanges, [&](size_t rangeIdx)
+    {
+        const VertexRange& range = ranges[rangeIdx];
+        if (range.VertexCount == 0)
+        {
+            memset(&boxes[rangeIdx], 0, sizeof(BoundingBox));
+            memset(&spheres[rangeIdx], 0, sizeof(BoundingSphere));
+            return;
+        }
+
+        VertexExtents extents;
+        FindExtents(positions, vertexStride, range, extents);
+        boxes[rangeIdx] = extents.Box;
+
+        BoundingSphere sphere = RitterSphere(positions, vertexStride, range, extents);
+        if (exactSpheres)
+        {
+            const BoundingSphere exactSphere = WelzlSphere(positions, vertexStride, range);
+            if (exactSphere.Radius < sphere.Radius)
+                sphere = exactSphere;
+        }
+        spheres[rangeIdx] = sphere;
+    });
+}
+
+BoundingBox MergeBoundingBoxes(const BoundingBox& a, const BoundingBox& b)
+{
+    BoundingBox box;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        box.Min[i] = std::min(a.Min[i], b.Min[i]);
+        box.Max[i] = std::max(a.Max[i], b.Max[i]);
+    }
+
+    return box;
+}
+
+BoundingSphere MergeBoundingSpheres(const BoundingSphere& a, const BoundingSphere& b)
+{
+    const float distance = std::sqrt(DistanceSq(a.Center, b.Center));
+    if (distance + b.Radius <= a.Radius)
+        return a;
+    if (distance + a.Radius <= b.Radius)
+        return b;
+
+    BoundingSphere sphere;
+    sphere.Radius = (distance + a.Radius + b.Radius) * 0.5f;
+    const float shift = (sphere.Radius - a.Radius) / distance;
+    for (uint32_t i = 0; i < 3; ++i)
+        sphere.Center[i] = a.Center[i] + (b.Center[i] - a.Center[i]) * shift;
+
+    return sphere;
+}
+
+}
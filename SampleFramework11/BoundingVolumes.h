@@ -0,0 +1,54 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+// This header doesn't use the precompiled header, so that it can be shared by
+// the code that also builds outside of Windows
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SampleFramework11
+{
+
+struct BoundingBox
+{
+    float Min[3];
+    float Max[3];
+};
+
+struct BoundingSphere
+{
+    float Center[3];
+    float Radius;
+};
+
+// A range of vertices that's bounded on its own, like the vertices used by a MeshPart
+struct VertexRange
+{
+    uint32_t VertexStart;
+    uint32_t VertexCount;
+};
+
+// Computes a bounding box and sphere for each range of vertices, with the ranges processed
+// in parallel. Positions are 3 floats at the start of each vertexStride bytes. The box and
+// the extreme points along each axis are found together in one pass, which uses SSE2 when
+// it's available. The extreme points seed the sphere from Jack Ritter's "An Efficient
+// Bounding Sphere", which is grown in a second pass to take in the rest of the vertices.
+// If exactSpheres is true the sphere is then replaced with the minimal bounding sphere
+// from Emo Welzl's algorithm, which is slower but can be noticeably tighter.
+void ComputeBoundingVolumes(const float* positions, uint32_t vertexStride, const VertexRange* ranges,
+                            size_t numRanges, bool exactSpheres, BoundingBox* boxes, BoundingSphere* spheres);
+
+// Returns the smallest box or sphere that contains both a and b
+BoundingBox MergeBoundingBoxes(const BoundingBox& a, const BoundingBox& b);
+BoundingSphere MergeBoundingSpheres(const BoundingSphere& a, const BoundingSphere& b);
+
+}
@@ -0,0 +1,109 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "DistanceField.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace SampleFramework11
+{
+
+static const float Infinity = 1e20f;
+
+// Computes the squared distance from each sample to the nearest feature, where f holds
+// 0 for features and Infinity everywhere else. This finds the lower envelope of the
+// parabolas rooted at each sample, then reads off the envelope.
+static void DistanceTransform1D(const float* f, uint32_t n, float* d, int* v, float* z)
+{
+    int k = 0;
+    v[0] = 0;
+    z[0] = -Infinity;
+    z[1] = Infinity;
+    for (int q = 1; q < static_cast<int>(n); ++q)
+    {
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+        while (s <= z[k])
+        {
+            --k;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+        }
+
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = Infinity;
+    }
+
+    k = 0;
+    for (int q = 0; q < static_cast<int>(n); ++q)
+    {
+        while (z[k + 1] < q)
+            ++k;
+        float dq = static_cast<float>(q - v[k]);
+        d[q] = dq * dq + f[v[k]];
+    }
+}
+
+// Replaces each entry, which is 0 for features and Infinity everywhere else, with
+// the squared distance to the nearest feature
+static void DistanceTransform2D(std::vector<float>& grid, uint32_t width, uint32_t height)
+{
+    uint32_t maxDim = std::max(width, height);
+    std::vector<float> f(maxDim);
+    std::vector<float> d(maxDim);
+    std::vector<int> v(maxDim);
+    std::vector<float> z(maxDim + 1);
+
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        for (uint32_t y = 0; y < height; ++y)
+            f[y] = grid[y * width + x];
+        DistanceTransform1D(&f[0], height, &d[0], &v[0], &z[0]);
+        for (uint32_t y = 0; y < height; ++y)
+            grid[y * width + x] = d[y];
+    }
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        DistanceTransform1D(&grid[y * width], width, &d[0], &v[0], &z[0]);
+        std::copy(d.begin(), d.begin() + width, grid.begin() + y * width);
+    }
+}
+
+void ComputeSignedDistanceField(const uint8_t* coverage, uint32_t width, uint32_t height,
+                                uint8_t threshold, float* distances)
+{
+    if (width == 0 || height == 0)
+        return;
+
+    const uint32_t numTexels = width * height;
+    std::vector<float> toInside(numTexels);
+    std::vector<float> toOutside(numTexels);
+    for (uint32_t i = 0; i < numTexels; ++i)
+    {
+        bool inside = coverage[i] >= threshold;
+        toInside[i] = inside ? 0.0f : Infinity;
+        toOutside[i] = inside ? Infinity : 0.0f;
+    }
+
+    DistanceTransform2D(toInside, width, height);
+    DistanceTransform2D(toOutside, width, height);
+
+    // The edge lies halfway between the centers of an inside and an outside texel
+    for (uint32_t i = 0; i < numTexels; ++i)
+    {
+        if (toInside[i] > 0.0f)
+            distances[i] = std::sqrt(toInside[i]) - 0.5f;
+        else
+            distances[i] = -(std::sqrt(toOutside[i]) - 0.5f);
+    }
+}
+
+}
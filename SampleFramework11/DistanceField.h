@@ -0,0 +1,28 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+// This header doesn't use the precompiled header, so that it can be shared by
+// the code that also builds outside of Windows
+
+#include <cstdint>
+#include <vector>
+
+namespace SampleFramework11
+{
+
+// Computes the signed distance in texels from the center of each texel to the edge of
+// a shape, where texels with a coverage of at least threshold are inside the shape.
+// Distances are negative inside. This uses the exact separable Euclidean distance
+// transform from Felzenszwalb and Huttenlocher, so it's linear in the number of texels.
+void ComputeSignedDistanceField(const uint8_t* coverage, uint32_t width, uint32_t height,
+                                uint8_t threshold, float* distances);
+
+}
@@ -0,0 +1,169 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "PCH.h"
+
+#include "FontCache.h"
+#include "Utility.h"
+
+using std::wstring;
+
+namespace SampleFramework11
+{
+
+static const WCHAR* CacheDirectory = L"FontCache\\";
+
+FontCacheFile::FontCacheFile()
+    :   file(INVALID_HANDLE_VALUE),
+        mapping(NULL),
+        view(NULL)
+{
+    ZeroMemory(&data, sizeof(data));
+}
+
+FontCacheFile::~FontCacheFile()
+{
+    Close();
+}
+
+wstring FontCacheFile::GetFileName(const FontCacheKey& key)
+{
+    wstring name = key.FontName;
+    for (size_t i = 0; i < name.length(); ++i)
+        if (!iswalnum(name[i]))
+            name[i] = L'_';
+
+    wstring fileName = CacheDirectory + name + L"_" + ToString(key.FontSize) + L"_" + ToString(key.FontStyle);
+    if (key.AntiAliased)
+        fileName += L"_aa";
+    if (key.DistanceField)
+        fileName += L"_sdf";
+    return fileName + L".sfc";
+}
+
+void FontCacheFile::MakeHeader(const FontCacheKey& key, FileHeader& header)
+{
+    ZeroMemory(&header, sizeof(header));
+    header.Magic = Magic;
+    header.Version = Version;
+    wcsncpy_s(header.FontName, key.FontName.c_str(), _TRUNCATE);
+    header.FontSize = key.FontSize;
+    header.FontStyle = key.FontStyle;
+    header.AntiAliased = key.AntiAliased ? 1 : 0;
+    header.DistanceField = key.DistanceField ? 1 : 0;
+    header.NumChars = static_cast<UINT>(SpriteFont::NumChars);
+}
+
+bool FontCacheFile::Open(const FontCacheKey& key)
+{
+    Close();
+
+    wstring fileName = GetFileName(key);
+    file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < sizeof(FileHeader))
+    {
+        Close();
+        return false;
+    }
+
+    mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL)
+        view = reinterpret_cast<const BYTE*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (view == NULL)
+    {
+        Close();
+        return false;
+    }
+
+    // Make sure that the file was baked by this version, for this exact font
+    FileHeader expected;
+    MakeHeader(key, expected);
+    const FileHeader& header = *reinterpret_cast<const FileHeader*>(view);
+    if (header.Magic != expected.Magic || header.Version != expected.Version
+        || header.NumChars != expected.NumChars || header.FontSize != expected.FontSize
+        || header.FontStyle != expected.FontStyle || header.AntiAliased != expected.AntiAliased
+        || header.DistanceField != expected.DistanceField
+        || wcsncmp(header.FontName, expected.FontName, LF_FACESIZE) != 0)
+    {
+        Close();
+        return false;
+    }
+
+    const UINT64 descsSize = sizeof(SpriteFont::CharDesc) * SpriteFont::NumChars;
+    const UINT64 texelsSize = static_cast<UINT64>(header.TexWidth) * header.TexHeight * 4;
+    if (static_cast<UINT64>(fileSize.QuadPart) != sizeof(FileHeader) + descsSize + texelsSize)
+    {
+        Close();
+        return false;
+    }
+
+    data.TexWidth = header.TexWidth;
+    data.TexHeight = header.TexHeight;
+    data.SpaceWidth = header.SpaceWidth;
+    data.CharHeight = header.CharHeight;
+    data.CharDescs = reinterpret_cast<const SpriteFont::CharDesc*>(view + sizeof(FileHeader));
+    data.Texels = view + sizeof(FileHeader) + descsSize;
+
+    return true;
+}
+
+void FontCacheFile::Close()
+{
+    if (view != NULL)
+        UnmapViewOfFile(view);
+    if (mapping != NULL)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+
+    file = INVALID_HANDLE_VALUE;
+    mapping = NULL;
+    view = NULL;
+    ZeroMemory(&data, sizeof(data));
+}
+
+void FontCacheFile::Write(const FontCacheKey& key, const FontAtlasData& data)
+{
+    FileHeader header;
+    MakeHeader(key, header);
+    header.TexWidth = data.TexWidth;
+    header.TexHeight = data.TexHeight;
+    header.SpaceWidth = data.SpaceWidth;
+    header.CharHeight = data.CharHeight;
+
+    CreateDirectoryW(CacheDirectory, NULL);
+
+    // Write to a temporary file first, so that other instances never map a partial file
+    wstring fileName = GetFileName(key);
+    wstring tempFileName = fileName + L".tmp";
+    {
+        std::ofstream stream(tempFileName.c_str(), std::ios::binary);
+        if (!stream.is_open())
+            return;
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(data.CharDescs), sizeof(SpriteFont::CharDesc) * SpriteFont::NumChars);
+        stream.write(reinterpret_cast<const char*>(data.Texels), static_cast<std::streamsize>(data.TexWidth) * data.TexHeight * 4);
+        if (!stream.good())
+        {
+            stream.close();
+            DeleteFileW(tempFileName.c_str());
+            return;
+        }
+    }
+
+    if (!MoveFileExW(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+        DeleteFileW(tempFileName.c_str());
+}
+
+}
@@ -0,0 +1,109 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include "SpriteFont.h"
+
+namespace SampleFramework11
+{
+
+// Identifies a glyph page by the parameters passed to SpriteFont::Initialize
+struct FontCacheKey
+{
+    std::wstring FontName;
+    float FontSize;
+    UINT FontStyle;
+    bool AntiAliased;
+    bool DistanceField;
+
+    bool operator<(const FontCacheKey& other) const
+    {
+        if (FontName != other.FontName)
+            return FontName < other.FontName;
+        if (FontSize != other.FontSize)
+            return FontSize < other.FontSize;
+        if (FontStyle != other.FontStyle)
+            return FontStyle < other.FontStyle;
+        if (AntiAliased != other.AntiAliased)
+            return AntiAliased < other.AntiAliased;
+        return DistanceField < other.DistanceField;
+    }
+};
+
+// A rasterized glyph page and its metrics. Texels are B8G8R8A8, with TexWidth texels per row.
+struct FontAtlasData
+{
+    UINT TexWidth;
+    UINT TexHeight;
+    float SpaceWidth;
+    float CharHeight;
+    const SpriteFont::CharDesc* CharDescs;
+    const void* Texels;
+};
+
+// Baked glyph pages are stored in versioned binary files, one per font key. Opening
+// a file memory-maps it, so that the texture can be created directly from the mapped
+// texels without rasterizing anything.
+class FontCacheFile
+{
+
+public:
+
+    // Bump this whenever the glyph rasterization or the file layout changes
+    static const UINT Version = 3;
+
+    FontCacheFile();
+    ~FontCacheFile();
+
+    // Maps the baked file for the key. Returns false if there's no file, or if it was
+    // written by a different version or for a different font.
+    bool Open(const FontCacheKey& key);
+    void Close();
+
+    // Bakes a glyph page. Failing to write the file isn't an error, since it only means
+    // that the font will be rasterized again the next time it's loaded.
+    static void Write(const FontCacheKey& key, const FontAtlasData& data);
+
+    static std::wstring GetFileName(const FontCacheKey& key);
+
+    // Accessors
+    const FontAtlasData& Data() const { return data; };
+
+protected:
+
+    static const UINT Magic = 'FNTC';
+
+    struct FileHeader
+    {
+        UINT Magic;
+        UINT Version;
+        WCHAR FontName[LF_FACESIZE];
+        float FontSize;
+        UINT FontStyle;
+        UINT AntiAliased;
+        UINT DistanceField;
+        UINT NumChars;
+        UINT TexWidth;
+        UINT TexHeight;
+        float SpaceWidth;
+        float CharHeight;
+    };
+
+    static void MakeHeader(const FontCacheKey& key, FileHeader& header);
+
+    HANDLE file;
+    HANDLE mapping;
+    const BYTE* view;
+    FontAtlasData data;
+};
+
+}
@@ -0,0 +1,108 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "PCH.h"
+
+#include "FontRegistry.h"
+#include "FontCache.h"
+
+using std::shared_ptr;
+using std::weak_ptr;
+
+namespace SampleFramework11
+{
+
+// Fonts own textures, so each device gets its own
+struct FontRegistryKey
+{
+    FontCacheKey Font;
+    ID3D11Device* Device;
+
+    bool operator<(const FontRegistryKey& other) const
+    {
+        if (Device != other.Device)
+            return Device < other.Device;
+        return Font < other.Font;
+    }
+};
+
+typedef std::map<FontRegistryKey, weak_ptr<SpriteFont>> FontMap;
+
+static FontMap& Fonts()
+{
+    static FontMap fonts;
+    return fonts;
+}
+
+shared_ptr<SpriteFont> FontRegistry::GetFont(LPCWSTR fontName, float fontSize, UINT fontStyle,
+                                             bool antiAliased, ID3D11Device* device)
+{
+    FontRegistryKey key;
+    key.Font.FontName = fontName;
+    key.Font.FontSize = fontSize;
+    key.Font.FontStyle = fontStyle;
+    key.Font.AntiAliased = antiAliased;
+    key.Font.DistanceField = false;
+    key.Device = device;
+
+    FontMap& fonts = Fonts();
+    shared_ptr<SpriteFont> font = fonts[key].lock();
+    if (font)
+        return font;
+
+    font = shared_ptr<SpriteFont>(new SpriteFont());
+    font->Initialize(fontName, fontSize, fontStyle, antiAliased, device);
+    fonts[key] = font;
+
+    return font;
+}
+
+shared_ptr<SpriteFont> FontRegistry::GetDistanceFieldFont(LPCWSTR fontName, UINT fontStyle, ID3D11Device* device)
+{
+    FontRegistryKey key;
+    key.Font.FontName = fontName;
+    key.Font.FontSize = static_cast<float>(DistanceFieldFontSize);
+    key.Font.FontStyle = fontStyle;
+    key.Font.AntiAliased = true;
+    key.Font.DistanceField = true;
+    key.Device = device;
+
+    FontMap& fonts = Fonts();
+    shared_ptr<SpriteFont> font = fonts[key].lock();
+    if (font)
+        return font;
+
+    font = shared_ptr<SpriteFont>(new SpriteFont());
+    font->InitializeDistanceField(fontName, key.Font.FontSize, fontStyle, device);
+    fonts[key] = font;
+
+    return font;
+}
+
+UINT FontRegistry::NumFonts()
+{
+    FontMap& fonts = Fonts();
+    UINT numFonts = 0;
+    for (FontMap::iterator it = fonts.begin(); it != fonts.end(); )
+    {
+        if (it->second.expired())
+        {
+            it = fonts.erase(it);
+        }
+        else
+        {
+            ++numFonts;
+            ++it;
+        }
+    }
+
+    return numFonts;
+}
+
+}
@@ -0,0 +1,43 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include "SpriteFont.h"
+
+namespace SampleFramework11
+{
+
+// Hands out shared fonts, so that every user of the same face, size, style and
+// antialiasing mode on the same device shares one glyph page instead of rasterizing
+// its own. Shared fonts are never modified, and texture atlases make their own copies. The
+// registry only holds weak references, so a font is released along with its
+// texture once the last user lets go of it. Fonts should only be requested from
+// the thread that owns the device.
+class FontRegistry
+{
+
+public:
+
+    static std::shared_ptr<SpriteFont> GetFont(LPCWSTR fontName, float fontSize, UINT fontStyle,
+                                               bool antiAliased, ID3D11Device* device);
+
+    // Distance field fonts scale to any size, so there's only one per face and style
+    static std::shared_ptr<SpriteFont> GetDistanceFieldFont(LPCWSTR fontName, UINT fontStyle, ID3D11Device* device);
+
+    // The size that distance field glyph pages are rasterized at
+    static const UINT DistanceFieldFontSize = 32;
+
+    // Returns the number of fonts that are currently alive
+    static UINT NumFonts();
+};
+
+}
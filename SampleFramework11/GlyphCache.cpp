@@ -0,0 +1,341 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "PCH.h"
+
+#include "GlyphCache.h"
+#include "Exceptions.h"
+#include "Utility.h"
+
+using namespace Gdiplus;
+using std::wstring;
+using std::vector;
+
+namespace SampleFramework11
+{
+
+// Empty texels are transparent white, the same as in the static glyph page
+static const UINT ClearTexel = 0x00FFFFFF;
+static const UINT SolidTexel = 0xFFFFFFFF;
+
+GlyphCache::GlyphCache()
+    :   fontSize(0),
+        fontStyle(0),
+        antiAliased(false),
+        slotSize(0),
+        slotsPerRow(0),
+        frame(1),
+        generation(0),
+        thread(NULL),
+        wakeEvent(NULL),
+        shutdown(false)
+{
+    InitializeCriticalSection(&lock);
+}
+
+GlyphCache::~GlyphCache()
+{
+    if (thread != NULL)
+    {
+        shutdown = true;
+        SetEvent(wakeEvent);
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    }
+
+    if (wakeEvent != NULL)
+        CloseHandle(wakeEvent);
+
+    DeleteCriticalSection(&lock);
+}
+
+void GlyphCache::Initialize(const wstring& fontName, float fontSize, UINT fontStyle, bool antiAliased,
+                            const SpriteFont::CharDesc& fallbackMetrics, UINT pageSize, ID3D11Device* device)
+{
+    _ASSERT(thread == NULL);
+
+    this->fontName = fontName;
+    this->fontSize = fontSize;
+    this->fontStyle = fontStyle;
+    this->antiAliased = antiAliased;
+
+    // Every slot fits the bitmap that glyphs are drawn into, plus padding
+    slotSize = static_cast<UINT>(fontSize * 2) + SpriteFont::GlyphPadding;
+    slotsPerRow = pageSize / slotSize;
+    if (slotsPerRow * slotsPerRow < 2)
+        throw Exception(L"The dynamic glyph page for font " + fontName + L" is too small to hold any glyphs");
+
+    Slot emptySlot;
+    ZeroMemory(&emptySlot, sizeof(emptySlot));
+    slots.resize(slotsPerRow * slotsPerRow, emptySlot);
+    for (UINT i = 0; i < slots.size(); ++i)
+    {
+        slots[i].Desc.X = static_cast<float>((i % slotsPerRow) * slotSize);
+        slots[i].Desc.Y = static_cast<float>((i / slotsPerRow) * slotSize);
+    }
+
+    // Draw the fallback box into slot 0
+    const UINT maxBoxSize = slotSize - SpriteFont::GlyphPadding;
+    UINT boxWidth = max(min(static_cast<UINT>(fallbackMetrics.Width), maxBoxSize), 3U);
+    UINT boxHeight = max(min(static_cast<UINT>(fallbackMetrics.Height), maxBoxSize), 3U);
+    slots[0].Desc.Width = static_cast<float>(boxWidth);
+    slots[0].Desc.Height = static_cast<float>(boxHeight);
+    slots[0].Desc.OffsetX = 0.0f;
+    slots[0].Desc.OffsetY = fallbackMetrics.OffsetY;
+    slots[0].Desc.Advance = static_cast<float>(boxWidth + 1);
+
+    vector<UINT> initTexels(pageSize * pageSize, ClearTexel);
+    for (UINT y = 0; y < boxHeight; ++y)
+        for (UINT x = 0; x < boxWidth; ++x)
+            if (x == 0 || y == 0 || x == boxWidth - 1 || y == boxHeight - 1)
+                initTexels[y * pageSize + x] = SolidTexel;
+
+    D3D11_SUBRESOURCE_DATA initData;
+    initData.pSysMem = &initTexels[0];
+    initData.SysMemPitch = pageSize * 4;
+    initData.SysMemSlicePitch = 0;
+
+    // The page is updated with UpdateSubresource, so it needs default usage
+    D3D11_TEXTURE2D_DESC texDesc;
+    texDesc.Width = pageSize;
+    texDesc.Height = pageSize;
+    texDesc.MipLevels = 1;
+    texDesc.ArraySize = 1;
+    texDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    texDesc.SampleDesc.Count = 1;
+    texDesc.SampleDesc.Quality = 0;
+    texDesc.Usage = D3D11_USAGE_DEFAULT;
+    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    texDesc.CPUAccessFlags = 0;
+    texDesc.MiscFlags = 0;
+    DXCall(device->CreateTexture2D(&texDesc, &initData, &texture));
+    DXCall(device->CreateShaderResourceView(texture, NULL, &srView));
+
+    uploadTexels.resize(slotSize * slotSize);
+
+    wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    Win32Call(wakeEvent != NULL);
+    thread = CreateThread(NULL, 0, WorkerThread, this, 0, NULL);
+    Win32Call(thread != NULL);
+}
+
+SpriteFont::CharDesc GlyphCache::GetGlyph(WCHAR character)
+{
+    EnterCriticalSection(&lock);
+
+    SpriteFont::CharDesc desc = slots[0].Desc;
+    std::map<WCHAR, UINT>::iterator it = residentGlyphs.find(character);
+    if (it != residentGlyphs.end())
+    {
+        Slot& slot = slots[it->second];
+        slot.LastUsed = frame;
+        desc = slot.Desc;
+    }
+    else if (requestedGlyphs.insert(character).second)
+    {
+        pendingGlyphs.push_back(character);
+        SetEvent(wakeEvent);
+    }
+
+    LeaveCriticalSection(&lock);
+
+    return desc;
+}
+
+void GlyphCache::Touch(const WCHAR* text, size_t length)
+{
+    EnterCriticalSection(&lock);
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (SpriteFont::HasStaticGlyph(text[i]))
+            continue;
+
+        std::map<WCHAR, UINT>::iterator it = residentGlyphs.find(text[i]);
+        if (it != residentGlyphs.end())
+            slots[it->second].LastUsed = frame;
+    }
+
+    LeaveCriticalSection(&lock);
+}
+
+// Returns a free slot, or the least-recently used one that wasn't drawn with
+// during the last frame. Returns 0 if every slot is still in use.
+UINT GlyphCache::AllocateSlot()
+{
+    UINT bestSlot = 0;
+    UINT64 oldest = frame;
+    for (UINT i = 1; i < slots.size(); ++i)
+    {
+        if (slots[i].Character == 0)
+            return i;
+
+        if (slots[i].LastUsed < oldest)
+        {
+            oldest = slots[i].LastUsed;
+            bestSlot = i;
+        }
+    }
+
+    return bestSlot;
+}
+
+void GlyphCache::Update(ID3D11DeviceContext* context)
+{
+    vector<RasterizedGlyph> glyphs;
+    EnterCriticalSection(&lock);
+    glyphs.swap(finishedGlyphs);
+    LeaveCriticalSection(&lock);
+
+    size_t glyphIdx = 0;
+    for (; glyphIdx < glyphs.size(); ++glyphIdx)
+    {
+        const RasterizedGlyph& glyph = glyphs[glyphIdx];
+
+        EnterCriticalSection(&lock);
+        UINT slotIdx = AllocateSlot();
+        if (slotIdx == 0)
+        {
+            LeaveCriticalSection(&lock);
+            break;
+        }
+
+        // Evict whatever was in the slot, so that it gets requested again if it's needed
+        Slot& slot = slots[slotIdx];
+        if (slot.Character != 0)
+        {
+            residentGlyphs.erase(slot.Character);
+            requestedGlyphs.erase(slot.Character);
+        }
+
+        slot.Character = glyph.Character;
+        slot.LastUsed = frame;
+        slot.Desc.Width = static_cast<float>(glyph.Width);
+        slot.Desc.Height = static_cast<float>(glyph.Height);
+        slot.Desc.OffsetX = 0.0f;
+        slot.Desc.OffsetY = glyph.OffsetY;
+        slot.Desc.Advance = static_cast<float>(glyph.Width + 1);
+        residentGlyphs[glyph.Character] = slotIdx;
+        LeaveCriticalSection(&lock);
+
+        // Upload the whole slot, so that nothing from the previous glyph is left behind
+        std::fill(uploadTexels.begin(), uploadTexels.end(), ClearTexel);
+        for (UINT y = 0; y < glyph.Height; ++y)
+            memcpy(&uploadTexels[y * slotSize], &glyph.Texels[y * glyph.Width], glyph.Width * sizeof(UINT));
+
+        D3D11_BOX box;
+        box.left = static_cast<UINT>(slot.Desc.X);
+        box.top = static_cast<UINT>(slot.Desc.Y);
+        box.right = box.left + slotSize;
+        box.bottom = box.top + slotSize;
+        box.front = 0;
+        box.back = 1;
+        context->UpdateSubresource(texture, 0, &box, &uploadTexels[0], slotSize * 4, 0);
+
+        ++generation;
+    }
+
+    // If the page is full of glyphs that are in use, try again next frame
+    if (glyphIdx < glyphs.size())
+    {
+        EnterCriticalSection(&lock);
+        finishedGlyphs.insert(finishedGlyphs.end(), glyphs.begin() + glyphIdx, glyphs.end());
+        LeaveCriticalSection(&lock);
+    }
+
+    EnterCriticalSection(&lock);
+    ++frame;
+    LeaveCriticalSection(&lock);
+}
+
+DWORD WINAPI GlyphCache::WorkerThread(LPVOID param)
+{
+    GlyphCache* cache = reinterpret_cast<GlyphCache*>(param);
+
+    ULONG_PTR token = NULL;
+    GdiplusStartupInput startupInput (NULL, TRUE, TRUE);
+    GdiplusStartupOutput startupOutput;
+    if (GdiplusStartup(&token, &startupInput, &startupOutput) != Ok)
+        return 1;
+
+    try
+    {
+        cache->RasterizeGlyphs();
+    }
+    catch (Exception e)
+    {
+        // Glyphs that never finish keep drawing as the fallback box
+        OutputDebugStringW((L"Dynamic glyph rasterization failed: " + e.GetMessage() + L"\n").c_str());
+    }
+
+    GdiplusShutdown(token);
+    return 0;
+}
+
+// Runs on the worker thread, and rasterizes glyphs as they're requested
+void GlyphCache::RasterizeGlyphs()
+{
+    TextRenderingHint hint = antiAliased ? TextRenderingHintAntiAliasGridFit : TextRenderingHintSystemDefault;
+
+    Gdiplus::Font font(fontName.c_str(), fontSize, fontStyle, UnitPixel, NULL);
+    GdiPlusCall(font.GetLastStatus());
+
+    int tempSize = static_cast<int>(fontSize * 2);
+    Bitmap drawBitmap(tempSize, tempSize, PixelFormat32bppARGB);
+    GdiPlusCall(drawBitmap.GetLastStatus());
+
+    Graphics drawGraphics(&drawBitmap);
+    GdiPlusCall(drawGraphics.GetLastStatus());
+    GdiPlusCall(drawGraphics.SetTextRenderingHint(hint));
+
+    SolidBrush brush (Color(255, 255, 255, 255));
+    GdiPlusCall(brush.GetLastStatus());
+
+    vector<UINT> columnMask(tempSize);
+    WCHAR charString [2];
+    charString[1] = 0;
+
+    while (true)
+    {
+        WaitForSingleObject(wakeEvent, INFINITE);
+        if (shutdown)
+            return;
+
+        while (!shutdown)
+        {
+            EnterCriticalSection(&lock);
+            if (pendingGlyphs.empty())
+            {
+                LeaveCriticalSection(&lock);
+                break;
+            }
+            charString[0] = pendingGlyphs.front();
+            pendingGlyphs.pop_front();
+            LeaveCriticalSection(&lock);
+
+            GdiPlusCall(drawGraphics.Clear(Color(0, 255, 255, 255)));
+            GdiPlusCall(drawGraphics.DrawString(charString, 1, &font, PointF(0, 0), &brush));
+            drawGraphics.Flush(FlushIntentionSync);
+
+            RasterizedGlyph glyph;
+            int minX, maxX, minY, maxY;
+            SpriteFont::ExtractGlyph(drawBitmap, columnMask, minX, maxX, minY, maxY, glyph.Texels);
+            glyph.Character = charString[0];
+            glyph.Width = maxX - minX + 1;
+            glyph.Height = maxY - minY + 1;
+            glyph.OffsetY = static_cast<float>(minY);
+
+            EnterCriticalSection(&lock);
+            finishedGlyphs.push_back(glyph);
+            LeaveCriticalSection(&lock);
+        }
+    }
+}
+
+}
@@ -0,0 +1,103 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include <deque>
+#include <set>
+
+#include "InterfacePointers.h"
+#include "SpriteFont.h"
+
+namespace SampleFramework11
+{
+
+// Holds glyphs for characters that aren't in a SpriteFont's static glyph page. The
+// page is split into fixed-size slots, and glyphs are rasterized with GDI+ on a
+// worker thread the first time that they're asked for. Finished glyphs are uploaded
+// into free slots by Update, and the least-recently used glyph is evicted once the
+// page is full. Until a glyph is ready, a box is drawn in its place.
+class GlyphCache
+{
+
+public:
+
+    GlyphCache();
+    ~GlyphCache();
+
+    void Initialize(const std::wstring& fontName, float fontSize, UINT fontStyle, bool antiAliased,
+                    const SpriteFont::CharDesc& fallbackMetrics, UINT pageSize, ID3D11Device* device);
+
+    // Looks up a glyph, and queues it up for rasterization if it isn't resident.
+    // Returns the fallback box if it isn't ready yet. Can be called from any thread.
+    SpriteFont::CharDesc GetGlyph(WCHAR character);
+
+    // Marks any resident glyphs used by a string, so that they aren't evicted
+    void Touch(const WCHAR* text, size_t length);
+
+    // Uploads finished glyphs into the page. This can replace evicted glyphs, so it
+    // must not be called between SpriteRenderer::Begin and End.
+    void Update(ID3D11DeviceContext* context);
+
+    // Accessors
+    ID3D11ShaderResourceView* SRView() const { return srView; };
+    UINT64 Generation() const { return generation; };
+
+protected:
+
+    struct Slot
+    {
+        WCHAR Character;
+        UINT64 LastUsed;
+        SpriteFont::CharDesc Desc;
+    };
+
+    struct RasterizedGlyph
+    {
+        WCHAR Character;
+        UINT Width;
+        UINT Height;
+        float OffsetY;
+        std::vector<UINT> Texels;
+    };
+
+    static DWORD WINAPI WorkerThread(LPVOID param);
+    void RasterizeGlyphs();
+    UINT AllocateSlot();
+
+    std::wstring fontName;
+    float fontSize;
+    UINT fontStyle;
+    bool antiAliased;
+
+    ID3D11Texture2DPtr texture;
+    ID3D11ShaderResourceViewPtr srView;
+    UINT slotSize;
+    UINT slotsPerRow;
+
+    // Slot 0 always holds the fallback box
+    std::vector<Slot> slots;
+    std::map<WCHAR, UINT> residentGlyphs;
+    std::vector<UINT> uploadTexels;
+    UINT64 frame;
+    UINT64 generation;
+
+    // Shared with the worker thread
+    CRITICAL_SECTION lock;
+    HANDLE thread;
+    HANDLE wakeEvent;
+    volatile bool shutdown;
+    std::deque<WCHAR> pendingGlyphs;
+    std::set<WCHAR> requestedGlyphs;
+    std::vector<RasterizedGlyph> finishedGlyphs;
+};
+
+}
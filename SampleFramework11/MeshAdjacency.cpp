@@ -0,0 +1,205 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "MeshAdjacency.h"
+#include "TangentSpace.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace SampleFramework11
+{
+
+// Work is handed out to the threads in blocks, so that tiny iterations don't get swamped
+// by the scheduling overhead
+static const size_t BlockSize = 4096;
+
+static const uint32_t NoEdge = 0xFFFFFFFF;
+
+template<typename TFunc> static void ParallelForBlocks(size_t count, const TFunc& func)
+{
+    ParallelFor(0, (count + BlockSize - 1) / BlockSize, [&](size_t block)
+    {
+        const size_t end = std::min(count, (block + 1) * BlockSize);
+        for (size_t i = block * BlockSize; i < end; ++i)
+            func(i);
+    });
+}
+
+static uint32_t NextCorner(uint32_t corner)
+{
+    return corner % 3 == 2 ? corner - 2 : corner + 1;
+}
+
+static uint32_t HashEdge(uint32_t v0, uint32_t v1)
+{
+    uint32_t hash = v0 * 0x9E3779B1u ^ v1 * 0x85EBCA77u;
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6Du;
+    return hash ^ (hash >> 13);
+}
+
+// A hash table of directed edges, where each entry holds the first of the edges that go
+// between the same pair of welded vertices, and the rest are linked through nextEdge.
+// Edge e starts at corner e and ends at the next corner of the same triangle.
+class EdgeTable
+{
+public:
+
+    EdgeTable(const uint32_t* indexData, size_t numIndices, const uint32_t* welded) :
+        indices(indexData), weldedVertices(welded), nextEdge(numIndices, NoEdge)
+    {
+        size_t size = 16;
+        while (size < numIndices * 2)
+            size *= 2;
+        firstEdges.assign(size, NoEdge);
+        edgeCounts.assign(size, 0);
+
+        std::vector<uint32_t> hashes(numIndices);
+        ParallelForBlocks(numIndices, [&](size_t e)
+        {
+            hashes[e] = HashEdge(Start(uint32_t(e)), End(uint32_t(e)));
+        });
+
+        // Going backwards keeps the lists in index order
+        for (size_t i = numIndices; i > 0; --i)
+        {
+            const uint32_t e = uint32_t(i - 1);
+            const size_t bucket = FindBucket(Start(e), End(e), hashes[e]);
+            nextEdge[e] = firstEdges[bucket];
+            firstEdges[bucket] = e;
+            ++edgeCounts[bucket];
+        }
+    }
+
+    uint32_t Start(uint32_t e) const { return weldedVertices[indices[e]]; }
+    uint32_t End(uint32_t e) const { return weldedVertices[indices[NextCorner(e)]]; }
+
+    // Returns the bucket that holds the edges from v0 to v1, or the empty bucket where they would go
+    size_t FindBucket(uint32_t v0, uint32_t v1) const
+    {
+        return FindBucket(v0, v1, HashEdge(v0, v1));
+    }
+
+    size_t FindBucket(uint32_t v0, uint32_t v1, uint32_t hash) const
+    {
+        const size_t mask = firstEdges.size() - 1;
+        for (size_t bucket = hash & mask; ; bucket = (bucket + 1) & mask)
+        {
+            const uint32_t e = firstEdges[bucket];
+            if (e == NoEdge || (Start(e) == v0 && End(e) == v1))
+                return bucket;
+        }
+    }
+
+    const uint32_t* indices;
+    const uint32_t* weldedVertices;
+    std::vector<uint32_t> firstEdges;
+    std::vector<uint32_t> edgeCounts;
+    std::vector<uint32_t> nextEdge;
+};
+
+void GenerateAdjacency(const float* positions, uint32_t vertexStride, uint32_t numVertices,
+                       const uint32_t* indices, size_t numIndices, float weldEpsilon, uint32_t* adjacency)
+{
+    VertexStreams streams = { positions, NULL, NULL, vertexStride, numVertices };
+    std::vector<uint32_t> weldedVertices(numVertices);
+    WeldPositions(streams, weldEpsilon, &weldedVertices[0]);
+
+    const EdgeTable edges(indices, numIndices, &weldedVertices[0]);
+
+    // Most edges have exactly one edge going the other way, and they can be paired up
+    // without looking at anything else
+    std::vector<uint8_t> needsPairing(numIndices, 0);
+    ParallelForBlocks(numIndices, [&](size_t i)
+    {
+        const uint32_t e = uint32_t(i);
+        adjacency[e] = NoAdjacentTriangle;
+
+        const uint32_t v0 = edges.Start(e);
+        const uint32_t v1 = edges.End(e);
+        if (v0 == v1)
+            return;
+
+        const size_t twinBucket = edges.FindBucket(v1, v0);
+        const uint32_t twin = edges.firstEdges[twinBucket];
+        if (twin == NoEdge)
+            return;
+
+        if (edges.edgeCounts[twinBucket] == 1 && edges.edgeCounts[edges.FindBucket(v0, v1)] == 1)
+        {
+            if (twin / 3 != e / 3)
+                adjacency[e] = twin / 3;
+        }
+        else
+            needsPairing[e] = 1;
+    });
+
+    // Edges shared by more than two triangles get paired with the first unpaired edge going
+    // the other way
+    std::vector<uint32_t> twins(numIndices, NoEdge);
+    for (uint32_t e = 0; e < numIndices; ++e)
+    {
+        if (!needsPairing[e] || twins[e] != NoEdge)
+            continue;
+
+        const size_t twinBucket = edges.FindBucket(edges.End(e), edges.Start(e));
+        for (uint32_t twin = edges.firstEdges[twinBucket]; twin != NoEdge; twin = edges.nextEdge[twin])
+        {
+            if (twins[twin] == NoEdge && twin / 3 != e / 3)
+            {
+                twins[e] = twin;
+                twins[twin] = e;
+                adjacency[e] = twin / 3;
+                adjacency[twin] = e / 3;
+                break;
+            }
+        }
+    }
+}
+
+void GenerateAdjacencyIndices(const uint32_t* indices, size_t numIndices, const uint32_t* adjacency,
+                              uint32_t* adjacencyIndices)
+{
+    ParallelForBlocks(numIndices, [&](size_t i)
+    {
+        const uint32_t e = uint32_t(i);
+        const uint32_t triangle = e / 3;
+        const uint32_t start = indices[e];
+        const uint32_t end = indices[NextCorner(e)];
+
+        // The far corner of the triangle itself is the fallback
+        uint32_t farCorner = indices[NextCorner(NextCorner(e))];
+
+        const uint32_t other = adjacency[e];
+        if (other != NoAdjacentTriangle)
+        {
+            // Prefer the edge that points back with the same indices, in case the triangles
+            // share more than one edge
+            uint32_t backEdge = NoEdge;
+            for (uint32_t k = other * 3; k < other * 3 + 3; ++k)
+            {
+                if (adjacency[k] != triangle)
+                    continue;
+
+                if (backEdge == NoEdge || (indices[k] == end && indices[NextCorner(k)] == start))
+                    backEdge = k;
+            }
+
+            if (backEdge != NoEdge)
+                farCorner = indices[NextCorner(NextCorner(backEdge))];
+        }
+
+        adjacencyIndices[e * 2] = start;
+        adjacencyIndices[e * 2 + 1] = farCorner;
+    });
+}
+
+}
@@ -0,0 +1,41 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+// This header doesn't use the precompiled header, so that it can be shared by
+// the code that also builds outside of Windows
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SampleFramework11
+{
+
+// Marks an edge that doesn't have a triangle on the other side
+static const uint32_t NoAdjacentTriangle = 0xFFFFFFFF;
+
+// Finds the triangle on the other side of each edge of a triangle list, in the same layout
+// as D3DX: adjacency[t * 3 + e] is the triangle that shares the edge from corner e to
+// corner e + 1 of triangle t. Positions are 3 floats at the start of each vertexStride
+// bytes, and positions within weldEpsilon of each other count as the same vertex. Edges
+// are matched through a hash table, so it takes expected linear time. Edges shared by
+// exactly two triangles are matched in parallel, and edges shared by more are paired up
+// in index order afterwards so that the results are always the same.
+void GenerateAdjacency(const float* positions, uint32_t vertexStride, uint32_t numVertices,
+                       const uint32_t* indices, size_t numIndices, float weldEpsilon, uint32_t* adjacency);
+
+// Builds the indices for D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ, which has 6 indices for
+// every triangle: each corner followed by the far corner of the triangle across the edge
+// that starts there. Edges without a triangle use the triangle's own far corner, so they
+// show up as a triangle that's adjacent to itself.
+void GenerateAdjacencyIndices(const uint32_t* indices, size_t numIndices, const uint32_t* adjacency,
+                              uint32_t* adjacencyIndices);
+
+}
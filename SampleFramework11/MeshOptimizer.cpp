@@ -0,0 +1,624 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "MeshOptimizer.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace SampleFramework11
+{
+
+// Forsyth's scoring parameters, which model an LRU cache of 32 vertices
+static const uint32_t ScoreCacheSize = 32;
+static const uint32_t MaxScoredValence = 32;
+static const float CacheDecayPower = 1.5f;
+static const float LastTriScore = 0.75f;
+static const float ValenceBoostScale = 2.0f;
+static const float ValenceBoostPower = 0.5f;
+
+struct VertexScoreTables
+{
+    float Cache[ScoreCacheSize];
+    float Valence[MaxScoredValence + 1];
+
+    VertexScoreTables()
+    {
+        // The vertices of the last triangle get a fixed score, so that the next triangle
+        // doesn't just reuse the same edge
+        for (uint32_t i = 0; i < ScoreCacheSize; ++i)
+        {
+            if (i < 3)
+                Cache[i] = LastTriScore;
+            else
+                Cache[i] = std::pow(1.0f - (i - 3) / float(ScoreCacheSize - 3), CacheDecayPower);
+        }
+
+        // Vertices with only a few triangles left get a boost, so that they go away sooner
+        Valence[0] = 0.0f;
+        for (uint32_t i = 1; i <= MaxScoredValence; ++i)
+            Valence[i] = ValenceBoostScale * std::pow(float(i), -ValenceBoostPower);
+    }
+};
+
+static const VertexScoreTables ScoreTables;
+
+static float VertexScore(int32_t cachePos, uint32_t numLiveTris)
+{
+    if (numLiveTris == 0)
+        return -1.0f;
+
+    float score = cachePos >= 0 ? ScoreTables.Cache[cachePos] : 0.0f;
+    if (numLiveTris <= MaxScoredValence)
+        score += ScoreTables.Valence[numLiveTris];
+    else
+        score += ValenceBoostScale * std::pow(float(numLiveTris), -ValenceBoostPower);
+
+    return score;
+}
+
+// Optimizes a single range, writing the original index of each triangle to triangleOrder
+static void OptimizeRange(uint32_t* indices, uint32_t numIndices, uint32_t* triangleOrder)
+{
+    const uint32_t numTris = numIndices / 3;
+    if (numTris == 0)
+        return;
+
+    // Remap the vertices to a compact local range, so that the per-vertex data only
+    // needs to be as large as the number of vertices this range uses
+    std::vector<uint32_t> uniqueVerts(indices, indices + numIndices);
+    std::sort(uniqueVerts.begin(), uniqueVerts.end());
+    uniqueVerts.erase(std::unique(uniqueVerts.begin(), uniqueVerts.end()), uniqueVerts.end());
+    const uint32_t numVerts = static_cast<uint32_t>(uniqueVerts.size());
+
+    std::vector<uint32_t> localIndices(numIndices);
+    for (uint32_t i = 0; i < numIndices; ++i)
+        localIndices[i] = static_cast<uint32_t>(std::lower_bound(uniqueVerts.begin(), uniqueVerts.end(), indices[i])
+                                                - uniqueVerts.begin());
+
+    // Build the list of triangles that use each vertex
+    std::vector<uint32_t> numLiveTris(numVerts, 0);
+    for (uint32_t i = 0; i < numIndices; ++i)
+        ++numLiveTris[localIndices[i]];
+
+    std::vector<uint32_t> triListOffsets(numVerts);
+    uint32_t offset = 0;
+    for (uint32_t v = 0; v < numVerts; ++v)
+    {
+        triListOffsets[v] = offset;
+        offset += numLiveTris[v];
+    }
+
+    std::vector<uint32_t> triLists(numIndices);
+    std::vector<uint32_t> triListSizes(numVerts, 0);
+    for (uint32_t i = 0; i < numIndices; ++i)
+    {
+        uint32_t v = localIndices[i];
+        triLists[triListOffsets[v] + triListSizes[v]++] = i / 3;
+    }
+
+    // Initial scores
+    std::vector<int32_t> cachePos(numVerts, -1);
+    std::vector<float> vertScores(numVerts);
+    for (uint32_t v = 0; v < numVerts; ++v)
+        vertScores[v] = VertexScore(-1, numLiveTris[v]);
+
+    std::vector<float> triScores(numTris);
+    int32_t bestTri = -1;
+    float bestScore = -1.0f;
+    for (uint32_t t = 0; t < numTris; ++t)
+    {
+        const uint32_t* tri = &localIndices[t * 3];
+        triScores[t] = vertScores[tri[0]] + vertScores[tri[1]] + vertScores[tri[2]];
+        if (triScores[t] > bestScore)
+        {
+            bestScore = triScores[t];
+            bestTri = t;
+        }
+    }
+
+    std::vector<uint8_t> emitted(numTris, 0);
+    std::vector<uint32_t> newIndices(numIndices);
+    uint32_t cache[ScoreCacheSize + 3];
+    uint32_t newCache[ScoreCacheSize + 3];
+    uint32_t cacheSize = 0;
+    uint32_t nextUnemitted = 0;
+
+    for (uint32_t outTri = 0; outTri < numTris; ++outTri)
+    {
+        // When none of the cached vertices have triangles left, continue in the
+        // original order
+        if (bestTri < 0)
+        {
+            while (emitted[nextUnemitted])
+                ++nextUnemitted;
+            bestTri = nextUnemitted;
+        }
+
+        const uint32_t t = static_cast<uint32_t>(bestTri);
+        const uint32_t* tri = &localIndices[t * 3];
+        emitted[t] = 1;
+        triangleOrder[outTri] = t;
+        for (uint32_t k = 0; k < 3; ++k)
+            newIndices[outTri * 3 + k] = indices[t * 3 + k];
+
+        // Remove the triangle from the lists of its vertices
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            uint32_t v = tri[k];
+            uint32_t* triList = &triLists[triListOffsets[v]];
+            uint32_t listSize = numLiveTris[v];
+            for (uint32_t i = 0; i < listSize; ++i)
+            {
+                if (triList[i] == t)
+                {
+                    triList[i] = triList[listSize - 1];
+                    break;
+                }
+            }
+            --numLiveTris[v];
+        }
+
+        // The triangle's vertices move to the front of the cache
+        uint32_t newCacheSize = 0;
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            if (std::find(newCache, newCache + newCacheSize, tri[k]) == newCache + newCacheSize)
+                newCache[newCacheSize++] = tri[k];
+        }
+
+        for (uint32_t i = 0; i < cacheSize; ++i)
+        {
+            uint32_t v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache[newCacheSize++] = v;
+        }
+
+        // Update the scores of everything that moved in the cache or was pushed out of it
+        for (uint32_t i = 0; i < newCacheSize; ++i)
+        {
+            uint32_t v = newCache[i];
+            cachePos[v] = i < ScoreCacheSize ? static_cast<int32_t>(i) : -1;
+
+            float newScore = VertexScore(cachePos[v], numLiveTris[v]);
+            float delta = newScore - vertScores[v];
+            vertScores[v] = newScore;
+
+            const uint32_t* triList = &triLists[triListOffsets[v]];
+            for (uint32_t j = 0; j < numLiveTris[v]; ++j)
+                triScores[triList[j]] += delta;
+        }
+
+        // The best triangle is almost always one that uses a cached vertex
+        cacheSize = std::min(newCacheSize, ScoreCacheSize);
+        std::copy(newCache, newCache + cacheSize, cache);
+
+        bestTri = -1;
+        bestScore = -1.0f;
+        for (uint32_t i = 0; i < cacheSize; ++i)
+        {
+            uint32_t v = cache[i];
+            const uint32_t* triList = &triLists[triListOffsets[v]];
+            for (uint32_t j = 0; j < numLiveTris[v]; ++j)
+            {
+                if (triScores[triList[j]] > bestScore)
+                {
+                    bestScore = triScores[triList[j]];
+                    bestTri = triList[j];
+                }
+            }
+        }
+    }
+
+    std::copy(newIndices.begin(), newIndices.end(), indices);
+}
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t numIndices, uint32_t numVertices,
+                                    uint32_t cacheSize)
+{
+    VertexCacheStats stats = { 0.0f, 0.0f };
+    if (numIndices < 3 || numVertices == 0)
+        return stats;
+
+    // A vertex is in the cache if fewer than cacheSize misses happened since it was
+    // last loaded, which models a FIFO without having to store one
+    std::vector<uint32_t> loadTimes(numVertices, 0);
+    std::vector<uint8_t> referenced(numVertices, 0);
+    uint32_t time = cacheSize + 1;
+    uint32_t numMisses = 0;
+    uint32_t numReferenced = 0;
+    for (size_t i = 0; i < numIndices; ++i)
+    {
+        uint32_t v = indices[i];
+        if (time - loadTimes[v] > cacheSize)
+        {
+            loadTimes[v] = time++;
+            ++numMisses;
+        }
+
+        if (!referenced[v])
+        {
+            referenced[v] = 1;
+            ++numReferenced;
+        }
+    }
+
+    stats.ACMR = numMisses / float(numIndices / 3);
+    stats.ATVR = numMisses / float(numReferenced);
+    return stats;
+}
+
+void OptimizeVertexCache(uint32_t* indices, size_t numIndices, const IndexRange* ranges,
+                         size_t numRanges, uint32_t* triangleOrder)
+{
+    std::vector<uint32_t> localOrder(numIndices / 3);
+    for (size_t i = 0; i < localOrder.size(); ++i)
+        localOrder[i] = static_cast<uint32_t>(i);
+
+    ParallelFor(0, numRanges, [&](size_t rangeIdx)
+    {
+        const IndexRange& range = ranges[rangeIdx];
+        uint32_t firstTri = range.IndexStart / 3;
+        OptimizeRange(indices + range.IndexStart, range.IndexCount, &localOrder[firstTri]);
+
+        for (uint32_t i = 0; i < range.IndexCount / 3; ++i)
+            localOrder[firstTri + i] += firstTri;
+    });
+
+    if (triangleOrder != NULL)
+        std::copy(localOrder.begin(), localOrder.end(), triangleOrder);
+}
+
+// Size of the grid that the overdraw is measured on, for each view
+static const uint32_t OverdrawGridSize = 256;
+
+static const float* VertexPosition(const float* positions, uint32_t vertexStride, uint32_t v)
+{
+    return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + size_t(v) * vertexStride);
+}
+
+// Computes the unnormalized normal of a triangle, and returns its length, which is
+// twice the area of the triangle
+static float TriangleAreaAndNormal(const float* a, const float* b, const float* c, float* normal)
+{
+    float e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    float e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+    normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+    normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+    return std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+}
+
+OverdrawStats AnalyzeOverdraw(const uint32_t* indices, size_t numIndices, const float* positions,
+                              uint32_t numVertices, uint32_t vertexStride)
+{
+    OverdrawStats stats = { 0.0f, 0, 0 };
+    if (numIndices < 3 || numVertices == 0)
+        return stats;
+
+    // Scale the mesh to fit in the unit cube, keeping its proportions
+    float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (uint32_t v = 0; v < numVertices; ++v)
+    {
+        const float* pos = VertexPosition(positions, vertexStride, v);
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            minPos[i] = std::min(minPos[i], pos[i]);
+            maxPos[i] = std::max(maxPos[i], pos[i]);
+        }
+    }
+
+    float extent = std::max(maxPos[0] - minPos[0], std::max(maxPos[1] - minPos[1], maxPos[2] - minPos[2]));
+    if (extent <= 0.0f)
+        return stats;
+
+    std::vector<float> normalized(size_t(numVertices) * 3);
+    for (uint32_t v = 0; v < numVertices; ++v)
+    {
+        const float* pos = VertexPosition(positions, vertexStride, v);
+        for (uint32_t i = 0; i < 3; ++i)
+            normalized[v * 3 + i] = (pos[i] - minPos[i]) / extent;
+    }
+
+    uint32_t pixelsCovered[6];
+    uint32_t pixelsShaded[6];
+    ParallelFor(0, 6, [&](size_t view)
+    {
+        // Look down the axis, from either side
+        const uint32_t axis = static_cast<uint32_t>(view / 2);
+        const bool flip = (view & 1) != 0;
+        const uint32_t uAxis = (axis + 1) % 3;
+        const uint32_t vAxis = (axis + 2) % 3;
+        const float gridSize = float(OverdrawGridSize);
+
+        std::vector<float> depthBuffer(OverdrawGridSize * OverdrawGridSize, FLT_MAX);
+        uint32_t numShaded = 0;
+
+        for (size_t t = 0; t + 2 < numIndices; t += 3)
+        {
+            const float* p[3] = { &normalized[indices[t] * 3], &normalized[indices[t + 1] * 3],
+                                  &normalized[indices[t + 2] * 3] };
+
+            // Clockwise triangles face the viewer, which is when the normal points back along the view
+            float normal[3];
+            TriangleAreaAndNormal(p[0], p[1], p[2], normal);
+            if ((flip ? -normal[axis] : normal[axis]) >= 0.0f)
+                continue;
+
+            float x[3], y[3], z[3];
+            for (uint32_t i = 0; i < 3; ++i)
+            {
+                x[i] = p[i][uAxis] * gridSize;
+                y[i] = p[i][vAxis] * gridSize;
+                z[i] = flip ? 1.0f - p[i][axis] : p[i][axis];
+            }
+
+            float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+            if (area == 0.0f)
+                continue;
+
+            int32_t minX = std::max(int32_t(std::min(x[0], std::min(x[1], x[2]))), 0);
+            int32_t minY = std::max(int32_t(std::min(y[0], std::min(y[1], y[2]))), 0);
+            int32_t maxX = std::min(int32_t(std::max(x[0], std::max(x[1], x[2]))), int32_t(OverdrawGridSize) - 1);
+            int32_t maxY = std::min(int32_t(std::max(y[0], std::max(y[1], y[2]))), int32_t(OverdrawGridSize) - 1);
+
+            // Walk the pixel centers in the bounding box with barycentric edge functions
+            float invArea = 1.0f / area;
+            for (int32_t py = minY; py <= maxY; ++py)
+            {
+                float sy = py + 0.5f;
+                for (int32_t px = minX; px <= maxX; ++px)
+                {
+                    float sx = px + 0.5f;
+                    float b0 = ((x[2] - x[1]) * (sy - y[1]) - (y[2] - y[1]) * (sx - x[1])) * invArea;
+                    float b1 = ((x[0] - x[2]) * (sy - y[2]) - (y[0] - y[2]) * (sx - x[2])) * invArea;
+                    float b2 = 1.0f - b0 - b1;
+                    if (b0 < 0.0f || b1 < 0.0f || b2 < 0.0f)
+                        continue;
+
+                    float depth = b0 * z[0] + b1 * z[1] + b2 * z[2];
+                    float& bufferDepth = depthBuffer[py * OverdrawGridSize + px];
+                    if (depth < bufferDepth)
+                    {
+                        bufferDepth = depth;
+                        ++numShaded;
+                    }
+                }
+            }
+        }
+
+        uint32_t numCovered = 0;
+        for (size_t i = 0; i < depthBuffer.size(); ++i)
+            if (depthBuffer[i] < FLT_MAX)
+                ++numCovered;
+
+        pixelsCovered[view] = numCovered;
+        pixelsShaded[view] = numShaded;
+    });
+
+    for (uint32_t view = 0; view < 6; ++view)
+    {
+        stats.PixelsCovered += pixelsCovered[view];
+        stats.PixelsShaded += pixelsShaded[view];
+    }
+
+    if (stats.PixelsCovered > 0)
+        stats.Overdraw = stats.PixelsShaded / float(stats.PixelsCovered);
+    return stats;
+}
+
+// Splits an index range that's been optimized for the vertex cache into clusters, and
+// writes the starting triangle of each cluster followed by the number of triangles
+static void GenerateOverdrawClusters(const uint32_t* indices, uint32_t numTris, uint32_t numVertices,
+                                     float threshold, std::vector<uint32_t>& clusters)
+{
+    const uint32_t cacheSize = DefaultVertexCacheSize;
+    std::vector<uint32_t> loadTimes(numVertices, 0);
+    uint32_t time = cacheSize + 1;
+
+    auto triangleMisses = [&](uint32_t t) -> uint32_t
+    {
+        uint32_t numMisses = 0;
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            uint32_t v = indices[t * 3 + k];
+            if (time - loadTimes[v] > cacheSize)
+            {
+                loadTimes[v] = time++;
+                ++numMisses;
+            }
+        }
+        return numMisses;
+    };
+
+    // Pushes everything out of the simulated cache
+    auto flushCache = [&]()
+    {
+        time += cacheSize + 1;
+    };
+
+    // Hard boundaries are where the optimizer had to start over, so that none of the
+    // triangle's vertices are in the cache
+    std::vector<uint32_t> hardBoundaries;
+    for (uint32_t t = 0; t < numTris; ++t)
+    {
+        if (triangleMisses(t) == 3 || t == 0)
+            hardBoundaries.push_back(t);
+    }
+    hardBoundaries.push_back(numTris);
+
+    // Split those up again as soon as the running ACMR is close enough to the ACMR of
+    // the whole hard cluster, which keeps the cost to the vertex cache bounded
+    for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h)
+    {
+        uint32_t start = hardBoundaries[h];
+        uint32_t end = hardBoundaries[h + 1];
+
+        flushCache();
+        uint32_t hardMisses = 0;
+        for (uint32_t t = start; t < end; ++t)
+            hardMisses += triangleMisses(t);
+        float targetACMR = hardMisses / float(end - start) * threshold;
+
+        flushCache();
+        uint32_t clusterStart = start;
+        uint32_t clusterMisses = 0;
+        clusters.push_back(start);
+        for (uint32_t t = start; t < end; ++t)
+        {
+            clusterMisses += triangleMisses(t);
+            if (t + 1 < end && clusterMisses <= targetACMR * (t - clusterStart + 1))
+            {
+                clusters.push_back(t + 1);
+                clusterStart = t + 1;
+                clusterMisses = 0;
+                flushCache();
+            }
+        }
+    }
+    clusters.push_back(numTris);
+}
+
+void OptimizeOverdraw(uint32_t* indices, size_t numIndices, const IndexRange* ranges, size_t numRanges,
+                      const float* positions, uint32_t numVertices, uint32_t vertexStride,
+                      float threshold, uint32_t* triangleOrder)
+{
+    std::vector<uint32_t> localOrder(numIndices / 3);
+    for (size_t i = 0; i < localOrder.size(); ++i)
+        localOrder[i] = static_cast<uint32_t>(i);
+
+    // The occlusion potential of each cluster is measured from the area-weighted
+    // center of everything in the ranges
+    float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    for (size_t rangeIdx = 0; rangeIdx < numRanges; ++rangeIdx)
+    {
+        const IndexRange& range = ranges[rangeIdx];
+        for (uint32_t i = range.IndexStart; i + 2 < range.IndexStart + range.IndexCount; i += 3)
+        {
+            const float* a = VertexPosition(positions, vertexStride, indices[i]);
+            const float* b = VertexPosition(positions, vertexStride, indices[i + 1]);
+            const float* c = VertexPosition(positions, vertexStride, indices[i + 2]);
+            float normal[3];
+            float area = TriangleAreaAndNormal(a, b, c, normal);
+            for (uint32_t k = 0; k < 3; ++k)
+                meshCenter[k] += (a[k] + b[k] + c[k]) * area;
+            meshArea += area;
+        }
+    }
+
+    if (meshArea > 0.0f)
+        for (uint32_t k = 0; k < 3; ++k)
+            meshCenter[k] /= meshArea * 3.0f;
+
+    ParallelFor(0, numRanges, [&](size_t rangeIdx)
+    {
+        const IndexRange& range = ranges[rangeIdx];
+        uint32_t* rangeIndices = indices + range.IndexStart;
+        const uint32_t firstTri = range.IndexStart / 3;
+        const uint32_t numTris = range.IndexCount / 3;
+        if (numTris == 0)
+            return;
+
+        std::vector<uint32_t> clusters;
+        GenerateOverdrawClusters(rangeIndices, numTris, numVertices, threshold, clusters);
+        const size_t numClusters = clusters.size() - 1;
+
+        // Clusters whose average normal points away from the center are on the outside of
+        // the mesh, so they're likely to cover the clusters that get drawn after them
+        std::vector<float> sortKeys(numClusters, 0.0f);
+        for (size_t c = 0; c < numClusters; ++c)
+        {
+            float center[3] = { 0.0f, 0.0f, 0.0f };
+            float normalSum[3] = { 0.0f, 0.0f, 0.0f };
+            float clusterArea = 0.0f;
+            for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t)
+            {
+                const float* a = VertexPosition(positions, vertexStride, rangeIndices[t * 3]);
+                const float* b = VertexPosition(positions, vertexStride, rangeIndices[t * 3 + 1]);
+                const float* p = VertexPosition(positions, vertexStride, rangeIndices[t * 3 + 2]);
+                float normal[3];
+                float area = TriangleAreaAndNormal(a, b, p, normal);
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    center[k] += (a[k] + b[k] + p[k]) * area;
+                    normalSum[k] += normal[k];
+                }
+                clusterArea += area;
+            }
+
+            float normalLength = std::sqrt(normalSum[0] * normalSum[0] + normalSum[1] * normalSum[1] +
+                                           normalSum[2] * normalSum[2]);
+            if (clusterArea <= 0.0f || normalLength <= 0.0f)
+                continue;
+
+            for (uint32_t k = 0; k < 3; ++k)
+                sortKeys[c] += (center[k] / (clusterArea * 3.0f) - meshCenter[k]) * normalSum[k] / normalLength;
+        }
+
+        std::vector<uint32_t> clusterOrder(numClusters);
+        for (size_t c = 0; c < numClusters; ++c)
+            clusterOrder[c] = static_cast<uint32_t>(c);
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b)
+        {
+            return sortKeys[a] > sortKeys[b];
+        });
+
+        std::vector<uint32_t> newIndices;
+        newIndices.reserve(numTris * 3);
+        uint32_t outTri = firstTri;
+        for (size_t i = 0; i < numClusters; ++i)
+        {
+            uint32_t c = clusterOrder[i];
+            for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t)
+            {
+                newIndices.insert(newIndices.end(), rangeIndices + t * 3, rangeIndices + t * 3 + 3);
+                localOrder[outTri++] = firstTri + t;
+            }
+        }
+
+        std::copy(newIndices.begin(), newIndices.end(), rangeIndices);
+    });
+
+    if (triangleOrder != NULL)
+        std::copy(localOrder.begin(), localOrder.end(), triangleOrder);
+}
+
+void OptimizeVertexFetch(uint8_t* vertices, uint32_t numVertices, uint32_t vertexStride,
+                         uint32_t* indices, size_t numIndices, uint32_t* vertexRemap)
+{
+    const uint32_t Unused = 0xFFFFFFFF;
+    std::vector<uint32_t> remap(numVertices, Unused);
+    uint32_t nextVertex = 0;
+    for (size_t i = 0; i < numIndices; ++i)
+    {
+        uint32_t& newIndex = remap[indices[i]];
+        if (newIndex == Unused)
+            newIndex = nextVertex++;
+        indices[i] = newIndex;
+    }
+
+    for (uint32_t v = 0; v < numVertices; ++v)
+        if (remap[v] == Unused)
+            remap[v] = nextVertex++;
+
+    std::vector<uint8_t> oldVertices(vertices, vertices + size_t(numVertices) * vertexStride);
+    for (uint32_t v = 0; v < numVertices; ++v)
+        memcpy(vertices + size_t(remap[v]) * vertexStride, &oldVertices[size_t(v) * vertexStride], vertexStride);
+
+    if (vertexRemap != NULL)
+        std::copy(remap.begin(), remap.end(), vertexRemap);
+}
+
+}
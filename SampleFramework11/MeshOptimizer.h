@@ -0,0 +1,86 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+// This header doesn't use the precompiled header, so that it can be shared by
+// the code that also builds outside of Windows
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SampleFramework11
+{
+
+// A range of a triangle list index buffer that's optimized on its own, like a MeshPart
+struct IndexRange
+{
+    uint32_t IndexStart;
+    uint32_t IndexCount;
+};
+
+// ACMR is the average number of vertices transformed per triangle, and ATVR is the
+// average number of times each referenced vertex is transformed. 0.5 and 1.0 are
+// the best possible values.
+struct VertexCacheStats
+{
+    float ACMR;
+    float ATVR;
+};
+
+// The stats are measured against a FIFO cache, which is what most hardware uses
+static const uint32_t DefaultVertexCacheSize = 16;
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t numIndices, uint32_t numVertices,
+                                    uint32_t cacheSize = DefaultVertexCacheSize);
+
+// Reorders the triangles in each range using Tom Forsyth's linear-speed vertex cache
+// optimization, which greedily picks the next triangle based on how recently its
+// vertices were used and how many triangles still need them. The ranges are optimized
+// in parallel. If triangleOrder isn't NULL it receives the original triangle for every
+// triangle in the index buffer, including the ones outside of the ranges.
+void OptimizeVertexCache(uint32_t* indices, size_t numIndices, const IndexRange* ranges,
+                         size_t numRanges, uint32_t* triangleOrder = NULL);
+
+// Overdraw is the number of pixels shaded for every pixel covered by the mesh, so 1.0
+// is the best possible value. It's measured with a small CPU rasterizer that renders
+// the mesh from both directions along each axis, with back face culling and an early
+// depth test, and the results for all six views are added together.
+struct OverdrawStats
+{
+    float Overdraw;
+    uint32_t PixelsCovered;
+    uint32_t PixelsShaded;
+};
+
+// Positions are 3 floats at the start of each vertexStride bytes
+OverdrawStats AnalyzeOverdraw(const uint32_t* indices, size_t numIndices, const float* positions,
+                              uint32_t numVertices, uint32_t vertexStride);
+
+// Reorders the triangles in each range to reduce overdraw, using the clustering from
+// Sander et al's "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw".
+// The ranges should already be optimized for the vertex cache. Each range is split into
+// clusters wherever the cache simulation shows a cold start, and those clusters are
+// split further once their ACMR gets within threshold times the ACMR of the cluster
+// that they came from. The clusters are then sorted so that the ones that face away
+// from the center of the mesh, which are most likely to occlude the rest, draw first.
+// Ranges are processed in parallel, and triangleOrder works like it does for
+// OptimizeVertexCache.
+void OptimizeOverdraw(uint32_t* indices, size_t numIndices, const IndexRange* ranges, size_t numRanges,
+                      const float* positions, uint32_t numVertices, uint32_t vertexStride,
+                      float threshold = 1.05f, uint32_t* triangleOrder = NULL);
+
+// Reorders the vertices in the order that the indices first use them, so that vertex
+// fetches walk through memory linearly, and remaps the indices to match. Unreferenced
+// vertices go at the end. If vertexRemap isn't NULL it receives the new index for
+// every original vertex.
+void OptimizeVertexFetch(uint8_t* vertices, uint32_t numVertices, uint32_t vertexStride,
+                         uint32_t* indices, size_t numIndices, uint32_t* vertexRemap = NULL);
+
+}
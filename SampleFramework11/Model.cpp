@@ -14,6 +14,11 @@
 #include "SDKmesh.h"
 #include "Exceptions.h"
 #include "Utility.h"
+#include "MeshOptimizer.h"
+#include "VertexCompression.h"
+#include "TangentSpace.h"
+#include "BoundingVolumes.h"
+#include "MeshAdjacency.h"
 
 using std::string;
 using std::wstring;
@@ -24,31 +29,59 @@ using std::wifstream;
 namespace SampleFramework11
 {
 
+const float Mesh::OverdrawACMRThreshold = 1.05f;
+const float Mesh::WeldEpsilon = 0.0001f;
+const bool Mesh::ExactBoundingSpheres = false;
+
 Mesh::Mesh() :  vertexStride(0),
                 numVertices(0),
-                numIndices(0)
+                numIndices(0),
+                compressed(false),
+                positionScale(1.0f, 1.0f, 1.0f),
+                positionOffset(0.0f, 0.0f, 0.0f)
 {
+    VertexCacheStats noStats = { 0.0f, 0.0f };
+    vertexCacheStatsBefore = noStats;
+    vertexCacheStatsAfter = noStats;
+
+    OverdrawStats noOverdraw = { 0.0f, 0, 0 };
+    overdrawStatsBefore = noOverdraw;
+    overdrawStatsAfter = noOverdraw;
+
+    BoundingBox noBox = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+    boxBounds = noBox;
+
+    BoundingSphere noSphere = { { 0.0f, 0.0f, 0.0f }, 0.0f };
+    sphereBounds = noSphere;
 }
 
 Mesh::~Mesh()
 {
 }
 
-void Mesh::CreateFromD3DXMesh(const wstring& directory, ID3D11Device* device, IDirect3DDevice9* d3d9Device,
-                                ID3DXMesh* mesh, bool generateNormals, bool generateTangentFrame,
-                                DWORD* initalAdjacency, IndexType idxType)
+// Returns the offset of the element with the semantic and format, or -1 if there isn't one
+static int FindElement(const vector<D3D11_INPUT_ELEMENT_DESC>& elements, LPCSTR semantic, DXGI_FORMAT format)
 {
-    indexType = idxType;
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        const D3D11_INPUT_ELEMENT_DESC& element = elements[i];
+        if (strcmp(element.SemanticName, semantic) == 0 && element.SemanticIndex == 0 && element.Format == format)
+            return static_cast<int>(element.AlignedByteOffset);
+    }
 
-    // Optimize the mesh
-    adjacency.resize(mesh->GetNumFaces() * 3, 0);
-    DXCall(mesh->OptimizeInplace(D3DXMESHOPT_VERTEXCACHE|D3DXMESHOPT_ATTRSORT,
-            initalAdjacency, &adjacency[0], NULL, NULL));
+    return -1;
+}
 
-    if (generateTangentFrame)
-        mesh = GenerateTangentFrame(mesh, d3d9Device);
-    else if (generateNormals)
-        mesh = GenerateNormals(mesh, d3d9Device);
+void Mesh::CreateFromD3DXMesh(const wstring& directory, ID3D11Device* device, ID3DXMesh* mesh,
+                                bool generateNormals, float normalCreaseAngle, bool generateTangentFrame,
+                                DWORD* initalAdjacency, IndexType idxType, bool compressVertices,
+                                bool createAdjacencyIndices)
+{
+    indexType = idxType;
+
+    // Sort the faces by attribute, the vertex cache optimization happens once the
+    // final vertex format is known. Adjacency is built afterwards for the final order.
+    DXCall(mesh->OptimizeInplace(D3DXMESHOPT_ATTRSORT, initalAdjacency, NULL, NULL, NULL));
 
     // Get some of the mesh info
     vertexStride = mesh->GetNumBytesPerVertex();
@@ -60,9 +93,70 @@ void Mesh::CreateFromD3DXMesh(const wstring& directory, ID3D11Device* device, ID
     DXCall(mesh->GetDeclaration(declaration));
     CreateInputElements(declaration);
 
-    // Copy over the vertex data
-    void* vertices = NULL;
-    DXCall(mesh->LockVertexBuffer(0, &vertices));
+    // Copy in the subset info
+    DWORD numSubsets = 0;
+    DXCall(mesh->GetAttributeTable(NULL, &numSubsets));
+    D3DXATTRIBUTERANGE* attributeTable = new D3DXATTRIBUTERANGE[numSubsets];
+    ArrayDeleter<D3DXATTRIBUTERANGE> tableDeleter(attributeTable);
+    DXCall(mesh->GetAttributeTable(attributeTable, &numSubsets));
+    for(UINT i = 0; i < numSubsets; ++i)
+    {
+        MeshPart part;
+        part.VertexStart = attributeTable[i].VertexStart;
+        part.VertexCount = attributeTable[i].VertexCount;
+        part.IndexStart = attributeTable[i].FaceStart * 3;
+        part.IndexCount = attributeTable[i].FaceCount * 3;
+        part.MaterialIdx = attributeTable[i].AttribId;
+        part.BoxBounds = boxBounds;
+        part.SphereBounds = sphereBounds;
+        meshParts.push_back(part);
+    }
+
+    // Copy out the vertex and index data, with 32-bit indices while it's processed
+    vector<BYTE> vertices(vertexStride * numVertices);
+    vector<uint32_t> indices(numIndices);
+
+    void* meshData = NULL;
+    DXCall(mesh->LockVertexBuffer(D3DLOCK_READONLY, &meshData));
+    memcpy(&vertices[0], meshData, vertices.size());
+    DXCall(mesh->UnlockVertexBuffer());
+
+    DXCall(mesh->LockIndexBuffer(D3DLOCK_READONLY, &meshData));
+    if (mesh->GetOptions() & D3DXMESH_32BIT)
+        memcpy(&indices[0], meshData, numIndices * sizeof(uint32_t));
+    else
+        std::copy(reinterpret_cast<WORD*>(meshData), reinterpret_cast<WORD*>(meshData) + numIndices, indices.begin());
+    DXCall(mesh->UnlockIndexBuffer());
+
+    // The tangent frame needs normals to work from
+    bool hasNormals = FindElement(inputElements, "NORMAL", DXGI_FORMAT_R32G32B32_FLOAT) >= 0;
+    if (generateNormals || (generateTangentFrame && !hasNormals))
+        GenerateNormals(vertices, indices, normalCreaseAngle);
+
+    if (generateTangentFrame)
+        GenerateTangentFrame(vertices, indices);
+
+    OptimizeTriangleOrder(vertices, indices);
+
+    // Splitting vertices for the tangent frame can leave too many for 16-bit indices
+    if (indexType == Index16Bit && numVertices > 0xFFFF)
+        indexType = Index32Bit;
+
+    // Adjacency needs the float positions, so it's built before the vertices are compressed.
+    // Meshes without float positions only fail if the adjacency was asked for.
+    const int positionElement = FindElement(inputElements, "POSITION", DXGI_FORMAT_R32G32B32_FLOAT);
+    if (positionElement < 0 && createAdjacencyIndices)
+        throw Exception(L"Generating adjacency requires float positions");
+    if (positionElement >= 0)
+        BuildAdjacency(device, reinterpret_cast<const float*>(&vertices[positionElement]), vertexStride,
+                       &indices[0], createAdjacencyIndices);
+
+    ComputeBounds(&vertices[0]);
+
+    // Compression needs the bounding box
+    vector<BYTE> compressedVertices;
+    if (compressVertices)
+        CompressVertices(&vertices[0], compressedVertices);
 
     D3D11_BUFFER_DESC bufferDesc;
     bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
@@ -72,72 +166,533 @@ void Mesh::CreateFromD3DXMesh(const wstring& directory, ID3D11Device* device, ID
     bufferDesc.MiscFlags = 0;
 
     D3D11_SUBRESOURCE_DATA initData;
-    initData.pSysMem = vertices;
+    initData.pSysMem = compressed ? &compressedVertices[0] : &vertices[0];
     initData.SysMemPitch = 0;
     initData.SysMemSlicePitch = 0;
     DXCall(device->CreateBuffer(&bufferDesc, &initData, &vertexBuffer));
 
-    // Compute bounding box and sphere
-    D3DXVECTOR3* boxMin = reinterpret_cast<D3DXVECTOR3*>(&bBoxMin);
-    D3DXVECTOR3* boxMax = reinterpret_cast<D3DXVECTOR3*>(&bBoxMax);
-    DXCall(D3DXComputeBoundingBox(reinterpret_cast<D3DXVECTOR3*>(vertices), numVertices, vertexStride, boxMin, boxMax));
-
-    D3DXVECTOR3* sphereCenter = reinterpret_cast<D3DXVECTOR3*>(&bSphereCenter);
-    DXCall(D3DXComputeBoundingSphere(reinterpret_cast<D3DXVECTOR3*>(vertices), numVertices, vertexStride, sphereCenter, &bSphereRadius));
-
-    DXCall(mesh->UnlockVertexBuffer());
+    vector<WORD> indices16;
+    if (indexType == Index16Bit)
+    {
+        indices16.resize(numIndices);
+        for (UINT i = 0; i < numIndices; ++i)
+            indices16[i] = static_cast<WORD>(indices[i]);
+    }
 
     // Copy over the index data
-    void* indices = NULL;
-    DXCall(mesh->LockIndexBuffer(0, &indices));
-
     UINT indexSize = indexType == Index32Bit ? 4 : 2;
     bufferDesc.ByteWidth = indexSize * numIndices;
     bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 
-    initData.pSysMem = indices;
+    initData.pSysMem = indexType == Index32Bit ? static_cast<const void*>(&indices[0]) : &indices16[0];
     DXCall(device->CreateBuffer(&bufferDesc, &initData, &indexBuffer));
+}
 
-    DXCall(mesh->UnlockIndexBuffer());
+// Reorders the triangles of each part for the vertex cache and then for overdraw, and
+// reorders the vertices in the order that they're used
+void Mesh::OptimizeTriangleOrder(vector<BYTE>& vertices, vector<uint32_t>& indices)
+{
+    if (numIndices == 0 || meshParts.empty())
+        return;
 
-    // Copy in the subset info
-    DWORD numSubsets = 0;
-    DXCall(mesh->GetAttributeTable(NULL, &numSubsets));
-    D3DXATTRIBUTERANGE* attributeTable = new D3DXATTRIBUTERANGE[numSubsets];
-    ArrayDeleter<D3DXATTRIBUTERANGE> tableDeleter(attributeTable);
-    DXCall(mesh->GetAttributeTable(attributeTable, &numSubsets));
-    for(UINT i = 0; i < numSubsets; ++i)
+    vertexCacheStatsBefore = AnalyzeVertexCache(&indices[0], numIndices, numVertices);
+
+    vector<IndexRange> ranges(meshParts.size());
+    for (size_t i = 0; i < meshParts.size(); ++i)
     {
-        MeshPart part;
-        part.VertexStart = attributeTable[i].VertexStart;
-        part.VertexCount = attributeTable[i].VertexCount;
-        part.IndexStart = attributeTable[i].FaceStart * 3;
-        part.IndexCount = attributeTable[i].FaceCount * 3;
-        part.MaterialIdx = attributeTable[i].AttribId;
-        meshParts.push_back(part);
+        ranges[i].IndexStart = meshParts[i].IndexStart;
+        ranges[i].IndexCount = meshParts[i].IndexCount;
+    }
+
+    OptimizeVertexCache(&indices[0], numIndices, &ranges[0], ranges.size());
+
+    // Overdraw needs the positions
+    const int positionElement = FindElement(inputElements, "POSITION", DXGI_FORMAT_R32G32B32_FLOAT);
+    const float* positions = NULL;
+    if (positionElement >= 0)
+        positions = reinterpret_cast<const float*>(&vertices[positionElement]);
+
+    if (positions != NULL)
+    {
+        overdrawStatsBefore = AnalyzeOverdraw(&indices[0], numIndices, positions, numVertices, vertexStride);
+
+        OptimizeOverdraw(&indices[0], numIndices, &ranges[0], ranges.size(), positions, numVertices,
+                         vertexStride, OverdrawACMRThreshold);
+
+        overdrawStatsAfter = AnalyzeOverdraw(&indices[0], numIndices, positions, numVertices, vertexStride);
+    }
+
+    OptimizeVertexFetch(&vertices[0], numVertices, vertexStride, &indices[0], numIndices);
+
+    vertexCacheStatsAfter = AnalyzeVertexCache(&indices[0], numIndices, numVertices);
+
+    // The vertices used by each part have moved
+    for (size_t i = 0; i < meshParts.size(); ++i)
+    {
+        MeshPart& part = meshParts[i];
+        if (part.IndexCount == 0)
+            continue;
+
+        const uint32_t* partIndices = &indices[part.IndexStart];
+        uint32_t minVertex = *std::min_element(partIndices, partIndices + part.IndexCount);
+        uint32_t maxVertex = *std::max_element(partIndices, partIndices + part.IndexCount);
+        part.VertexStart = minVertex;
+        part.VertexCount = maxVertex - minVertex + 1;
     }
 }
 
-ID3DXMesh* Mesh::GenerateTangentFrame(ID3DXMesh* mesh, IDirect3DDevice9* d3d9Device)
+// Finds the triangle across every edge, welding positions within WeldEpsilon, and
+// optionally makes an index buffer for D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ
+void Mesh::BuildAdjacency(ID3D11Device* device, const float* positions, UINT positionStride,
+                          const uint32_t* indices, bool createAdjacencyIndices)
 {
-    // make sure we have a texture coordinate
-    D3DVERTEXELEMENT9 decl[MAX_FVF_DECL_SIZE];
-    DXCall(mesh->GetDeclaration(decl));
-    bool foundTexCoord = false;
-    for (UINT i = 0; i < MAX_FVF_DECL_SIZE; ++i)
-    {
-        if (decl[i].Stream == 0xFF)
-            break;
-        else if(decl[i].Usage == D3DDECLUSAGE_TEXCOORD && decl[i].UsageIndex == 0)
+    if (numIndices == 0)
+        return;
+
+    adjacency.resize(numIndices);
+    GenerateAdjacency(positions, positionStride, numVertices, indices, numIndices, WeldEpsilon, &adjacency[0]);
+
+    if (!createAdjacencyIndices)
+        return;
+
+    vector<uint32_t> adjacencyIndices(numIndices * 2);
+    GenerateAdjacencyIndices(indices, numIndices, &adjacency[0], &adjacencyIndices[0]);
+
+    vector<WORD> adjacencyIndices16;
+    if (indexType == Index16Bit)
+    {
+        adjacencyIndices16.resize(adjacencyIndices.size());
+        for (size_t i = 0; i < adjacencyIndices.size(); ++i)
+            adjacencyIndices16[i] = static_cast<WORD>(adjacencyIndices[i]);
+    }
+
+    D3D11_BUFFER_DESC bufferDesc;
+    bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    bufferDesc.ByteWidth = (indexType == Index32Bit ? 4 : 2) * numIndices * 2;
+    bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    bufferDesc.CPUAccessFlags = 0;
+    bufferDesc.MiscFlags = 0;
+
+    D3D11_SUBRESOURCE_DATA initData;
+    initData.pSysMem = indexType == Index32Bit ? static_cast<const void*>(&adjacencyIndices[0]) : &adjacencyIndices16[0];
+    initData.SysMemPitch = 0;
+    initData.SysMemSlicePitch = 0;
+    DXCall(device->CreateBuffer(&bufferDesc, &initData, &adjacencyIndexBuffer));
+}
+
+// Computes the bounds of every part, and merges them into the bounds of the whole mesh so
+// that the vertices are only read once. Meshes without float positions keep their bounds.
+void Mesh::ComputeBounds(const void* vertices)
+{
+    const int positionElement = FindElement(inputElements, "POSITION", DXGI_FORMAT_R32G32B32_FLOAT);
+    if (positionElement < 0 || numVertices == 0)
+        return;
+
+    // A mesh without parts is bounded as a whole
+    vector<VertexRange> ranges(max(meshParts.size(), size_t(1)));
+    ranges[0].VertexStart = 0;
+    ranges[0].VertexCount = numVertices;
+    for (size_t i = 0; i < meshParts.size(); ++i)
+    {
+        ranges[i].VertexStart = min(meshParts[i].VertexStart, numVertices);
+        ranges[i].VertexCount = min(meshParts[i].VertexCount, numVertices - ranges[i].VertexStart);
+    }
+
+    vector<BoundingBox> boxes(ranges.size());
+    vector<BoundingSphere> spheres(ranges.size());
+    const float* positions = reinterpret_cast<const float*>(reinterpret_cast<const BYTE*>(vertices) + positionElement);
+    ComputeBoundingVolumes(positions, vertexStride, &ranges[0], ranges.size(), ExactBoundingSpheres,
+                           &boxes[0], &spheres[0]);
+
+    bool foundBounds = false;
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        if (i < meshParts.size())
         {
-            foundTexCoord = true;
-            break;
+            meshParts[i].BoxBounds = boxes[i];
+            meshParts[i].SphereBounds = spheres[i];
         }
+
+        if (ranges[i].VertexCount == 0)
+            continue;
+
+        boxBounds = foundBounds ? MergeBoundingBoxes(boxBounds, boxes[i]) : boxes[i];
+        sphereBounds = foundBounds ? MergeBoundingSpheres(sphereBounds, spheres[i]) : spheres[i];
+        foundBounds = true;
+    }
+}
+
+static UINT FormatSize(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        return 16;
+    case DXGI_FORMAT_R32G32B32_FLOAT:
+        return 12;
+    case DXGI_FORMAT_R32G32_FLOAT:
+    case DXGI_FORMAT_R16G16B16A16_SINT:
+    case DXGI_FORMAT_R16G16B16A16_SNORM:
+    case DXGI_FORMAT_R16G16B16A16_UNORM:
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        return 8;
+    default:
+        return 4;
     }
+}
 
-    _ASSERT(foundTexCoord);
+// Converts the vertices to compact formats, and updates the input elements and stride to
+// match. Float3 positions become 16-bit values relative to the bounding box, float3
+// normals, tangents and binormals become 16-bit octahedral encodings, and float2 texture
+// coordinates become halfs. Everything else is copied as-is.
+void Mesh::CompressVertices(const void* vertices, vector<BYTE>& compressedVertices)
+{
+    const BYTE* srcVertices = reinterpret_cast<const BYTE*>(vertices);
+    vector<D3D11_INPUT_ELEMENT_DESC> srcElements(inputElements);
+
+    UINT newStride = 0;
+    for (size_t i = 0; i < inputElements.size(); ++i)
+    {
+        D3D11_INPUT_ELEMENT_DESC& element = inputElements[i];
+        const string semantic = element.SemanticName;
+        if (semantic == "POSITION" && element.Format == DXGI_FORMAT_R32G32B32_FLOAT)
+            element.Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+        else if ((semantic == "NORMAL" || semantic == "TANGENT" || semantic == "BINORMAL")
+                  && element.Format == DXGI_FORMAT_R32G32B32_FLOAT)
+            element.Format = DXGI_FORMAT_R16G16_SNORM;
+        else if (semantic == "TEXCOORD" && element.Format == DXGI_FORMAT_R32G32_FLOAT)
+            element.Format = DXGI_FORMAT_R16G16_FLOAT;
+
+        element.AlignedByteOffset = newStride;
+        newStride += FormatSize(element.Format);
+    }
+
+    compressedVertices.resize(newStride * numVertices);
+    for (size_t i = 0; i < inputElements.size(); ++i)
+    {
+        const D3D11_INPUT_ELEMENT_DESC& srcElement = srcElements[i];
+        const D3D11_INPUT_ELEMENT_DESC& dstElement = inputElements[i];
+        const float* src = reinterpret_cast<const float*>(srcVertices + srcElement.AlignedByteOffset);
+        BYTE* dst = &compressedVertices[dstElement.AlignedByteOffset];
+
+        if (dstElement.Format == srcElement.Format)
+        {
+            UINT size = FormatSize(srcElement.Format);
+            for (UINT v = 0; v < numVertices; ++v)
+                memcpy(dst + v * newStride, srcVertices + v * vertexStride + srcElement.AlignedByteOffset, size);
+        }
+        else if (dstElement.Format == DXGI_FORMAT_R16G16B16A16_UNORM)
+            QuantizePositions(src, vertexStride, numVertices, boxBounds.Min, boxBounds.Max,
+                              reinterpret_cast<uint16_t*>(dst), newStride);
+        else if (dstElement.Format == DXGI_FORMAT_R16G16_SNORM)
+            EncodeOctahedral(src, vertexStride, numVertices, reinterpret_cast<int16_t*>(dst), newStride);
+        else
+            EncodeHalf2(src, vertexStride, numVertices, reinterpret_cast<uint16_t*>(dst), newStride);
+    }
+
+    positionOffset = XMFLOAT3(boxBounds.Min);
+    positionScale = XMFLOAT3(boxBounds.Max[0] - boxBounds.Min[0], boxBounds.Max[1] - boxBounds.Min[1],
+                             boxBounds.Max[2] - boxBounds.Min[2]);
+    vertexStride = newStride;
+    compressed = true;
+}
+
+// Creates a buffer by reading the data from the file in chunks, which are copied into
+// a staging buffer and then into the final buffer on the GPU
+static ID3D11BufferPtr CreateStreamedBuffer(ID3D11Device* device, SDKMesh& sdkMesh, UINT bufferIdx,
+                                            UINT64 bufferSize, UINT bindFlags, UINT streamingBudget)
+{
+    if (bufferSize > UINT_MAX)
+        throw Exception(L"SDKMesh buffer is too large to create");
+
+    const bool vertexData = bindFlags == D3D11_BIND_VERTEX_BUFFER;
+    const UINT size = static_cast<UINT>(bufferSize);
+    const UINT chunkSize = min(size, streamingBudget);
+
+    D3D11_BUFFER_DESC bufferDesc;
+    bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+    bufferDesc.ByteWidth = size;
+    bufferDesc.BindFlags = bindFlags;
+    bufferDesc.CPUAccessFlags = 0;
+    bufferDesc.MiscFlags = 0;
+
+    ID3D11BufferPtr buffer;
+    DXCall(device->CreateBuffer(&bufferDesc, NULL, &buffer));
+
+    bufferDesc.Usage = D3D11_USAGE_STAGING;
+    bufferDesc.ByteWidth = chunkSize;
+    bufferDesc.BindFlags = 0;
+    bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+    ID3D11BufferPtr stagingBuffer;
+    DXCall(device->CreateBuffer(&bufferDesc, NULL, &stagingBuffer));
+
+    ID3D11DeviceContextPtr context;
+    device->GetImmediateContext(&context);
+
+    // Read straight into the mapped staging memory, so that the data is never copied on the CPU
+    for (UINT offset = 0; offset < size; offset += chunkSize)
+    {
+        const UINT numBytes = min(chunkSize, size - offset);
+
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        DXCall(context->Map(stagingBuffer, 0, D3D11_MAP_WRITE, 0, &mapped));
+        HRESULT hr = vertexData ? sdkMesh.ReadVertexData(bufferIdx, offset, mapped.pData, numBytes)
+                                : sdkMesh.ReadIndexData(bufferIdx, offset, mapped.pData, numBytes);
+        context->Unmap(stagingBuffer, 0);
+        DXCall(hr);
+
+        D3D11_BOX srcBox = { 0, 0, 0, numBytes, 1, 1 };
+        context->CopySubresourceRegion(buffer, 0, offset, 0, 0, stagingBuffer, 0, &srcBox);
+    }
+
+    return buffer;
+}
+
+// Reads the float3 positions of a streamed vertex buffer back in from the file, through
+// a buffer no larger than the streaming budget (or one vertex, if that's bigger)
+static void ReadStreamedPositions(SDKMesh& sdkMesh, UINT bufferIdx, UINT vertexStride, UINT numVertices,
+                                  UINT positionOffset, UINT streamingBudget, vector<XMFLOAT3>& positions)
+{
+    const UINT verticesPerChunk = min(max(streamingBudget / vertexStride, 1U), numVertices);
+    vector<BYTE> chunk(verticesPerChunk * vertexStride);
+
+    positions.resize(numVertices);
+    for (UINT start = 0; start < numVertices; start += verticesPerChunk)
+    {
+        const UINT count = min(verticesPerChunk, numVertices - start);
+        DXCall(sdkMesh.ReadVertexData(bufferIdx, UINT64(start) * vertexStride, &chunk[0], UINT64(count) * vertexStride));
+        for (UINT i = 0; i < count; ++i)
+            memcpy(&positions[start + i], &chunk[i * vertexStride + positionOffset], sizeof(XMFLOAT3));
+    }
+}
+
+// Reads a streamed index buffer back in from the file as 32-bit indices, through a buffer
+// no larger than the streaming budget
+static void ReadStreamedIndices(SDKMesh& sdkMesh, UINT bufferIdx, UINT indexSize, UINT numIndices,
+                                UINT streamingBudget, vector<uint32_t>& indices)
+{
+    const UINT indicesPerChunk = min(max(streamingBudget / indexSize, 1U), numIndices);
+    vector<BYTE> chunk(indicesPerChunk * indexSize);
+
+    indices.resize(numIndices);
+    for (UINT start = 0; start < numIndices; start += indicesPerChunk)
+    {
+        const UINT count = min(indicesPerChunk, numIndices - start);
+        DXCall(sdkMesh.ReadIndexData(bufferIdx, UINT64(start) * indexSize, &chunk[0], UINT64(count) * indexSize));
+        if (indexSize == 4)
+            memcpy(&indices[start], &chunk[0], count * sizeof(uint32_t));
+        else
+            std::copy(reinterpret_cast<const WORD*>(&chunk[0]), reinterpret_cast<const WORD*>(&chunk[0]) + count,
+                      indices.begin() + start);
+    }
+}
+
+// Creates the buffers straight from the vertex and index data in the SDKMesh, without
+// going through a D3DX mesh. SDKMesh files are already optimized by the exporter, so
+// the data is used as-is.
+void Mesh::CreateFromSDKMesh(ID3D11Device* device, SDKMesh& sdkMesh, UINT meshIdx, UINT streamingBudget,
+                             bool compressVertices)
+{
+    const SDKMESH_MESH* sdkMeshData = sdkMesh.GetMesh(meshIdx);
+    const UINT vbIndex = sdkMeshData->VertexBuffers[0];
+    const UINT ibIndex = sdkMeshData->IndexBuffer;
+
+    indexType = sdkMesh.GetIndexType(meshIdx) == IT_32BIT ? Index32Bit : Index16Bit;
+    vertexStride = sdkMesh.GetVertexStride(meshIdx, 0);
+    numVertices = static_cast<DWORD>(sdkMesh.GetNumVertices(meshIdx, 0));
+    numIndices = static_cast<DWORD>(sdkMesh.GetNumIndices(meshIdx));
+
+    // The declaration is stored as D3D9 vertex elements, which only need translating
+    D3DVERTEXELEMENT9 declaration[MAX_VERTEX_ELEMENTS];
+    memcpy(declaration, sdkMesh.VBElements(vbIndex), sizeof(declaration));
+    CreateInputElements(declaration);
+
+    // Each subset becomes a part. The vertex ranges stored in the subsets can't be trusted,
+    // so each part's range comes from the vertices its indices use. Streamed meshes don't
+    // have their indices in memory, so their parts cover all of the vertices.
+    const BYTE* indexData = sdkMesh.IsStreaming() ? NULL : sdkMesh.GetRawIndicesAt(ibIndex);
+    UINT numSubsets = sdkMesh.GetNumSubsets(meshIdx);
+    for (UINT i = 0; i < numSubsets; ++i)
+    {
+        SDKMESH_SUBSET* subset = sdkMesh.GetSubset(meshIdx, i);
+        MeshPart part;
+        part.VertexStart = 0;
+        part.VertexCount = numVertices;
+        part.IndexStart = static_cast<UINT>(subset->IndexStart);
+        part.IndexCount = static_cast<UINT>(subset->IndexCount);
+        part.MaterialIdx = subset->MaterialID;
+
+        if (indexData != NULL && part.IndexCount > 0 && part.IndexStart + part.IndexCount <= numIndices)
+        {
+            UINT minVertex = 0;
+            UINT maxVertex = 0;
+            if (indexType == Index32Bit)
+            {
+                const uint32_t* partIndices = reinterpret_cast<const uint32_t*>(indexData) + part.IndexStart;
+                minVertex = *std::min_element(partIndices, partIndices + part.IndexCount);
+                maxVertex = *std::max_element(partIndices, partIndices + part.IndexCount);
+            }
+            else
+            {
+                const WORD* partIndices = reinterpret_cast<const WORD*>(indexData) + part.IndexStart;
+                minVertex = *std::min_element(partIndices, partIndices + part.IndexCount);
+                maxVertex = *std::max_element(partIndices, partIndices + part.IndexCount);
+            }
+
+            part.VertexStart = minVertex;
+            part.VertexCount = maxVertex - minVertex + 1;
+        }
+
+        meshParts.push_back(part);
+    }
+
+    // The exporter stores a bounding box with the mesh, which is all that streamed meshes
+    // have since their vertices never pass through the CPU
+    const D3DXVECTOR3& center = sdkMeshData->BoundingBoxCenter;
+    const D3DXVECTOR3& extents = sdkMeshData->BoundingBoxExtents;
+    boxBounds.Min[0] = center.x - extents.x;
+    boxBounds.Min[1] = center.y - extents.y;
+    boxBounds.Min[2] = center.z - extents.z;
+    boxBounds.Max[0] = center.x + extents.x;
+    boxBounds.Max[1] = center.y + extents.y;
+    boxBounds.Max[2] = center.z + extents.z;
+    sphereBounds.Center[0] = center.x;
+    sphereBounds.Center[1] = center.y;
+    sphereBounds.Center[2] = center.z;
+    sphereBounds.Radius = D3DXVec3Length(&extents);
+    for (size_t i = 0; i < meshParts.size(); ++i)
+    {
+        meshParts[i].BoxBounds = boxBounds;
+        meshParts[i].SphereBounds = sphereBounds;
+    }
+
+    // Adjacency needs the float positions, so it's built before the vertices are compressed
+    const UINT indexSize = indexType == Index32Bit ? 4 : 2;
+    if (sdkMesh.AdjacencyIndicesRequested() && numIndices > 0)
+    {
+        const int positionElement = FindElement(inputElements, "POSITION", DXGI_FORMAT_R32G32B32_FLOAT);
+        if (positionElement < 0)
+            throw Exception(L"Generating adjacency requires float positions");
+
+        // Adjacency works from 32-bit indices. Streamed meshes read their positions and indices
+        // back in from the file for it, a streaming budget at a time.
+        vector<uint32_t> indices;
+        if (sdkMesh.IsStreaming())
+        {
+            vector<XMFLOAT3> positions;
+            ReadStreamedPositions(sdkMesh, vbIndex, vertexStride, numVertices, positionElement, streamingBudget, positions);
+            ReadStreamedIndices(sdkMesh, ibIndex, indexSize, numIndices, streamingBudget, indices);
+            BuildAdjacency(device, &positions[0].x, sizeof(XMFLOAT3), &indices[0], true);
+        }
+        else
+        {
+            indices.resize(numIndices);
+            if (indexType == Index32Bit)
+                memcpy(&indices[0], indexData, numIndices * sizeof(uint32_t));
+            else
+                std::copy(reinterpret_cast<const WORD*>(indexData), reinterpret_cast<const WORD*>(indexData) + numIndices, indices.begin());
+
+            const float* positions = reinterpret_cast<const float*>(sdkMesh.GetRawVerticesAt(vbIndex) + positionElement);
+            BuildAdjacency(device, positions, vertexStride, &indices[0], true);
+        }
+    }
+
+    if (sdkMesh.IsStreaming())
+    {
+        _ASSERT(streamingBudget > 0);
+        vertexBuffer = CreateStreamedBuffer(device, sdkMesh, vbIndex, sdkMesh.GetVertexBufferSize(vbIndex),
+                                            D3D11_BIND_VERTEX_BUFFER, streamingBudget);
+        indexBuffer = CreateStreamedBuffer(device, sdkMesh, ibIndex, sdkMesh.GetIndexBufferSize(ibIndex),
+                                           D3D11_BIND_INDEX_BUFFER, streamingBudget);
+    }
+    else
+    {
+        ComputeBounds(sdkMesh.GetRawVerticesAt(vbIndex));
+
+        // Compressing needs a copy of the vertices, but the copy is a fraction of the size
+        vector<BYTE> compressedVertices;
+        if (compressVertices)
+            CompressVertices(sdkMesh.GetRawVerticesAt(vbIndex), compressedVertices);
+
+        D3D11_BUFFER_DESC bufferDesc;
+        bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+        bufferDesc.ByteWidth = vertexStride * numVertices;
+        bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        bufferDesc.CPUAccessFlags = 0;
+        bufferDesc.MiscFlags = 0;
+
+        D3D11_SUBRESOURCE_DATA initData;
+        initData.pSysMem = compressed ? &compressedVertices[0] : sdkMesh.GetRawVerticesAt(vbIndex);
+        initData.SysMemPitch = 0;
+        initData.SysMemSlicePitch = 0;
+        DXCall(device->CreateBuffer(&bufferDesc, &initData, &vertexBuffer));
+
+        bufferDesc.ByteWidth = indexSize * numIndices;
+        bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+        initData.pSysMem = sdkMesh.GetRawIndicesAt(ibIndex);
+        DXCall(device->CreateBuffer(&bufferDesc, &initData, &indexBuffer));
+    }
+}
+
+struct TangentFrameVertex
+{
+    XMFLOAT3 Position;
+    XMFLOAT3 Normal;
+    XMFLOAT2 TexCoord;
+    XMFLOAT3 Tangent;
+    XMFLOAT3 Binormal;
+};
+
+// Computes MikkTSpace tangents and binormals, and writes them into a new vertex stream along
+// with the position, normal and texture coordinate. Vertices that end up with more than one
+// tangent frame are split.
+void Mesh::GenerateTangentFrame(vector<BYTE>& vertices, vector<uint32_t>& indices)
+{
+    const int positionElement = FindElement(inputElements, "POSITION", DXGI_FORMAT_R32G32B32_FLOAT);
+    const int normalElement = FindElement(inputElements, "NORMAL", DXGI_FORMAT_R32G32B32_FLOAT);
+    const int texCoordElement = FindElement(inputElements, "TEXCOORD", DXGI_FORMAT_R32G32_FLOAT);
+    if (positionElement < 0 || normalElement < 0 || texCoordElement < 0)
+        throw Exception(L"Generating a tangent frame requires float positions, normals and texture coordinates");
+
+    VertexStreams streams;
+    streams.Positions = reinterpret_cast<const float*>(&vertices[positionElement]);
+    streams.Normals = reinterpret_cast<const float*>(&vertices[normalElement]);
+    streams.TexCoords = reinterpret_cast<const float*>(&vertices[texCoordElement]);
+    streams.VertexStride = vertexStride;
+    streams.NumVertices = numVertices;
+
+    vector<XMFLOAT4> cornerTangents(numIndices);
+    ComputeTangents(streams, &indices[0], numIndices, &cornerTangents[0].x);
+
+    vector<uint32_t> newIndices(numIndices);
+    vector<uint32_t> sourceVertices(numIndices);
+    UINT numNewVertices = SplitVertices(&indices[0], numIndices, &cornerTangents[0], sizeof(XMFLOAT4),
+                                        &newIndices[0], &sourceVertices[0]);
+
+    vector<BYTE> newVertices(numNewVertices * sizeof(TangentFrameVertex));
+    TangentFrameVertex* dstVertices = reinterpret_cast<TangentFrameVertex*>(&newVertices[0]);
+    for (UINT i = 0; i < numNewVertices; ++i)
+    {
+        const BYTE* srcVertex = &vertices[sourceVertices[i] * vertexStride];
+        TangentFrameVertex& dstVertex = dstVertices[i];
+        memcpy(&dstVertex.Position, srcVertex + positionElement, sizeof(XMFLOAT3));
+        memcpy(&dstVertex.Normal, srcVertex + normalElement, sizeof(XMFLOAT3));
+        memcpy(&dstVertex.TexCoord, srcVertex + texCoordElement, sizeof(XMFLOAT2));
+    }
+
+    // Every corner of a split vertex has the same tangent, so any of them will do
+    for (UINT i = 0; i < numIndices; ++i)
+    {
+        TangentFrameVertex& vertex = dstVertices[newIndices[i]];
+        const XMFLOAT4& tangent = cornerTangents[i];
+        XMVECTOR n = XMLoadFloat3(&vertex.Normal);
+        XMVECTOR t = XMLoadFloat4(&tangent);
+        XMStoreFloat3(&vertex.Tangent, t);
+        XMStoreFloat3(&vertex.Binormal, XMVectorScale(XMVector3Cross(n, t), tangent.w));
+    }
 
-    // Clone the mesh with a new declaration
     D3DVERTEXELEMENT9 newDecl[] =
     {
         { 0, 0,  D3DDECLTYPE_FLOAT3,  D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
@@ -148,44 +703,39 @@ ID3DXMesh* Mesh::GenerateTangentFrame(ID3DXMesh* mesh, IDirect3DDevice9* d3d9Dev
         D3DDECL_END()
     };
 
-    ID3DXMesh* clonedMesh = NULL;
+    inputElements.clear();
+    CreateInputElements(newDecl);
 
-    UINT options = D3DXMESH_MANAGED;
-    if (indexType == Index32Bit)
-        options |= D3DXMESH_32BIT;
-    DXCall(mesh->CloneMesh(options, newDecl, d3d9Device, &clonedMesh));
-    mesh->Release();
-
-    // Calculate the tangent frame
-    DXCall(D3DXComputeTangentFrameEx(clonedMesh,
-        D3DDECLUSAGE_TEXCOORD, 0,
-        D3DDECLUSAGE_BINORMAL, 0,
-        D3DDECLUSAGE_TANGENT, 0,
-        D3DDECLUSAGE_NORMAL, 0,
-        D3DXTANGENT_CALCULATE_NORMALS | D3DXTANGENT_GENERATE_IN_PLACE,
-        &adjacency[0], 0.01f, 0.25f, 0.01f, NULL, NULL));
-
-    return clonedMesh;
+    vertices.swap(newVertices);
+    indices.swap(newIndices);
+    vertexStride = sizeof(TangentFrameVertex);
+    numVertices = numNewVertices;
 }
 
-ID3DXMesh* Mesh::GenerateNormals(ID3DXMesh* mesh, IDirect3DDevice9* d3d9Device)
+// Computes angle weighted normals, and writes them into a new vertex stream along with the
+// position and texture coordinate. Vertices that end up with more than one normal are split.
+void Mesh::GenerateNormals(vector<BYTE>& vertices, vector<uint32_t>& indices, float creaseAngle)
 {
-    // see if we have texture coordinates
-    D3DVERTEXELEMENT9 decl[MAX_FVF_DECL_SIZE];
-    DXCall(mesh->GetDeclaration(decl));
-    bool foundTexCoord = false;
-    for (UINT i = 0; i < MAX_FVF_DECL_SIZE; ++i)
-    {
-        if (decl[i].Stream == 0xFF)
-            break;
-        else if(decl[i].Usage == D3DDECLUSAGE_TEXCOORD && decl[i].UsageIndex == 0)
-        {
-            foundTexCoord = true;
-            break;
-        }
-    }
+    const int positionElement = FindElement(inputElements, "POSITION", DXGI_FORMAT_R32G32B32_FLOAT);
+    const int texCoordElement = FindElement(inputElements, "TEXCOORD", DXGI_FORMAT_R32G32_FLOAT);
+    if (positionElement < 0)
+        throw Exception(L"Generating normals requires float positions");
+
+    VertexStreams streams;
+    streams.Positions = reinterpret_cast<const float*>(&vertices[positionElement]);
+    streams.Normals = NULL;
+    streams.TexCoords = NULL;
+    streams.VertexStride = vertexStride;
+    streams.NumVertices = numVertices;
+
+    vector<XMFLOAT3> cornerNormals(numIndices);
+    ComputeNormals(streams, &indices[0], numIndices, WeldEpsilon, creaseAngle, &cornerNormals[0].x);
+
+    vector<uint32_t> newIndices(numIndices);
+    vector<uint32_t> sourceVertices(numIndices);
+    UINT numNewVertices = SplitVertices(&indices[0], numIndices, &cornerNormals[0], sizeof(XMFLOAT3),
+                                        &newIndices[0], &sourceVertices[0]);
 
-    // Clone the mesh with a new declaration
     D3DVERTEXELEMENT9 tcDecl[] =
     {
         { 0, 0,  D3DDECLTYPE_FLOAT3,   D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
@@ -198,28 +748,33 @@ ID3DXMesh* Mesh::GenerateNormals(ID3DXMesh* mesh, IDirect3DDevice9* d3d9Device)
     {
         { 0, 0,  D3DDECLTYPE_FLOAT3,   D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
         { 0, 12, D3DDECLTYPE_FLOAT3,   D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_NORMAL,   0 },
-        { 0, 24, D3DDECLTYPE_FLOAT2,   D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
         D3DDECL_END()
     };
 
-    D3DVERTEXELEMENT9* newDecl;
-    if (foundTexCoord)
-        newDecl = tcDecl;
-    else
-        newDecl = noTCDecl;
+    const bool foundTexCoord = texCoordElement >= 0;
+    const UINT newStride = foundTexCoord ? 32 : 24;
 
-    ID3DXMesh* clonedMesh = NULL;
+    vector<BYTE> newVertices(numNewVertices * newStride);
+    for (UINT i = 0; i < numNewVertices; ++i)
+    {
+        const BYTE* srcVertex = &vertices[sourceVertices[i] * vertexStride];
+        BYTE* dstVertex = &newVertices[i * newStride];
+        memcpy(dstVertex, srcVertex + positionElement, sizeof(XMFLOAT3));
+        if (foundTexCoord)
+            memcpy(dstVertex + 24, srcVertex + texCoordElement, sizeof(XMFLOAT2));
+    }
 
-    UINT options = D3DXMESH_MANAGED;
-    if (indexType == Index32Bit)
-        options |= D3DXMESH_32BIT;
-    DXCall(mesh->CloneMesh(options, newDecl, d3d9Device, &clonedMesh));
-    mesh->Release();
+    // Every corner of a split vertex has the same normal, so any of them will do
+    for (UINT i = 0; i < numIndices; ++i)
+        memcpy(&newVertices[newIndices[i] * newStride + 12], &cornerNormals[i], sizeof(XMFLOAT3));
 
-    // Generate the normals
-    DXCall(D3DXComputeNormals(clonedMesh, &adjacency[0]));
+    inputElements.clear();
+    CreateInputElements(foundTexCoord ? tcDecl : noTCDecl);
 
-    return clonedMesh;
+    vertices.swap(newVertices);
+    indices.swap(newIndices);
+    vertexStride = newStride;
+    numVertices = numNewVertices;
 }
 
 void Mesh::CreateInputElements(D3DVERTEXELEMENT9* declaration)
@@ -291,6 +846,27 @@ void Mesh::Render(ID3D11DeviceContext* context)
     }
 }
 
+// Draws all parts with the adjacency index buffer, for geometry shaders that need the
+// neighbouring triangles
+void Mesh::RenderAdjacency(ID3D11DeviceContext* context)
+{
+    _ASSERT(adjacencyIndexBuffer);
+
+    ID3D11Buffer* vertexBuffers[1] = { vertexBuffer };
+    UINT vertexStrides[1] = { vertexStride };
+    UINT offsets[1] = { 0 };
+    context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, offsets);
+    context->IASetIndexBuffer(adjacencyIndexBuffer, IndexBufferFormat(), 0);
+    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ);
+
+    // Every index has a far corner after it
+    for(size_t i = 0; i < meshParts.size(); ++i)
+    {
+        MeshPart& meshPart = meshParts[i];
+        context->DrawIndexed(meshPart.IndexCount * 2, meshPart.IndexStart * 2, 0);
+    }
+}
+
 // == Model =======================================================================================
 
 Model::Model()
@@ -310,7 +886,8 @@ Model::~Model()
 
 void Model::CreateFromXFile(ID3D11Device* device, LPCWSTR fileName,
     const WCHAR* normalMapSuffix, bool generateNormals,
-    bool generateTangentFrame, Mesh::IndexType idxType)
+    bool generateTangentFrame, Mesh::IndexType idxType, bool compressVertices,
+    float normalCreaseAngle, bool createAdjacencyIndices)
 {
     _ASSERT(FileExists(fileName));
 
@@ -365,17 +942,23 @@ void Model::CreateFromXFile(ID3D11Device* device, LPCWSTR fileName,
 
     // Make a single mesh
     Mesh mesh;
-    mesh.CreateFromD3DXMesh(fileDirectory, device, d3d9Device, d3dxMesh, generateNormals, generateTangentFrame, initalAdjacency, idxType);
+    mesh.CreateFromD3DXMesh(fileDirectory, device, d3dxMesh, generateNormals, normalCreaseAngle, generateTangentFrame,
+                            initalAdjacency, idxType, compressVertices, createAdjacencyIndices);
     meshes.push_back(mesh);
 }
 
-void Model::CreateFromSDKMeshFile(ID3D11Device* device, LPCWSTR fileName)
+void Model::CreateFromSDKMeshFile(ID3D11Device* device, LPCWSTR fileName, UINT streamingBudget,
+                                  bool compressVertices, bool createAdjacencyIndices)
 {
     _ASSERT(FileExists(fileName));
 
-    // Use the SDKMesh class to load in the data
+    // Use the SDKMesh class to load in the data. The file is either mapped or streamed
+    // rather than read, so that the buffer data never needs its own copy in memory.
     SDKMesh sdkMesh;
-    sdkMesh.Create(fileName);
+    if (streamingBudget > 0)
+        DXCall(sdkMesh.CreateStreaming(fileName, createAdjacencyIndices));
+    else
+        DXCall(sdkMesh.Create(fileName, createAdjacencyIndices, true));
 
     wstring directory = GetDirectoryFromFileName(fileName);
 
@@ -399,87 +982,11 @@ void Model::CreateFromSDKMeshFile(ID3D11Device* device, LPCWSTR fileName)
         meshMaterials.push_back(material);
     }
 
-    // Make a D3D9 device
-    IDirect3DDevice9Ptr d3d9Device = CreateD3D9Device();
-
     UINT numMeshes = sdkMesh.GetNumMeshes();
     for (UINT meshIdx = 0; meshIdx < numMeshes; ++meshIdx)
     {
-        // Figure out the index type
-        UINT ops = D3DXMESH_MANAGED;
-        UINT indexSize = 2;
-        Mesh::IndexType indexType = Mesh::Index16Bit;
-        if (sdkMesh.GetIndexType(meshIdx) == IT_32BIT)
-        {
-            ops |= D3DXMESH_32BIT;
-            indexSize = 4;
-            indexType = Mesh::Index32Bit;
-        }
-
-        // Make a D3DX mesh
-        ID3DXMesh* d3dxMesh = NULL;
-        UINT numPrims = static_cast<UINT>(sdkMesh.GetNumIndices(meshIdx) / 3);
-        UINT numVerts = static_cast<UINT>(sdkMesh.GetNumVertices(meshIdx, 0));
-        UINT vbIndex = sdkMesh.GetMesh(meshIdx)->VertexBuffers[0];
-        UINT ibIndex = sdkMesh.GetMesh(meshIdx)->IndexBuffer;
-        const D3DVERTEXELEMENT9* vbElements = sdkMesh.VBElements(vbIndex);
-        DXCall(D3DXCreateMesh(numPrims, numVerts, ops, vbElements, d3d9Device, &d3dxMesh));
-        IUnknownReleaser<ID3DXMesh> meshReleaser(d3dxMesh);
-
-        // Copy in vertex data
-        BYTE* verts = NULL;
-        BYTE* srcVerts = reinterpret_cast<BYTE*>(sdkMesh.GetRawVerticesAt(vbIndex));
-        UINT vbStride = sdkMesh.GetVertexStride(meshIdx, 0);
-        UINT declStride = D3DXGetDeclVertexSize(vbElements, 0);
-        DXCall(d3dxMesh->LockVertexBuffer(0, reinterpret_cast<void**>(&verts)));
-        for (UINT vertIdx = 0; vertIdx < numVerts; ++vertIdx)
-        {
-            memcpy(verts, srcVerts, declStride);
-            verts += declStride;
-            srcVerts += vbStride;
-        }
-        DXCall(d3dxMesh->UnlockVertexBuffer());
-
-        // Copy in index data
-        void* indices = NULL;
-        void* srcIndices = sdkMesh.GetRawIndicesAt(ibIndex);
-        DXCall(d3dxMesh->LockIndexBuffer(0, &indices));
-        memcpy(indices, srcIndices, numPrims * 3 * indexSize);
-        DXCall(d3dxMesh->UnlockIndexBuffer());
-
-        // Set up the attribute table
-        DWORD* attributeBuffer = NULL;
-        DXCall(d3dxMesh->LockAttributeBuffer(0, &attributeBuffer));
-
-        UINT numSubsets = sdkMesh.GetNumSubsets(meshIdx);
-        D3DXATTRIBUTERANGE* attributes = new D3DXATTRIBUTERANGE[numSubsets];
-        ArrayDeleter<D3DXATTRIBUTERANGE> attributeDeleter(attributes);
-        for (UINT i = 0; i < numSubsets; ++i)
-        {
-            SDKMESH_SUBSET* subset = sdkMesh.GetSubset(meshIdx, i);
-            attributes[i].AttribId = subset->MaterialID;
-            attributes[i].FaceStart = static_cast<DWORD>(subset->IndexStart / 3);
-            attributes[i].FaceCount = static_cast<DWORD>(subset->IndexCount / 3);
-            attributes[i].VertexStart = static_cast<DWORD>(subset->VertexStart);
-            // attributes[i].VertexCount = static_cast<DWORD>(subset->VertexCount);
-            attributes[i].VertexCount = numVerts;
-
-            for (UINT faceIdx = attributes[i].FaceStart; faceIdx < attributes[i].FaceStart + attributes[i].FaceCount; ++faceIdx)
-                attributeBuffer[faceIdx] = subset->MaterialID;
-        }
-
-        DXCall(d3dxMesh->UnlockAttributeBuffer());
-
-        d3dxMesh->SetAttributeTable(attributes, numSubsets);
-
-        // Generate initial adjacency
-        vector<DWORD> initialAdjacency;
-        initialAdjacency.resize(d3dxMesh->GetNumFaces() * 3);
-        DXCall(d3dxMesh->GenerateAdjacency(0.0001f, &initialAdjacency[0]));
-
-        // Make the mesh
         Mesh mesh;
-        mesh.CreateFromD3DXMesh(directory, device, d3d9Device, d3dxMesh, false, false, &initialAdjacency[0], indexType);
+        mesh.CreateFromSDKMesh(device, sdkMesh, meshIdx, streamingBudget, compressVertices);
         meshes.push_back(mesh);
     }
 }
@@ -12,6 +12,10 @@
 #include "PCH.h"
 
 #include "InterfacePointers.h"
+#include "MeshOptimizer.h"
+#include "BoundingVolumes.h"
+
+class SDKMesh;
 
 namespace SampleFramework11
 {
@@ -37,6 +41,8 @@ struct MeshPart
     UINT IndexStart;
     UINT IndexCount;
     UINT MaterialIdx;
+    BoundingBox BoxBounds;
+    BoundingSphere SphereBounds;
 };
 
 class Mesh
@@ -51,12 +57,25 @@ public:
         Index32Bit = 1
     };
 
+    // How much worse than the vertex cache optimized order the ACMR can get when the
+    // triangles are reordered to reduce overdraw
+    static const float OverdrawACMRThreshold;
+
+    // Positions closer together than this are treated as the same position when
+    // generating normals and adjacency
+    static const float WeldEpsilon;
+
+    // Whether bounding spheres are refined into the smallest possible sphere, which is
+    // slower than the Ritter sphere that's used otherwise
+    static const bool ExactBoundingSpheres;
+
     // Lifetime
     Mesh();
     ~Mesh();
 
     // Rendering
     void Render(ID3D11DeviceContext* context);
+    void RenderAdjacency(ID3D11DeviceContext* context);
 
     // Accessors
     ID3D11Buffer* VertexBuffer() { return vertexBuffer; };
@@ -64,6 +83,15 @@ public:
     ID3D11Buffer* IndexBuffer() { return indexBuffer; };
     const ID3D11Buffer* IndexBuffer() const { return indexBuffer; };
 
+    // Only created when adjacency indices are requested at load time, with 6 indices per
+    // triangle in the same format as the regular index buffer
+    ID3D11Buffer* AdjacencyIndexBuffer() { return adjacencyIndexBuffer; };
+    const ID3D11Buffer* AdjacencyIndexBuffer() const { return adjacencyIndexBuffer; };
+
+    // The triangle across each edge of each triangle, or NoAdjacentTriangle. Meshes loaded
+    // from SDKMesh files only have adjacency when adjacency indices are requested.
+    const std::vector<uint32_t>& Adjacency() const { return adjacency; };
+
     std::vector<MeshPart>& MeshParts() { return meshParts; };
     const std::vector<MeshPart>& MeshParts() const { return meshParts; };
 
@@ -74,37 +102,69 @@ public:
     DWORD NumVertices() const { return numVertices; };
     DWORD NumIndices() const { return numIndices; };
 
+    // Vertex cache efficiency before and after the index buffer was optimized
+    const VertexCacheStats& VertexCacheStatsBefore() const { return vertexCacheStatsBefore; };
+    const VertexCacheStats& VertexCacheStatsAfter() const { return vertexCacheStatsAfter; };
+    const OverdrawStats& OverdrawStatsBefore() const { return overdrawStatsBefore; };
+    const OverdrawStats& OverdrawStatsAfter() const { return overdrawStatsAfter; };
+
+    // Bounds of the whole mesh, each part has its own as well
+    const BoundingBox& BoxBounds() const { return boxBounds; };
+    const BoundingSphere& SphereBounds() const { return sphereBounds; };
+
+    // Compressed meshes store positions relative to the bounding box, which the vertex
+    // shader decodes with PositionOffset() + position * PositionScale()
+    bool Compressed() const { return compressed; };
+    const XMFLOAT3& PositionScale() const { return positionScale; };
+    const XMFLOAT3& PositionOffset() const { return positionOffset; };
+
     IndexType IndexBufferType() const { return indexType; };
     DXGI_FORMAT IndexBufferFormat() const { return indexType == Index32Bit ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT; };
 
 protected:
 
-    void CreateFromD3DXMesh(const std::wstring& directory, ID3D11Device* device,
-                            IDirect3DDevice9* d3d9Device, ID3DXMesh* mesh, bool generateNormals,
-                            bool GenerateTangentFrame, DWORD* initalAdjacency, IndexType idxType);
+    void CreateFromD3DXMesh(const std::wstring& directory, ID3D11Device* device, ID3DXMesh* mesh,
+                            bool generateNormals, float normalCreaseAngle, bool GenerateTangentFrame,
+                            DWORD* initalAdjacency, IndexType idxType, bool compressVertices,
+                            bool createAdjacencyIndices);
 
-    ID3DXMesh* GenerateTangentFrame(ID3DXMesh* mesh, IDirect3DDevice9* d3d9Device);
-    ID3DXMesh* GenerateNormals(ID3DXMesh* mesh, IDirect3DDevice9* d3d9Device);
+    void CreateFromSDKMesh(ID3D11Device* device, SDKMesh& sdkMesh, UINT meshIdx, UINT streamingBudget,
+                           bool compressVertices);
+
+    void GenerateTangentFrame(std::vector<BYTE>& vertices, std::vector<uint32_t>& indices);
+    void GenerateNormals(std::vector<BYTE>& vertices, std::vector<uint32_t>& indices, float creaseAngle);
     void CreateInputElements(D3DVERTEXELEMENT9* declaration);
+    void OptimizeTriangleOrder(std::vector<BYTE>& vertices, std::vector<uint32_t>& indices);
+    void BuildAdjacency(ID3D11Device* device, const float* positions, UINT positionStride,
+                        const uint32_t* indices, bool createAdjacencyIndices);
+    void ComputeBounds(const void* vertices);
+    void CompressVertices(const void* vertices, std::vector<BYTE>& compressedVertices);
 
     ID3D11BufferPtr vertexBuffer;
     ID3D11BufferPtr indexBuffer;
+    ID3D11BufferPtr adjacencyIndexBuffer;
 
     std::vector<MeshPart> meshParts;
     std::vector<D3D11_INPUT_ELEMENT_DESC> inputElements;
 
-    XMFLOAT3 bBoxMin;
-    XMFLOAT3 bBoxMax;
-
-    XMFLOAT3 bSphereCenter;
-    float bSphereRadius;
+    BoundingBox boxBounds;
+    BoundingSphere sphereBounds;
 
-    std::vector<DWORD> adjacency;
+    std::vector<uint32_t> adjacency;
     DWORD vertexStride;
     DWORD numVertices;
     DWORD numIndices;
 
     IndexType indexType;
+
+    bool compressed;
+    XMFLOAT3 positionScale;
+    XMFLOAT3 positionOffset;
+
+    VertexCacheStats vertexCacheStatsBefore;
+    VertexCacheStats vertexCacheStatsAfter;
+    OverdrawStats overdrawStatsBefore;
+    OverdrawStats overdrawStatsAfter;
 };
 
 class Model
@@ -115,15 +175,25 @@ public:
     Model();
     ~Model();
 
-    // Loading from file formats
+    // Loading from file formats. Generated normals are only smoothed between faces that
+    // are within normalCreaseAngle radians of each other, and createAdjacencyIndices
+    // makes an index buffer for TRIANGLELIST_ADJ.
     void CreateFromXFile(ID3D11Device* device,
                         LPCWSTR fileName,
                         const WCHAR* normalMapSuffix = NULL,
                         bool generateNormals = false,
                         bool generateTangentFrame = false,
-                        Mesh::IndexType idxType = Mesh::Index16Bit);
-
-    void CreateFromSDKMeshFile(ID3D11Device* device, LPCWSTR fileName);
+                        Mesh::IndexType idxType = Mesh::Index16Bit,
+                        bool compressVertices = false,
+                        float normalCreaseAngle = XM_PI,
+                        bool createAdjacencyIndices = false);
+
+    // A non-zero streaming budget streams the vertex and index data from the file through
+    // staging buffers of at most that many bytes, instead of mapping the whole file.
+    // Streamed vertices aren't compressed, since they never pass through the CPU. Adjacency
+    // for streamed meshes reads the positions and indices back in with the same budget.
+    void CreateFromSDKMeshFile(ID3D11Device* device, LPCWSTR fileName, UINT streamingBudget = 0,
+                               bool compressVertices = false, bool createAdjacencyIndices = false);
 
     // Accessors
     std::vector<MeshMaterial>& Materials() { return meshMaterials; };
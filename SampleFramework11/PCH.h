@@ -57,6 +57,7 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <algorithm>
 #include <cmath>
 #include <sstream>
 #include <fstream>
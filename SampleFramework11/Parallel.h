@@ -0,0 +1,63 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+// This header doesn't use the precompiled header, so that it can be shared by
+// the code that also builds outside of Windows
+
+#include <cstddef>
+
+#if defined(_MSC_VER)
+    #include <ppl.h>
+#else
+    #include <atomic>
+    #include <thread>
+    #include <vector>
+#endif
+
+namespace SampleFramework11
+{
+
+// Calls func(i) for every i in [begin, end), spread across all of the available cores.
+// Iterations can run in any order, so func should only write to data that belongs to i.
+template<typename TFunc> void ParallelFor(size_t begin, size_t end, const TFunc& func)
+{
+    if (end <= begin)
+        return;
+
+#if defined(_MSC_VER)
+    Concurrency::parallel_for(begin, end, [&](size_t i)
+    {
+        func(i);
+    });
+#else
+    size_t numThreads = std::thread::hardware_concurrency();
+    if (numThreads == 0)
+        numThreads = 1;
+    if (numThreads > end - begin)
+        numThreads = end - begin;
+
+    std::atomic<size_t> next(begin);
+    auto worker = [&]()
+    {
+        for (size_t i = next++; i < end; i = next++)
+            func(i);
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < numThreads; ++i)
+        threads.push_back(std::thread(worker));
+    worker();
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+#endif
+}
+
+}
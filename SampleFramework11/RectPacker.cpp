@@ -0,0 +1,205 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "RectPacker.h"
+
+#include <algorithm>
+
+namespace SampleFramework11
+{
+
+RectPacker::RectPacker()
+    :   width(0),
+        maxHeight(0),
+        usedHeight(0)
+{
+
+}
+
+void RectPacker::Reset(uint32_t width, uint32_t maxHeight)
+{
+    this->width = width;
+    this->maxHeight = maxHeight;
+    usedHeight = 0;
+
+    skyline.clear();
+    Segment segment = { 0, 0, width };
+    skyline.push_back(segment);
+}
+
+// Figures out how high a rect would sit if its left edge was at the start of a segment
+bool RectPacker::FindPosition(size_t segmentIdx, uint32_t width, uint32_t height, uint32_t& y) const
+{
+    uint32_t x = skyline[segmentIdx].X;
+    if (x + width > this->width)
+        return false;
+
+    y = 0;
+    uint32_t remaining = width;
+    for (size_t i = segmentIdx; remaining > 0; ++i)
+    {
+        y = std::max(y, skyline[i].Y);
+        if (y + height > maxHeight)
+            return false;
+        remaining -= std::min(remaining, skyline[i].Width);
+    }
+
+    return true;
+}
+
+bool RectPacker::Insert(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+{
+    if (width == 0 || height == 0)
+    {
+        x = 0;
+        y = 0;
+        return true;
+    }
+
+    // Pick the lowest spot, breaking ties with the narrowest segment
+    size_t bestIdx = skyline.size();
+    uint32_t bestY = 0;
+    uint32_t bestWidth = 0;
+    for (size_t i = 0; i < skyline.size(); ++i)
+    {
+        uint32_t segmentY = 0;
+        if (!FindPosition(i, width, height, segmentY))
+            continue;
+
+        if (bestIdx == skyline.size() || segmentY < bestY
+            || (segmentY == bestY && skyline[i].Width < bestWidth))
+        {
+            bestIdx = i;
+            bestY = segmentY;
+            bestWidth = skyline[i].Width;
+        }
+    }
+
+    if (bestIdx == skyline.size())
+        return false;
+
+    x = skyline[bestIdx].X;
+    y = bestY;
+
+    // Add a segment for the top of the new rect, and cut away the ones it covers
+    Segment segment = { x, y + height, width };
+    skyline.insert(skyline.begin() + bestIdx, segment);
+
+    const uint32_t right = x + width;
+    size_t i = bestIdx + 1;
+    while (i < skyline.size() && skyline[i].X < right)
+    {
+        uint32_t segmentRight = skyline[i].X + skyline[i].Width;
+        if (segmentRight <= right)
+        {
+            skyline.erase(skyline.begin() + i);
+        }
+        else
+        {
+            skyline[i].Width = segmentRight - right;
+            skyline[i].X = right;
+            break;
+        }
+    }
+
+    // Merge neighbours at the same height
+    for (size_t j = 0; j + 1 < skyline.size(); )
+    {
+        if (skyline[j].Y == skyline[j + 1].Y)
+        {
+            skyline[j].Width += skyline[j + 1].Width;
+            skyline.erase(skyline.begin() + j + 1);
+        }
+        else
+            ++j;
+    }
+
+    usedHeight = std::max(usedHeight, y + height);
+    return true;
+}
+
+static bool CompareHeights(const RectPacker::Rect* a, const RectPacker::Rect* b)
+{
+    if (a->Height != b->Height)
+        return a->Height > b->Height;
+    return a->Width > b->Width;
+}
+
+static uint32_t NextPow2(uint32_t x)
+{
+    uint32_t pow2 = 1;
+    while (pow2 < x)
+        pow2 *= 2;
+    return pow2;
+}
+
+bool RectPacker::PackPow2(std::vector<Rect>& rects, uint32_t minWidth, uint32_t maxSize,
+                          uint32_t& width, uint32_t& height)
+{
+    if (rects.empty())
+    {
+        width = NextPow2(std::max<uint32_t>(minWidth, 1));
+        height = 1;
+        return true;
+    }
+
+    std::vector<Rect*> sortedRects;
+    uint32_t widest = 1;
+    for (size_t i = 0; i < rects.size(); ++i)
+    {
+        sortedRects.push_back(&rects[i]);
+        widest = std::max(widest, rects[i].Width);
+    }
+    std::stable_sort(sortedRects.begin(), sortedRects.end(), CompareHeights);
+
+    // Try every power-of-2 width, and keep whichever one ends up using the least area
+    uint64_t bestArea = UINT64_MAX;
+    uint32_t bestWidth = 0;
+    uint32_t bestLongestSide = 0;
+    RectPacker packer;
+    for (uint32_t binWidth = NextPow2(std::max(minWidth, widest)); binWidth <= maxSize; binWidth *= 2)
+    {
+        packer.Reset(binWidth, maxSize);
+
+        bool fits = true;
+        for (size_t i = 0; i < sortedRects.size() && fits; ++i)
+            fits = packer.Insert(sortedRects[i]->Width, sortedRects[i]->Height, sortedRects[i]->X, sortedRects[i]->Y);
+        if (!fits)
+            continue;
+
+        // Prefer squarer bins when the area is the same
+        uint32_t binHeight = NextPow2(std::max<uint32_t>(packer.UsedHeight(), 1));
+        uint64_t area = static_cast<uint64_t>(binWidth) * binHeight;
+        uint32_t longestSide = std::max(binWidth, binHeight);
+        if (area < bestArea || (area == bestArea && longestSide < bestLongestSide))
+        {
+            bestArea = area;
+            bestWidth = binWidth;
+            bestLongestSide = longestSide;
+        }
+
+        // Once everything fits on one row, wider bins can only waste more space
+        if (packer.UsedHeight() <= sortedRects[0]->Height)
+            break;
+    }
+
+    if (bestWidth == 0)
+        return false;
+
+    // Repack at the best width, since the rects hold the results from the last attempt
+    packer.Reset(bestWidth, maxSize);
+    for (size_t i = 0; i < sortedRects.size(); ++i)
+        packer.Insert(sortedRects[i]->Width, sortedRects[i]->Height, sortedRects[i]->X, sortedRects[i]->Y);
+
+    width = bestWidth;
+    height = NextPow2(std::max<uint32_t>(packer.UsedHeight(), 1));
+    return true;
+}
+
+}
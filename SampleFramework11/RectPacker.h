@@ -0,0 +1,71 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+// This header doesn't use the precompiled header, so that it can be shared by
+// the code that also builds outside of Windows
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SampleFramework11
+{
+
+// Packs rectangles into a bin of fixed width using the skyline bottom-left heuristic:
+// the top edge of everything placed so far is tracked as a list of horizontal segments,
+// and each rectangle goes wherever its top edge ends up lowest.
+class RectPacker
+{
+
+public:
+
+    struct Rect
+    {
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t X;
+        uint32_t Y;
+    };
+
+    RectPacker();
+
+    void Reset(uint32_t width, uint32_t maxHeight);
+
+    // Returns false if the rectangle doesn't fit
+    bool Insert(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+
+    // Packs all of the rects, tallest first, into the smallest power-of-2 sized bin
+    // that's at least minWidth wide. Returns false if they don't fit in maxSize x maxSize.
+    static bool PackPow2(std::vector<Rect>& rects, uint32_t minWidth, uint32_t maxSize,
+                         uint32_t& width, uint32_t& height);
+
+    // Accessors
+    uint32_t Width() const { return width; };
+    uint32_t UsedHeight() const { return usedHeight; };
+
+protected:
+
+    struct Segment
+    {
+        uint32_t X;
+        uint32_t Y;
+        uint32_t Width;
+    };
+
+    bool FindPosition(size_t segmentIdx, uint32_t width, uint32_t height, uint32_t& y) const;
+
+    std::vector<Segment> skyline;
+    uint32_t width;
+    uint32_t maxHeight;
+    uint32_t usedHeight;
+};
+
+}
@@ -23,6 +23,31 @@
 #endif
 
 
+//--------------------------------------------------------------------------------------
+// Reads a range of a file, in pieces small enough for ReadFile
+//--------------------------------------------------------------------------------------
+static HRESULT ReadFileRange( HANDLE hFile, UINT64 Offset, void* pDest, UINT64 NumBytes )
+{
+    LARGE_INTEGER FilePos;
+    FilePos.QuadPart = ( LONGLONG )Offset;
+    if( !SetFilePointerEx( hFile, FilePos, NULL, FILE_BEGIN ) )
+        return E_FAIL;
+
+    BYTE* pDestBytes = ( BYTE* )pDest;
+    while( NumBytes > 0 )
+    {
+        DWORD dwBytesToRead = ( DWORD )min( NumBytes, ( UINT64 )0x40000000 );
+        DWORD dwBytesRead = 0;
+        if( !ReadFile( hFile, pDestBytes, dwBytesToRead, &dwBytesRead, NULL ) || dwBytesRead != dwBytesToRead )
+            return E_FAIL;
+
+        pDestBytes += dwBytesRead;
+        NumBytes -= dwBytesRead;
+    }
+
+    return S_OK;
+}
+
 //--------------------------------------------------------------------------------------
 HRESULT SDKMesh::CreateFromFile( LPCWSTR szFileName,
                                       bool bCreateAdjacencyIndices)
@@ -33,37 +58,165 @@ HRESULT SDKMesh::CreateFromFile( LPCWSTR szFileName,
     m_hFile = CreateFile( szFileName, FILE_READ_DATA, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
                           NULL );
     if( INVALID_HANDLE_VALUE == m_hFile )
-        return E_FAIL;    
+    {
+        m_hFile = 0;
+        return E_FAIL;
+    }
 
-    // Get the file size
+    // Get the file size, which has to fit in the address space
     LARGE_INTEGER FileSize;
-    GetFileSizeEx( m_hFile, &FileSize );
-    UINT cBytes = FileSize.LowPart;
+    if( !GetFileSizeEx( m_hFile, &FileSize ) || ( UINT64 )FileSize.QuadPart > ( SIZE_T )-1 )
+    {
+        CloseHandle( m_hFile );
+        m_hFile = 0;
+        return E_OUTOFMEMORY;
+    }
+    SIZE_T cBytes = ( SIZE_T )FileSize.QuadPart;
 
     // Allocate memory
     m_pStaticMeshData = new BYTE[ cBytes ];
     if( !m_pStaticMeshData )
     {
         CloseHandle( m_hFile );
+        m_hFile = 0;
         return E_OUTOFMEMORY;
     }
 
     // Read in the file
-    DWORD dwBytesRead;
-    if( !ReadFile( m_hFile, m_pStaticMeshData, cBytes, &dwBytesRead, NULL ) )
-        hr = E_FAIL;
+    hr = ReadFileRange( m_hFile, 0, m_pStaticMeshData, cBytes );
 
     CloseHandle( m_hFile );
+    m_hFile = 0;
 
     if( SUCCEEDED( hr ) )
     {
         hr = CreateFromMemory( m_pStaticMeshData,
-                               cBytes,
+                               ( UINT )min( cBytes, ( SIZE_T )UINT_MAX ),
                                bCreateAdjacencyIndices,
                                false);
         if( FAILED( hr ) )
-            delete []m_pStaticMeshData;
+            Destroy();
     }
+    else
+        SAFE_DELETE_ARRAY( m_pStaticMeshData );
+
+    return hr;
+}
+
+//--------------------------------------------------------------------------------------
+// Only reads the header and the non-buffer data, and keeps the file open so that the
+// vertex and index data can be streamed out of it with ReadVertexData/ReadIndexData.
+// This works for files of any size, since only the offsets need to fit in 64 bits.
+//--------------------------------------------------------------------------------------
+HRESULT SDKMesh::CreateStreamingFromFile( LPCWSTR szFileName,
+                                          bool bCreateAdjacencyIndices)
+{
+    HRESULT hr = S_OK;
+
+    // Open the file
+    m_hFile = CreateFile( szFileName, FILE_READ_DATA, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                          NULL );
+    if( INVALID_HANDLE_VALUE == m_hFile )
+    {
+        m_hFile = 0;
+        return E_FAIL;
+    }
+
+    // Read the header to find out how much static data there is
+    SDKMESH_HEADER Header;
+    hr = ReadFileRange( m_hFile, 0, &Header, sizeof( Header ) );
+    if( SUCCEEDED( hr ) && Header.Version != SDKMESH_FILE_VERSION )
+        hr = E_NOINTERFACE;
+
+    UINT64 StaticSize = Header.HeaderSize + Header.NonBufferDataSize;
+    if( SUCCEEDED( hr ) && StaticSize > ( SIZE_T )-1 )
+        hr = E_OUTOFMEMORY;
+
+    BYTE* pStaticData = NULL;
+    if( SUCCEEDED( hr ) )
+    {
+        pStaticData = new BYTE[ ( SIZE_T )StaticSize ];
+        hr = ReadFileRange( m_hFile, 0, pStaticData, StaticSize );
+    }
+
+    if( SUCCEEDED( hr ) )
+        hr = CreateFromMemory( pStaticData, ( UINT )min( StaticSize, ( UINT64 )UINT_MAX ),
+                               bCreateAdjacencyIndices, false );
+    else
+        SAFE_DELETE_ARRAY( pStaticData );
+
+    if( FAILED( hr ) )
+    {
+        Destroy();
+        return hr;
+    }
+
+    // None of the buffer data is in memory
+    for( UINT i = 0; i < m_pMeshHeader->NumVertexBuffers; i++ )
+        m_ppVertices[i] = NULL;
+    for( UINT i = 0; i < m_pMeshHeader->NumIndexBuffers; i++ )
+        m_ppIndices[i] = NULL;
+
+    m_bStreaming = true;
+
+    return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+// Maps the file instead of reading it into a heap allocation. The view is copy-on-write
+// since the pointer fixup writes into the mesh headers, which means only those pages get
+// copied. Vertex and index data is paged in from the file the first time it's touched.
+//--------------------------------------------------------------------------------------
+HRESULT SDKMesh::CreateFromMappedFile( LPCWSTR szFileName,
+                                       bool bCreateAdjacencyIndices)
+{
+    HRESULT hr = S_OK;
+
+    // Open the file
+    m_hFile = CreateFile( szFileName, FILE_READ_DATA, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS,
+                          NULL );
+    if( INVALID_HANDLE_VALUE == m_hFile )
+    {
+        m_hFile = 0;
+        return E_FAIL;
+    }
+
+    LARGE_INTEGER FileSize;
+    if( !GetFileSizeEx( m_hFile, &FileSize ) || FileSize.QuadPart < ( LONGLONG )sizeof( SDKMESH_HEADER ) )
+    {
+        CloseHandle( m_hFile );
+        m_hFile = 0;
+        return E_FAIL;
+    }
+
+    // Map the whole file
+    m_hFileMappingObject = CreateFileMapping( m_hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+    if( m_hFileMappingObject != NULL )
+        m_pMappedView = ( BYTE* )MapViewOfFile( m_hFileMappingObject, FILE_MAP_COPY, 0, 0, 0 );
+
+    // The mapping keeps its own reference to the file
+    CloseHandle( m_hFile );
+    m_hFile = 0;
+
+    if( m_pMappedView == NULL )
+    {
+        if( m_hFileMappingObject != NULL )
+            CloseHandle( m_hFileMappingObject );
+        m_hFileMappingObject = 0;
+        return E_FAIL;
+    }
+
+    hr = CreateFromMemory( m_pMappedView,
+                           ( UINT )min( ( UINT64 )FileSize.QuadPart, ( UINT64 )UINT_MAX ),
+                           bCreateAdjacencyIndices,
+                           false );
+
+    // The view is owned by the mapping, not the heap
+    if( m_pHeapData == m_pMappedView )
+        m_pHeapData = NULL;
+
+    if( FAILED( hr ) )
+        Destroy();
 
     return hr;
 }
@@ -81,6 +234,9 @@ HRESULT SDKMesh::CreateFromMemory( BYTE* pData,
     // Set outstanding resources to zero
     m_NumOutstandingResources = 0;
 
+    // The adjacency indices are built by whoever creates the buffers
+    m_bCreateAdjacencyIndices = bCreateAdjacencyIndices;
+
     if( bCopyStatic )
     {
         SDKMESH_HEADER* pHeader = ( SDKMESH_HEADER* )pData;
@@ -167,6 +323,9 @@ SDKMesh::SDKMesh() : m_NumOutstandingResources( 0 ),
                                m_bLoading( false ),
                                m_hFile( 0 ),
                                m_hFileMappingObject( 0 ),
+                               m_pMappedView( NULL ),
+                               m_bStreaming( false ),
+                               m_bCreateAdjacencyIndices( false ),
                                m_pMeshHeader( NULL ),
                                m_pStaticMeshData( NULL ),
                                m_pHeapData( NULL ),
@@ -189,11 +348,19 @@ SDKMesh::~SDKMesh()
 }
 
 //--------------------------------------------------------------------------------------
-HRESULT SDKMesh::Create( LPCTSTR szFileName, bool bCreateAdjacencyIndices )
+HRESULT SDKMesh::Create( LPCTSTR szFileName, bool bCreateAdjacencyIndices, bool bMemoryMap )
 {
+    if( bMemoryMap )
+        return CreateFromMappedFile( szFileName, bCreateAdjacencyIndices );
     return CreateFromFile( szFileName, bCreateAdjacencyIndices );
 }
 
+//--------------------------------------------------------------------------------------
+HRESULT SDKMesh::CreateStreaming( LPCTSTR szFileName, bool bCreateAdjacencyIndices )
+{
+    return CreateStreamingFromFile( szFileName, bCreateAdjacencyIndices );
+}
+
 //--------------------------------------------------------------------------------------
 HRESULT SDKMesh::Create( BYTE* pData, UINT DataBytes, bool bCreateAdjacencyIndices,
                               bool bCopyStatic)
@@ -209,6 +376,26 @@ void SDKMesh::Destroy()
 
     SAFE_DELETE_ARRAY( m_pHeapData );
     m_pStaticMeshData = NULL;
+
+    if( m_pMappedView )
+    {
+        UnmapViewOfFile( m_pMappedView );
+        m_pMappedView = NULL;
+    }
+    if( m_hFileMappingObject )
+    {
+        CloseHandle( m_hFileMappingObject );
+        m_hFileMappingObject = 0;
+    }
+
+    if( m_hFile )
+    {
+        CloseHandle( m_hFile );
+        m_hFile = 0;
+    }
+    m_bStreaming = false;
+    m_bCreateAdjacencyIndices = false;
+
     SAFE_DELETE_ARRAY( m_pAnimationData );
     SAFE_DELETE_ARRAY( m_pBindPoseFrameMatrices );
     SAFE_DELETE_ARRAY( m_pTransformedFrameMatrices );
@@ -315,6 +502,50 @@ UINT SDKMesh::GetNumIBs()
     return m_pMeshHeader->NumIndexBuffers;
 }
 
+//--------------------------------------------------------------------------------------
+HRESULT SDKMesh::ReadVertexData( UINT iVB, UINT64 Offset, void* pDest, UINT64 NumBytes )
+{
+    const SDKMESH_VERTEX_BUFFER_HEADER& VB = m_pVertexBufferArray[iVB];
+    if( Offset + NumBytes > VB.SizeBytes )
+        return E_INVALIDARG;
+
+    if( !m_bStreaming )
+    {
+        CopyMemory( pDest, m_ppVertices[iVB] + Offset, ( SIZE_T )NumBytes );
+        return S_OK;
+    }
+
+    return ReadFileRange( m_hFile, VB.DataOffset + Offset, pDest, NumBytes );
+}
+
+//--------------------------------------------------------------------------------------
+HRESULT SDKMesh::ReadIndexData( UINT iIB, UINT64 Offset, void* pDest, UINT64 NumBytes )
+{
+    const SDKMESH_INDEX_BUFFER_HEADER& IB = m_pIndexBufferArray[iIB];
+    if( Offset + NumBytes > IB.SizeBytes )
+        return E_INVALIDARG;
+
+    if( !m_bStreaming )
+    {
+        CopyMemory( pDest, m_ppIndices[iIB] + Offset, ( SIZE_T )NumBytes );
+        return S_OK;
+    }
+
+    return ReadFileRange( m_hFile, IB.DataOffset + Offset, pDest, NumBytes );
+}
+
+//--------------------------------------------------------------------------------------
+UINT64 SDKMesh::GetVertexBufferSize( UINT iVB )
+{
+    return m_pVertexBufferArray[iVB].SizeBytes;
+}
+
+//--------------------------------------------------------------------------------------
+UINT64 SDKMesh::GetIndexBufferSize( UINT iIB )
+{
+    return m_pIndexBufferArray[iIB].SizeBytes;
+}
+
 //--------------------------------------------------------------------------------------
 BYTE* SDKMesh::GetRawVerticesAt( UINT iVB )
 {
@@ -266,6 +266,9 @@ private:
     //BYTE*                         m_pBufferData;
     HANDLE m_hFile;
     HANDLE m_hFileMappingObject;
+    BYTE* m_pMappedView;
+    bool m_bStreaming;
+    bool m_bCreateAdjacencyIndices;
     std::vector<BYTE*> m_MappedPointers;    
 
 protected:
@@ -299,6 +302,12 @@ protected:
     virtual HRESULT                 CreateFromFile( LPCWSTR szFileName,
                                                     bool bCreateAdjacencyIndices);
 
+    virtual HRESULT                 CreateFromMappedFile( LPCWSTR szFileName,
+                                                          bool bCreateAdjacencyIndices);
+
+    virtual HRESULT                 CreateStreamingFromFile( LPCWSTR szFileName,
+                                                             bool bCreateAdjacencyIndices);
+
     virtual HRESULT                 CreateFromMemory( BYTE* pData,
                                                       UINT DataBytes,
                                                       bool bCreateAdjacencyIndices,
@@ -307,7 +316,9 @@ public:
                                     SDKMesh();
     virtual                         ~SDKMesh();
 
-    virtual HRESULT                 Create( LPCWSTR szFileName, bool bCreateAdjacencyIndices = false );
+    virtual HRESULT                 Create( LPCWSTR szFileName, bool bCreateAdjacencyIndices = false,
+                                            bool bMemoryMap = false );
+    virtual HRESULT                 CreateStreaming( LPCWSTR szFileName, bool bCreateAdjacencyIndices = false );
     virtual HRESULT                 Create( BYTE* pData, UINT DataBytes,
                                             bool bCreateAdjacencyIndices = false, bool bCopyStatic = false );                                                
     virtual void                    Destroy();
@@ -324,6 +335,17 @@ public:
     UINT                            GetNumVBs();
     UINT                            GetNumIBs();
 
+    // These return NULL for a streaming mesh, where the buffer data stays in the file
+    // until it's read with ReadVertexData/ReadIndexData
+    bool                            IsStreaming() { return m_bStreaming; }
+    HRESULT                         ReadVertexData( UINT iVB, UINT64 Offset, void* pDest, UINT64 NumBytes );
+    HRESULT                         ReadIndexData( UINT iIB, UINT64 Offset, void* pDest, UINT64 NumBytes );
+    UINT64                          GetVertexBufferSize( UINT iVB );
+    UINT64                          GetIndexBufferSize( UINT iIB );
+
+    // Whether the mesh was created with bCreateAdjacencyIndices
+    bool                            AdjacencyIndicesRequested() { return m_bCreateAdjacencyIndices; }
+
     BYTE* GetRawVerticesAt( UINT iVB );
     BYTE* GetRawIndicesAt( UINT iIB );
     SDKMESH_MATERIAL* GetMaterial( UINT iMaterial );
@@ -337,7 +359,7 @@ public:
     UINT64                          GetNumVertices( UINT iMesh, UINT iVB );
     UINT64                          GetNumIndices( UINT iMesh );
 
-    const D3DVERTEXELEMENT9*        VBElements( UINT iVB ) { return m_pVertexBufferArray[0].Decl; }
+    const D3DVERTEXELEMENT9*        VBElements( UINT iVB ) { return m_pVertexBufferArray[iVB].Decl; }
 };
 
 
@@ -100,6 +100,101 @@ VSOutput SpriteInstancedVS(in VSInputInstanced input)
                             transpose(input.Transform), input.Color, input.SourceRect); 
 }
 
+//======================================================================================
+// Vertex Shader, GPU text layout
+//======================================================================================
+
+// Matches the glyph table built by SpriteFont. Metrics is (OffsetX, OffsetY, Advance).
+struct GPUGlyph
+{
+    float4 DrawRect;
+    float4 Metrics;
+};
+
+// Matches GPUTextLine in SpriteRenderer.h, where the character indices are stored as floats
+struct GPUTextLine
+{
+    float4x4 Transform;
+    float4 Color;
+    uint FirstChar;
+    uint NumChars;
+    float PenY;
+};
+
+cbuffer GPUTextPerBatch : register (b2)
+{
+    uint NumTextLines;
+    uint NumGlyphTableEntries;
+}
+
+// The glyphs, pen positions and line headers are read as float4's from typed buffers, so that this
+// shader doesn't need structured buffers and runs on feature level 10 hardware
+Buffer<float4> GlyphTable : register(t0);
+Buffer<float4> TextLines : register(t1);
+Buffer<uint> TextChars : register(t2);
+Buffer<float> TextPenX : register(t3);
+
+static const uint GlyphStride = 2;
+static const uint TextLineStride = 6;
+
+GPUGlyph LoadGlyph(uint charIdx)
+{
+    uint character = min(TextChars[charIdx], NumGlyphTableEntries - 1);
+
+    GPUGlyph glyph;
+    glyph.DrawRect = GlyphTable[character * GlyphStride + 0];
+    glyph.Metrics = GlyphTable[character * GlyphStride + 1];
+    return glyph;
+}
+
+uint LoadLineFirstChar(uint lineIdx)
+{
+    return uint(TextLines[lineIdx * TextLineStride + 5].x);
+}
+
+GPUTextLine LoadTextLine(uint lineIdx)
+{
+    uint base = lineIdx * TextLineStride;
+
+    GPUTextLine textLine;
+    textLine.Transform = float4x4(TextLines[base + 0], TextLines[base + 1],
+                                  TextLines[base + 2], TextLines[base + 3]);
+    textLine.Color = TextLines[base + 4];
+
+    float4 lineInfo = TextLines[base + 5];
+    textLine.FirstChar = uint(lineInfo.x);
+    textLine.NumChars = uint(lineInfo.y);
+    textLine.PenY = lineInfo.z;
+    return textLine;
+}
+
+// One instance per character. The line is found with a binary search over the line
+// headers, and the pen position was summed up on the CPU when the line was queued.
+VSOutput GPUTextVS(in VSInput input, in uint charIdx : SV_InstanceID)
+{
+    uint lo = 0;
+    uint hi = NumTextLines;
+    while (hi - lo > 1)
+    {
+        uint mid = (lo + hi) / 2;
+        if (LoadLineFirstChar(mid) <= charIdx)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    GPUTextLine textLine = LoadTextLine(lo);
+
+    float penX = TextPenX[charIdx];
+
+    // Translate to the glyph's position in text space, before the line's transform
+    GPUGlyph glyph = LoadGlyph(charIdx);
+    float2 offset = float2(penX + glyph.Metrics.x, textLine.PenY + glyph.Metrics.y);
+    float4x4 transform = textLine.Transform;
+    transform[3] += offset.x * transform[0] + offset.y * transform[1];
+
+    return SpriteVSCommon(input.Position, input.TexCoord, transform, textLine.Color, glyph.DrawRect);
+}
+
 //======================================================================================
 // Pixel Shader
 //======================================================================================
@@ -110,3 +205,122 @@ float4 SpritePS(in VSOutput input) : SV_Target
     texColor.rgb *= texColor.a;
     return texColor;
 }
+
+// Glyphs from distance field fonts store the distance to the edge in alpha, with
+// 0.5 on the edge. The edge is antialiased over one pixel, so that the glyphs stay
+// sharp at any scale.
+float4 SpriteDistanceFieldPS(in VSOutput input) : SV_Target
+{
+    float4 texColor = SpriteTexture.Sample(SpriteSampler, input.TexCoord);
+    float distance = texColor.a;
+    float coverage = saturate((distance - 0.5f) / max(fwidth(distance), 0.0001f) + 0.5f);
+    texColor.a = coverage;
+    texColor = texColor * input.Color;
+    texColor.rgb *= texColor.a;
+    return texColor;
+}
+
+//======================================================================================
+// Untextured primitives
+//======================================================================================
+
+static const uint PrimitiveRect = 0;
+static const uint PrimitiveLine = 1;
+static const uint PrimitiveCircle = 2;
+
+struct VSInputPrimitive
+{
+    float2 Position : POSITION;
+    float2 TexCoord : TEXCOORD;
+    float2 Position0 : PRIMPOSITION0;
+    float2 Position1 : PRIMPOSITION1;
+    float4 Color : COLOR;
+    uint Type : PRIMTYPE;
+    float Thickness : THICKNESS;
+};
+
+struct VSOutputPrimitive
+{
+    float4 Position : SV_Position;
+    float2 LocalPos : LOCALPOS;
+    nointerpolation float2 HalfSize : HALFSIZE;
+    nointerpolation float4 Color : COLOR;
+    nointerpolation uint Type : PRIMTYPE;
+    nointerpolation float Thickness : THICKNESS;
+};
+
+VSOutputPrimitive PrimitiveVS(in VSInputPrimitive input)
+{
+    float2 center;
+    float2 halfSize;
+    float2 extent;
+    float2 axisX = float2(1.0f, 0.0f);
+    float2 axisY = float2(0.0f, 1.0f);
+
+    if (input.Type == PrimitiveLine)
+    {
+        // Orient the quad along the line, and expand it by the thickness
+        float2 dir = input.Position1 - input.Position0;
+        float len = length(dir);
+        axisX = len > 0.0f ? dir / len : float2(1.0f, 0.0f);
+        axisY = float2(-axisX.y, axisX.x);
+        center = (input.Position0 + input.Position1) * 0.5f;
+        halfSize = float2(len, input.Thickness) * 0.5f;
+        extent = halfSize;
+    }
+    else if (input.Type == PrimitiveCircle)
+    {
+        // Pad by a pixel so that the anti-aliased edge doesn't get clipped
+        center = input.Position0;
+        halfSize = input.Position1.xx;
+        extent = halfSize + 1.0f;
+    }
+    else
+    {
+        center = (input.Position0 + input.Position1) * 0.5f;
+        halfSize = abs(input.Position1 - input.Position0) * 0.5f;
+        extent = halfSize;
+    }
+
+    float2 localPos = (input.Position * 2.0f - 1.0f) * extent;
+    float2 positionSS = center + axisX * localPos.x + axisY * localPos.y;
+
+    // Scale by the viewport size, flip Y, then rescale to device coordinates
+    float4 positionDS = float4(positionSS / ViewportSize, 0.0f, 1.0f);
+    positionDS = positionDS * 2 - 1;
+    positionDS.y *= -1;
+
+    VSOutputPrimitive output;
+    output.Position = positionDS;
+    output.LocalPos = localPos;
+    output.HalfSize = halfSize;
+    output.Color = input.Color;
+    output.Type = input.Type;
+    output.Thickness = input.Thickness;
+
+    return output;
+}
+
+float4 PrimitivePS(in VSOutputPrimitive input) : SV_Target
+{
+    float coverage = 1.0f;
+    if (input.Type == PrimitiveCircle)
+    {
+        float dist = length(input.LocalPos);
+        float radius = input.HalfSize.x;
+        coverage = saturate(radius - dist + 0.5f);
+        if (input.Thickness > 0.0f)
+            coverage *= saturate(dist - (radius - input.Thickness) + 0.5f);
+    }
+    else if (input.Type == PrimitiveRect && input.Thickness > 0.0f)
+    {
+        // Outlines only keep the pixels that are within the thickness of an edge
+        float2 edgeDist = input.HalfSize - abs(input.LocalPos);
+        coverage = min(edgeDist.x, edgeDist.y) < input.Thickness ? 1.0f : 0.0f;
+    }
+
+    float4 color = input.Color;
+    color.a *= coverage;
+    color.rgb *= color.a;
+    return color;
+}
@@ -0,0 +1,20 @@
+//=================================================================================================
+// Decoders for the compressed vertex formats made by Mesh, when it's created with
+// compressVertices = true. TEXCOORD is R16G16_FLOAT, so it needs no decoding.
+//=================================================================================================
+
+// POSITION is R16G16B16A16_UNORM relative to the bounding box. Pass Mesh::PositionScale()
+// and Mesh::PositionOffset() in a constant buffer, or fold them into the world matrix.
+float3 DecodePosition(in float4 quantized, in float3 positionScale, in float3 positionOffset)
+{
+    return positionOffset + quantized.xyz * positionScale;
+}
+
+// NORMAL, TANGENT and BINORMAL are R16G16_SNORM octahedral encodings
+float3 DecodeOctahedral(in float2 encoded)
+{
+    float3 v = float3(encoded.xy, 1.0f - abs(encoded.x) - abs(encoded.y));
+    if (v.z < 0.0f)
+        v.xy = (1.0f - abs(v.yx)) * (v.xy >= 0.0f ? 1.0f : -1.0f);
+    return normalize(v);
+}
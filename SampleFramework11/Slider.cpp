@@ -12,6 +12,7 @@
 #include "PCH.h"
 
 #include "Slider.h"
+#include "FontRegistry.h"
 
 #include "Utility.h"
 
@@ -34,8 +35,44 @@ Slider::~Slider()
 {
 }
 
-void Slider::Initalize(ID3D11Device* device)
+static const WCHAR* BarImageName = L"SliderBar";
+static const WCHAR* KnobImageName = L"SliderKnob";
+static const WCHAR* BarImagePath = L"SampleFramework11\\Images\\SliderBar.png";
+static const WCHAR* KnobImagePath = L"SampleFramework11\\Images\\SliderKnob.png";
+
+static std::shared_ptr<SpriteFont> GetSliderFont(ID3D11Device* device)
 {
+    return FontRegistry::GetFont(L"Microsoft Sans Serif", 8.5f, SpriteFont::Regular, true, device);
+}
+
+void Slider::AddToAtlas(TextureAtlas& atlas, ID3D11Device* device)
+{
+    atlas.AddImage(BarImageName, BarImagePath, device);
+    atlas.AddImage(KnobImageName, KnobImagePath, device);
+    atlas.AddFont(GetSliderFont(device));
+}
+
+void Slider::Initalize(ID3D11Device* device, const TextureAtlas* atlas)
+{
+    // All sliders share one font
+    font = GetSliderFont(device);
+
+    enabled = true;
+
+    // Use the images from the atlas if we have one, so that sliders can be
+    // batched with any other sprites that use it
+    if (atlas != NULL)
+    {
+        barTexture = atlas->SRView();
+        knobTexture = atlas->SRView();
+        barRect = atlas->GetRect(BarImageName);
+        knobRect = atlas->GetRect(KnobImageName);
+
+        // The labels use the atlas's copy of the font too, so that they don't break the batch
+        font.reset(new SpriteFont(atlas->GetFont(*font)));
+        return;
+    }
+
     // Load the texures
     D3DX11_IMAGE_LOAD_INFO info;
     info.Format = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
@@ -53,12 +90,13 @@ void Slider::Initalize(ID3D11Device* device)
     info.MipFilter = D3DX11_DEFAULT;
     info.pSrcInfo = NULL;
 
-    DXCall(D3DX11CreateShaderResourceViewFromFileW(device, L"SampleFramework11\\Images\\SliderBar.png", &info, NULL, &barTexture, NULL));
-    DXCall(D3DX11CreateShaderResourceViewFromFileW(device, L"SampleFramework11\\Images\\SliderKnob.png", &info, NULL, &knobTexture, NULL));
+    DXCall(D3DX11CreateShaderResourceViewFromFileW(device, BarImagePath, &info, NULL, &barTexture, NULL));
+    DXCall(D3DX11CreateShaderResourceViewFromFileW(device, KnobImagePath, &info, NULL, &knobTexture, NULL));
 
-    font.Initialize(L"Microsoft Sans Serif", 8.5f, SpriteFont::Regular, true, device);
-
-    enabled = true;
+    D3D11_TEXTURE2D_DESC desc = SpriteRenderer::GetTextureDesc(barTexture);
+    barRect = XMFLOAT4(0, 0, static_cast<float>(desc.Width), static_cast<float>(desc.Height));
+    desc = SpriteRenderer::GetTextureDesc(knobTexture);
+    knobRect = XMFLOAT4(0, 0, static_cast<float>(desc.Width), static_cast<float>(desc.Height));
 }
 
 void Slider::CalcValue(float normalizedValue)
@@ -134,26 +172,31 @@ void Slider::Render(SpriteRenderer& renderer)
 
     float alpha = enabled ? 1.0f : 0.35f;
 
-    // Render the bar
-    XMMATRIX transform = XMMatrixScaling(size.x / TextureWidth, size.y / TextureHeight, 1.0f);
-    transform._41 = position.x;
-    transform._42 = position.y;
-    renderer.Render(barTexture, transform, XMFLOAT4(1, 1, 1, alpha));
+    // Render the bar and knob as batched sprites, so that they can be drawn
+    // together when they come from the same atlas
+    SpriteRenderer::SpriteDrawData bar;
+    bar.Transform = XMMatrixScaling(size.x / TextureWidth, size.y / TextureHeight, 1.0f);
+    bar.Transform._41 = position.x;
+    bar.Transform._42 = position.y;
+    bar.Color = XMFLOAT4(1, 1, 1, alpha);
+    bar.DrawRect = barRect;
+    renderer.RenderBatch(barTexture, &bar, 1);
 
-    // Render the knob
     XMFLOAT4 knobBounds = GetKnobBounds();
-    transform = XMMatrixScaling(knobBounds.w, knobBounds.z, 1.0f);
-    transform._41 = knobBounds.x;
-    transform._42 = knobBounds.y;
-    XMFLOAT4 knobColor = hover ? XMFLOAT4(1.5f, 1.5f, 1.5f, alpha) : XMFLOAT4(1, 1, 1, alpha);
-    renderer.Render(knobTexture, transform, knobColor);
+    SpriteRenderer::SpriteDrawData knob;
+    knob.Transform = XMMatrixScaling(knobBounds.w, knobBounds.z, 1.0f);
+    knob.Transform._41 = knobBounds.x;
+    knob.Transform._42 = knobBounds.y;
+    knob.Color = hover ? XMFLOAT4(1.5f, 1.5f, 1.5f, alpha) : XMFLOAT4(1, 1, 1, alpha);
+    knob.DrawRect = knobRect;
+    renderer.RenderBatch(knobTexture, &knob, 1);
 
-    transform = XMMatrixTranslation(position.x, position.y + size.y - 12.0f, 0);
-    renderer.RenderText(font, name.c_str(), transform, XMFLOAT4(1, 1, 1, alpha));
+    XMMATRIX transform = XMMatrixTranslation(position.x, position.y + size.y - 12.0f, 0);
+    renderer.RenderText(*font, name.c_str(), transform, XMFLOAT4(1, 1, 1, alpha));
 
     std::wstring valString = ToString(value);
     transform = XMMatrixTranslation(position.x + size.x + 16.0f, position.y - 4.0f, 0);
-    renderer.RenderText(font, valString.c_str(), transform, XMFLOAT4(1, 1, 1, alpha));
+    renderer.RenderText(*font, valString.c_str(), transform, XMFLOAT4(1, 1, 1, alpha));
 }
 
 }
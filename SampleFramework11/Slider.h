@@ -14,6 +14,7 @@
 #include "InterfacePointers.h"
 #include "GUIObject.h"
 #include "SpriteFont.h"
+#include "TextureAtlas.h"
 
 namespace SampleFramework11
 {
@@ -28,7 +29,10 @@ public:
     Slider();
     ~Slider();
 
-    void Initalize(ID3D11Device* device);
+    // Adds the slider images and font to an atlas, so that sliders can be initialized from it
+    static void AddToAtlas(TextureAtlas& atlas, ID3D11Device* device);
+
+    void Initalize(ID3D11Device* device, const TextureAtlas* atlas = NULL);
 
     void Update(UINT mousePosX, UINT mousePosY, bool mouseLButtonDown);
     void Render(SpriteRenderer& renderer);
@@ -59,7 +63,7 @@ protected:
     UINT numSteps;
     float value;
     std::wstring name;
-    SpriteFont font;
+    std::shared_ptr<SpriteFont> font;
     bool dragging;
     float dragValue;
     bool hover;
@@ -68,6 +72,8 @@ protected:
 
     ID3D11ShaderResourceViewPtr barTexture;
     ID3D11ShaderResourceViewPtr knobTexture;
+    XMFLOAT4 barRect;
+    XMFLOAT4 knobRect;
 
     XMFLOAT4 GetKnobBounds();
     void CalcValue(float normalizedValue);
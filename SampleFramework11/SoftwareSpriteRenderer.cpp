@@ -0,0 +1,686 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "PCH.h"
+
+#include "SoftwareSpriteRenderer.h"
+#include "SpriteCommandBuffer.h"
+#include "Exceptions.h"
+#include "Utility.h"
+#include "Parallel.h"
+
+namespace SampleFramework11
+{
+
+// Corners of the sprite quad, in the order of the vertex buffer in SpriteRenderer
+static const float QuadX[4] = { 0.0f, 1.0f, 1.0f, 0.0f };
+static const float QuadY[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+// Vertex positions are snapped to 1/256th of a pixel, like D3D11 rasterizers do
+static const INT64 SubPixelSteps = 256;
+static const float MaxCoordinate = 1048576.0f;
+
+static XMFLOAT4 UnpackR8G8B8A8(UINT color)
+{
+    return XMFLOAT4((color & 0xFF) / 255.0f, ((color >> 8) & 0xFF) / 255.0f,
+                    ((color >> 16) & 0xFF) / 255.0f, (color >> 24) / 255.0f);
+}
+
+static XMFLOAT4 UnpackB8G8R8A8(UINT color)
+{
+    return XMFLOAT4(((color >> 16) & 0xFF) / 255.0f, ((color >> 8) & 0xFF) / 255.0f,
+                    (color & 0xFF) / 255.0f, (color >> 24) / 255.0f);
+}
+
+static UINT ToUNorm8(float x)
+{
+    return static_cast<UINT>(Clamp(x, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static UINT PackR8G8B8A8(const XMFLOAT4& color)
+{
+    return ToUNorm8(color.x) | (ToUNorm8(color.y) << 8) | (ToUNorm8(color.z) << 16) | (ToUNorm8(color.w) << 24);
+}
+
+static float SRGBToLinear(float x)
+{
+    return x <= 0.04045f ? x / 12.92f : std::pow((x + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSRGB(float x)
+{
+    x = Clamp(x, 0.0f, 1.0f);
+    return x <= 0.0031308f ? x * 12.92f : 1.055f * std::pow(x, 1.0f / 2.4f) - 0.055f;
+}
+
+// Alpha is always linear in sRGB formats
+static XMFLOAT4 SRGBToLinear(const XMFLOAT4& color)
+{
+    return XMFLOAT4(SRGBToLinear(color.x), SRGBToLinear(color.y), SRGBToLinear(color.z), color.w);
+}
+
+static XMFLOAT4 LinearToSRGB(const XMFLOAT4& color)
+{
+    return XMFLOAT4(LinearToSRGB(color.x), LinearToSRGB(color.y), LinearToSRGB(color.z), color.w);
+}
+
+static UINT SwapRedBlue(UINT color)
+{
+    return (color & 0xFF00FF00) | ((color >> 16) & 0xFF) | ((color & 0xFF) << 16);
+}
+
+SoftwareSpriteRenderer::SoftwareSpriteRenderer()
+    : width(0),
+      height(0),
+      numTilesX(0),
+      numTilesY(0),
+      srgbTarget(false)
+{
+
+}
+
+SoftwareSpriteRenderer::~SoftwareSpriteRenderer()
+{
+
+}
+
+void SoftwareSpriteRenderer::Initialize(UINT width, UINT height, bool srgbTarget)
+{
+    _ASSERT(width > 0 && height > 0);
+
+    this->width = width;
+    this->height = height;
+    this->srgbTarget = srgbTarget;
+    numTilesX = (width + TileSize - 1) / TileSize;
+    numTilesY = (height + TileSize - 1) / TileSize;
+    pixels.assign(width * height, 0);
+    tileBins.clear();
+    tileBins.resize(numTilesX * numTilesY);
+}
+
+void SoftwareSpriteRenderer::Clear(const XMFLOAT4& color)
+{
+    std::fill(pixels.begin(), pixels.end(), PackR8G8B8A8(srgbTarget ? LinearToSRGB(color) : color));
+}
+
+void SoftwareSpriteRenderer::SetTexture(ID3D11ShaderResourceView* texture, UINT width, UINT height,
+                                        const UINT* texels, UINT pitch)
+{
+    _ASSERT(texture);
+    _ASSERT(width > 0 && height > 0);
+
+    // Textures sampled through an sRGB view are converted to linear before filtering
+    D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
+    texture->GetDesc(&srDesc);
+
+    Texture& tex = textures[texture];
+    tex.Width = width;
+    tex.Height = height;
+    tex.SRGB = srDesc.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+    tex.Texels.resize(width * height);
+
+    const BYTE* src = reinterpret_cast<const BYTE*>(texels);
+    for (UINT y = 0; y < height; ++y)
+        memcpy(&tex.Texels[y * width], src + y * pitch, width * sizeof(UINT));
+}
+
+void SoftwareSpriteRenderer::SetTexture(ID3D11ShaderResourceView* texture, ID3D11Device* device,
+                                        ID3D11DeviceContext* context)
+{
+    D3D11_TEXTURE2D_DESC desc = SpriteRenderer::GetTextureDesc(texture);
+    if (desc.Format != DXGI_FORMAT_B8G8R8A8_UNORM && desc.Format != DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+        && desc.Format != DXGI_FORMAT_B8G8R8A8_TYPELESS)
+        throw Exception(L"SoftwareSpriteRenderer only supports textures with a B8G8R8A8 format");
+
+    // Copy the top mip level into a staging texture, so that we can read it
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Usage = D3D11_USAGE_STAGING;
+    desc.BindFlags = 0;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    desc.MiscFlags = 0;
+    ID3D11Texture2DPtr stagingTexture;
+    DXCall(device->CreateTexture2D(&desc, NULL, &stagingTexture));
+
+    ID3D11ResourcePtr resource;
+    texture->GetResource(&resource);
+    context->CopySubresourceRegion(stagingTexture, 0, 0, 0, 0, resource, 0, NULL);
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    DXCall(context->Map(stagingTexture, 0, D3D11_MAP_READ, 0, &mapped));
+    SetTexture(texture, desc.Width, desc.Height, reinterpret_cast<const UINT*>(mapped.pData), mapped.RowPitch);
+    context->Unmap(stagingTexture, 0);
+}
+
+void SoftwareSpriteRenderer::Submit(const SpriteCommandBuffer& commandBuffer)
+{
+    submittedBuffers.push_back(&commandBuffer);
+}
+
+void SoftwareSpriteRenderer::Execute(SpriteRenderer::FilterMode filterMode)
+{
+    _ASSERT(width > 0 && height > 0);
+
+    std::vector<const SpriteCommandBuffer*> buffers;
+    buffers.swap(submittedBuffers);
+    SpriteCommandBuffer::SortForDrawing(buffers);
+
+    if (filterMode == SpriteRenderer::DontSet)
+        filterMode = SpriteRenderer::Linear;
+
+    // Run the vertex processing for every sprite and primitive
+    drawItems.clear();
+    for (size_t bufferIdx = 0; bufferIdx < buffers.size(); ++bufferIdx)
+    {
+        const SpriteCommandBuffer& buffer = *buffers[bufferIdx];
+        const std::vector<SpriteCommandBuffer::Command>& commands = buffer.Commands();
+        for (size_t cmdIdx = 0; cmdIdx < commands.size(); ++cmdIdx)
+        {
+            const SpriteCommandBuffer::Command& command = commands[cmdIdx];
+            if (command.Texture == NULL)
+            {
+                const SpriteRenderer::PrimitiveInstance* primitives = buffer.Primitives() + command.FirstSprite;
+                for (UINT64 i = 0; i < command.NumSprites; ++i)
+                    AddPrimitive(primitives[i]);
+            }
+            else
+            {
+                std::map<ID3D11ShaderResourceView*, Texture>::const_iterator texture = textures.find(command.Texture);
+                if (texture == textures.end())
+                    throw Exception(L"SoftwareSpriteRenderer has no texture data for a texture used by a command buffer");
+
+                const SpriteRenderer::SpriteDrawData* sprites = buffer.Sprites() + command.FirstSprite;
+                for (UINT64 i = 0; i < command.NumSprites; ++i)
+                    AddSprite(sprites[i], texture->second, command.DistanceField);
+            }
+        }
+    }
+
+    // Bin the items into the tiles that they overlap, keeping them in draw order
+    for (size_t i = 0; i < tileBins.size(); ++i)
+        tileBins[i].clear();
+
+    for (UINT itemIdx = 0; itemIdx < drawItems.size(); ++itemIdx)
+    {
+        const DrawItem& item = drawItems[itemIdx];
+        UINT startTileX = item.MinX / TileSize;
+        UINT startTileY = item.MinY / TileSize;
+        UINT endTileX = (item.MaxX - 1) / TileSize;
+        UINT endTileY = (item.MaxY - 1) / TileSize;
+        for (UINT tileY = startTileY; tileY <= endTileY; ++tileY)
+            for (UINT tileX = startTileX; tileX <= endTileX; ++tileX)
+                tileBins[tileY * numTilesX + tileX].push_back(itemIdx);
+    }
+
+    // Every tile only touches its own pixels, so they can all be rendered in parallel
+    ParallelFor(0, tileBins.size(), [&](size_t tileIdx)
+    {
+        RenderTile(static_cast<UINT>(tileIdx % numTilesX), static_cast<UINT>(tileIdx / numTilesX), filterMode);
+    });
+}
+
+// Same as SpriteVSCommon: scale the quad so that it's the size of the source rect,
+// transform it, and compute the texture coordinates from the source rect
+void SoftwareSpriteRenderer::AddSprite(const SpriteRenderer::SpriteDrawData& sprite, const Texture& texture,
+                                       bool distanceField)
+{
+    const XMMATRIX& m = sprite.Transform;
+    const XMFLOAT4& sourceRect = sprite.DrawRect;
+    const float texWidth = static_cast<float>(texture.Width);
+    const float texHeight = static_cast<float>(texture.Height);
+
+    DrawItem item;
+    XMFLOAT4 positionsSS[4];
+    for (UINT i = 0; i < 4; ++i)
+    {
+        float x = QuadX[i] * sourceRect.z;
+        float y = QuadY[i] * sourceRect.w;
+        positionsSS[i].x = x * m._11 + y * m._21 + m._41;
+        positionsSS[i].y = x * m._12 + y * m._22 + m._42;
+        positionsSS[i].z = x * m._13 + y * m._23 + m._43;
+        positionsSS[i].w = x * m._14 + y * m._24 + m._44;
+
+        item.Attributes[i].x = QuadX[i] * (sourceRect.z / texWidth) + sourceRect.x / texWidth;
+        item.Attributes[i].y = QuadY[i] * (sourceRect.w / texHeight) + sourceRect.y / texHeight;
+    }
+
+    item.Color = sprite.Color;
+    item.Tex = &texture;
+    item.DistanceField = distanceField;
+    item.PrimitiveType = 0;
+    item.Thickness = 0.0f;
+    item.HalfSize = XMFLOAT2(0.0f, 0.0f);
+    AddQuad(item, positionsSS);
+}
+
+// Same as PrimitiveVS
+void SoftwareSpriteRenderer::AddPrimitive(const SpriteRenderer::PrimitiveInstance& primitive)
+{
+    const XMFLOAT2& p0 = primitive.Position0;
+    const XMFLOAT2& p1 = primitive.Position1;
+    const float thickness = XMConvertHalfToFloat(primitive.Thickness);
+
+    XMFLOAT2 center;
+    XMFLOAT2 halfSize;
+    XMFLOAT2 extent;
+    XMFLOAT2 axisX(1.0f, 0.0f);
+    XMFLOAT2 axisY(0.0f, 1.0f);
+    if (primitive.Type == SpriteRenderer::PrimitiveLine)
+    {
+        float dirX = p1.x - p0.x;
+        float dirY = p1.y - p0.y;
+        float len = std::sqrt(dirX * dirX + dirY * dirY);
+        if (len > 0.0f)
+            axisX = XMFLOAT2(dirX / len, dirY / len);
+        axisY = XMFLOAT2(-axisX.y, axisX.x);
+        center = XMFLOAT2((p0.x + p1.x) * 0.5f, (p0.y + p1.y) * 0.5f);
+        halfSize = XMFLOAT2(len * 0.5f, thickness * 0.5f);
+        extent = halfSize;
+    }
+    else if (primitive.Type == SpriteRenderer::PrimitiveCircle)
+    {
+        center = p0;
+        halfSize = XMFLOAT2(p1.x, p1.x);
+        extent = XMFLOAT2(halfSize.x + 1.0f, halfSize.y + 1.0f);
+    }
+    else
+    {
+        center = XMFLOAT2((p0.x + p1.x) * 0.5f, (p0.y + p1.y) * 0.5f);
+        halfSize = XMFLOAT2(std::abs(p1.x - p0.x) * 0.5f, std::abs(p1.y - p0.y) * 0.5f);
+        extent = halfSize;
+    }
+
+    DrawItem item;
+    XMFLOAT4 positionsSS[4];
+    for (UINT i = 0; i < 4; ++i)
+    {
+        XMFLOAT2 localPos((QuadX[i] * 2.0f - 1.0f) * extent.x, (QuadY[i] * 2.0f - 1.0f) * extent.y);
+        positionsSS[i].x = center.x + axisX.x * localPos.x + axisY.x * localPos.y;
+        positionsSS[i].y = center.y + axisX.y * localPos.x + axisY.y * localPos.y;
+        positionsSS[i].z = 0.0f;
+        positionsSS[i].w = 1.0f;
+        item.Attributes[i] = localPos;
+    }
+
+    item.Color = UnpackR8G8B8A8(primitive.Color);
+    item.Tex = NULL;
+    item.DistanceField = false;
+    item.PrimitiveType = primitive.Type;
+    item.Thickness = thickness;
+    item.HalfSize = halfSize;
+    AddQuad(item, positionsSS);
+}
+
+// Converts the screen space corners of a quad to device coordinates the same way
+// as the vertex shaders, then applies the viewport transform and snaps them
+void SoftwareSpriteRenderer::AddQuad(DrawItem& item, const XMFLOAT4* positionsSS)
+{
+    const float vpWidth = static_cast<float>(width);
+    const float vpHeight = static_cast<float>(height);
+
+    INT64 minX = LLONG_MAX;
+    INT64 minY = LLONG_MAX;
+    INT64 maxX = LLONG_MIN;
+    INT64 maxY = LLONG_MIN;
+    for (UINT i = 0; i < 4; ++i)
+    {
+        // Scale by the viewport size, flip Y, then rescale to device coordinates
+        XMFLOAT4 positionDS = positionsSS[i];
+        positionDS.x = (positionDS.x / vpWidth) * 2 - 1;
+        positionDS.y = -((positionDS.y / vpHeight) * 2 - 1);
+        positionDS.w = positionDS.w * 2 - 1;
+
+        // Quads that cross the w = 0 plane would need clipping, which never
+        // happens with 2D transforms
+        if (positionDS.w <= 0.0f)
+            return;
+
+        float x = (positionDS.x / positionDS.w + 1.0f) * 0.5f * vpWidth;
+        float y = (1.0f - positionDS.y / positionDS.w) * 0.5f * vpHeight;
+        x = Clamp(x, -MaxCoordinate, MaxCoordinate);
+        y = Clamp(y, -MaxCoordinate, MaxCoordinate);
+
+        item.X[i] = static_cast<INT64>(std::floor(x * SubPixelSteps + 0.5f));
+        item.Y[i] = static_cast<INT64>(std::floor(y * SubPixelSteps + 0.5f));
+        minX = min(minX, item.X[i]);
+        minY = min(minY, item.Y[i]);
+        maxX = max(maxX, item.X[i]);
+        maxY = max(maxY, item.Y[i]);
+    }
+
+    // Pixel bounds, clipped to the target
+    item.MinX = static_cast<int>(max(minX / SubPixelSteps - 1, 0LL));
+    item.MinY = static_cast<int>(max(minY / SubPixelSteps - 1, 0LL));
+    item.MaxX = static_cast<int>(min(maxX / SubPixelSteps + 1, static_cast<INT64>(width)));
+    item.MaxY = static_cast<int>(min(maxY / SubPixelSteps + 1, static_cast<INT64>(height)));
+    if (item.MinX >= item.MaxX || item.MinY >= item.MaxY)
+        return;
+
+    drawItems.push_back(item);
+}
+
+void SoftwareSpriteRenderer::RenderTile(UINT tileX, UINT tileY, SpriteRenderer::FilterMode filterMode)
+{
+    const int tileMinX = tileX * TileSize;
+    const int tileMinY = tileY * TileSize;
+    const int tileMaxX = min(tileMinX + static_cast<int>(TileSize), static_cast<int>(width));
+    const int tileMaxY = min(tileMinY + static_cast<int>(TileSize), static_cast<int>(height));
+
+    const std::vector<UINT>& bin = tileBins[tileY * numTilesX + tileX];
+    for (size_t i = 0; i < bin.size(); ++i)
+    {
+        const DrawItem& item = drawItems[bin[i]];
+        int minX = max(item.MinX, tileMinX);
+        int minY = max(item.MinY, tileMinY);
+        int maxX = min(item.MaxX, tileMaxX);
+        int maxY = min(item.MaxY, tileMaxY);
+
+        // Same triangles as the index buffer in SpriteRenderer
+        RasterizeTriangle(item, 0, 1, 2, minX, minY, maxX, maxY, filterMode);
+        RasterizeTriangle(item, 3, 0, 2, minX, minY, maxX, maxY, filterMode);
+    }
+}
+
+void SoftwareSpriteRenderer::RasterizeTriangle(const DrawItem& item, UINT i0, UINT i1, UINT i2,
+                                               int minX, int minY, int maxX, int maxY,
+                                               SpriteRenderer::FilterMode filterMode)
+{
+    // Culling is disabled, so flip back-facing triangles around
+    INT64 area = (item.X[i1] - item.X[i0]) * (item.Y[i2] - item.Y[i0]) - (item.Y[i1] - item.Y[i0]) * (item.X[i2] - item.X[i0]);
+    if (area == 0)
+        return;
+    if (area < 0)
+    {
+        std::swap(i1, i2);
+        area = -area;
+    }
+
+    // Set up the edge functions, where edge e is opposite vertex e. Pixels
+    // exactly on an edge are only included for top and left edges.
+    const UINT verts[3] = { i0, i1, i2 };
+    INT64 rowValues[3];
+    INT64 stepX[3];
+    INT64 stepY[3];
+    INT64 bias[3];
+    const INT64 startX = minX * SubPixelSteps + SubPixelSteps / 2;
+    const INT64 startY = minY * SubPixelSteps + SubPixelSteps / 2;
+    for (UINT e = 0; e < 3; ++e)
+    {
+        UINT a = verts[(e + 1) % 3];
+        UINT b = verts[(e + 2) % 3];
+        INT64 dx = item.X[b] - item.X[a];
+        INT64 dy = item.Y[b] - item.Y[a];
+        bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+        bias[e] = topLeft ? 0 : -1;
+        rowValues[e] = dx * (startY - item.Y[a]) - dy * (startX - item.X[a]) + bias[e];
+        stepX[e] = -dy * SubPixelSteps;
+        stepY[e] = dx * SubPixelSteps;
+    }
+
+    const float invArea = 1.0f / static_cast<float>(area);
+    const XMFLOAT2& a0 = item.Attributes[i0];
+    const XMFLOAT2& a1 = item.Attributes[i1];
+    const XMFLOAT2& a2 = item.Attributes[i2];
+
+    // The attributes are affine, so their change from one pixel to the next is constant
+    XMFLOAT2 ddxAttributes((stepX[0] * a0.x + stepX[1] * a1.x + stepX[2] * a2.x) * invArea,
+                           (stepX[0] * a0.y + stepX[1] * a1.y + stepX[2] * a2.y) * invArea);
+    XMFLOAT2 ddyAttributes((stepY[0] * a0.x + stepY[1] * a1.x + stepY[2] * a2.x) * invArea,
+                           (stepY[0] * a0.y + stepY[1] * a1.y + stepY[2] * a2.y) * invArea);
+
+    for (int y = minY; y < maxY; ++y)
+    {
+        INT64 e0 = rowValues[0];
+        INT64 e1 = rowValues[1];
+        INT64 e2 = rowValues[2];
+        UINT* row = &pixels[y * width];
+        for (int x = minX; x < maxX; ++x)
+        {
+            if ((e0 | e1 | e2) >= 0)
+            {
+                // Interpolate the attributes at the pixel center
+                float w0 = (e0 - bias[0]) * invArea;
+                float w1 = (e1 - bias[1]) * invArea;
+                float w2 = (e2 - bias[2]) * invArea;
+                XMFLOAT2 attributes(w0 * a0.x + w1 * a1.x + w2 * a2.x,
+                                    w0 * a0.y + w1 * a1.y + w2 * a2.y);
+
+                XMFLOAT4 src = ShadePixel(item, attributes, ddxAttributes, ddyAttributes, x, y, filterMode);
+
+                // Premultiplied alpha blending, with additive alpha. sRGB targets are
+                // blended in linear space, like the output merger does.
+                XMFLOAT4 dst = UnpackR8G8B8A8(row[x]);
+                if (srgbTarget)
+                    dst = SRGBToLinear(dst);
+                dst.x = src.x + dst.x * (1.0f - src.w);
+                dst.y = src.y + dst.y * (1.0f - src.w);
+                dst.z = src.z + dst.z * (1.0f - src.w);
+                dst.w = src.w + dst.w;
+                row[x] = PackR8G8B8A8(srgbTarget ? LinearToSRGB(dst) : dst);
+            }
+
+            e0 += stepX[0];
+            e1 += stepX[1];
+            e2 += stepX[2];
+        }
+
+        rowValues[0] += stepY[0];
+        rowValues[1] += stepY[1];
+        rowValues[2] += stepY[2];
+    }
+}
+
+static XMFLOAT4 FetchTexel(const std::vector<UINT>& texels, int texWidth, int texHeight, bool srgb, int x, int y)
+{
+    // Wrap addressing
+    x %= texWidth;
+    y %= texHeight;
+    if (x < 0)
+        x += texWidth;
+    if (y < 0)
+        y += texHeight;
+    XMFLOAT4 texel = UnpackB8G8R8A8(texels[y * texWidth + x]);
+    return srgb ? SRGBToLinear(texel) : texel;
+}
+
+static XMFLOAT4 Lerp(const XMFLOAT4& a, const XMFLOAT4& b, float t)
+{
+    return XMFLOAT4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+}
+
+static XMFLOAT4 SampleTexture(const std::vector<UINT>& texels, int texWidth, int texHeight, bool srgb,
+                              const XMFLOAT2& texCoord, SpriteRenderer::FilterMode filterMode)
+{
+    if (filterMode == SpriteRenderer::Point)
+    {
+        int x = static_cast<int>(std::floor(texCoord.x * texWidth));
+        int y = static_cast<int>(std::floor(texCoord.y * texHeight));
+        return FetchTexel(texels, texWidth, texHeight, srgb, x, y);
+    }
+
+    // Bilinear, with 8 bits of sub-texel precision
+    float u = texCoord.x * texWidth - 0.5f;
+    float v = texCoord.y * texHeight - 0.5f;
+    float u0 = std::floor(u);
+    float v0 = std::floor(v);
+    float fracU = std::floor((u - u0) * 256.0f) / 256.0f;
+    float fracV = std::floor((v - v0) * 256.0f) / 256.0f;
+    int x = static_cast<int>(u0);
+    int y = static_cast<int>(v0);
+
+    XMFLOAT4 t00 = FetchTexel(texels, texWidth, texHeight, srgb, x, y);
+    XMFLOAT4 t10 = FetchTexel(texels, texWidth, texHeight, srgb, x + 1, y);
+    XMFLOAT4 t01 = FetchTexel(texels, texWidth, texHeight, srgb, x, y + 1);
+    XMFLOAT4 t11 = FetchTexel(texels, texWidth, texHeight, srgb, x + 1, y + 1);
+    return Lerp(Lerp(t00, t10, fracU), Lerp(t01, t11, fracU), fracV);
+}
+
+// Same as SpritePS, SpriteDistanceFieldPS and PrimitivePS. Derivatives are taken within
+// 2x2 pixel quads the way the GPU does, using the pixel's row and column in its quad.
+XMFLOAT4 SoftwareSpriteRenderer::ShadePixel(const DrawItem& item, const XMFLOAT2& attributes,
+                                            const XMFLOAT2& ddxAttributes, const XMFLOAT2& ddyAttributes,
+                                            int x, int y, SpriteRenderer::FilterMode filterMode) const
+{
+    XMFLOAT4 color = item.Color;
+
+    if (item.Tex != NULL)
+    {
+        const Texture& tex = *item.Tex;
+        const int texWidth = static_cast<int>(tex.Width);
+        const int texHeight = static_cast<int>(tex.Height);
+
+        XMFLOAT4 texColor = SampleTexture(tex.Texels, texWidth, texHeight, tex.SRGB, attributes, filterMode);
+
+        if (item.DistanceField)
+        {
+            // fwidth of the distance, from the top-left pixel of the quad to its neighbours
+            const float offsetX = static_cast<float>(x & 1);
+            const float offsetY = static_cast<float>(y & 1);
+            XMFLOAT2 quadX0(attributes.x - ddxAttributes.x * offsetX, attributes.y - ddxAttributes.y * offsetX);
+            XMFLOAT2 quadX1(quadX0.x + ddxAttributes.x, quadX0.y + ddxAttributes.y);
+            XMFLOAT2 quadY0(attributes.x - ddyAttributes.x * offsetY, attributes.y - ddyAttributes.y * offsetY);
+            XMFLOAT2 quadY1(quadY0.x + ddyAttributes.x, quadY0.y + ddyAttributes.y);
+            float ddxDistance = SampleTexture(tex.Texels, texWidth, texHeight, tex.SRGB, quadX1, filterMode).w
+                                - SampleTexture(tex.Texels, texWidth, texHeight, tex.SRGB, quadX0, filterMode).w;
+            float ddyDistance = SampleTexture(tex.Texels, texWidth, texHeight, tex.SRGB, quadY1, filterMode).w
+                                - SampleTexture(tex.Texels, texWidth, texHeight, tex.SRGB, quadY0, filterMode).w;
+            float fwidth = max(std::abs(ddxDistance) + std::abs(ddyDistance), 0.0001f);
+            texColor.w = Clamp((texColor.w - 0.5f) / fwidth + 0.5f, 0.0f, 1.0f);
+        }
+
+        color.x *= texColor.x;
+        color.y *= texColor.y;
+        color.z *= texColor.z;
+        color.w *= texColor.w;
+    }
+    else
+    {
+        float coverage = 1.0f;
+        if (item.PrimitiveType == SpriteRenderer::PrimitiveCircle)
+        {
+            float dist = std::sqrt(attributes.x * attributes.x + attributes.y * attributes.y);
+            float radius = item.HalfSize.x;
+            coverage = Clamp(radius - dist + 0.5f, 0.0f, 1.0f);
+            if (item.Thickness > 0.0f)
+                coverage *= Clamp(dist - (radius - item.Thickness) + 0.5f, 0.0f, 1.0f);
+        }
+        else if (item.PrimitiveType == SpriteRenderer::PrimitiveRect && item.Thickness > 0.0f)
+        {
+            float edgeDistX = item.HalfSize.x - std::abs(attributes.x);
+            float edgeDistY = item.HalfSize.y - std::abs(attributes.y);
+            coverage = min(edgeDistX, edgeDistY) < item.Thickness ? 1.0f : 0.0f;
+        }
+
+        color.w *= coverage;
+    }
+
+    color.x *= color.w;
+    color.y *= color.w;
+    color.z *= color.w;
+    return color;
+}
+
+UINT64 SoftwareSpriteRenderer::Compare(const UINT* otherPixels, UINT otherWidth, UINT otherHeight, UINT tolerance) const
+{
+    if (otherWidth != width || otherHeight != height)
+        return static_cast<UINT64>(width) * height;
+
+    UINT64 numDifferent = 0;
+    for (size_t i = 0; i < pixels.size(); ++i)
+    {
+        for (UINT channel = 0; channel < 4; ++channel)
+        {
+            int a = (pixels[i] >> (channel * 8)) & 0xFF;
+            int b = (otherPixels[i] >> (channel * 8)) & 0xFF;
+            if (static_cast<UINT>(std::abs(a - b)) > tolerance)
+            {
+                ++numDifferent;
+                break;
+            }
+        }
+    }
+
+    return numDifferent;
+}
+
+UINT64 SoftwareSpriteRenderer::CompareToBitmap(LPCWSTR fileName, UINT tolerance) const
+{
+    std::vector<UINT> goldenPixels;
+    UINT goldenWidth = 0;
+    UINT goldenHeight = 0;
+    ReadBitmap(fileName, goldenPixels, goldenWidth, goldenHeight);
+    return Compare(&goldenPixels[0], goldenWidth, goldenHeight, tolerance);
+}
+
+// Writes the target as a top-down 32-bit .bmp
+void SoftwareSpriteRenderer::WriteBitmap(LPCWSTR fileName) const
+{
+    BITMAPINFOHEADER infoHeader;
+    ZeroMemory(&infoHeader, sizeof(infoHeader));
+    infoHeader.biSize = sizeof(BITMAPINFOHEADER);
+    infoHeader.biWidth = width;
+    infoHeader.biHeight = -static_cast<LONG>(height);
+    infoHeader.biPlanes = 1;
+    infoHeader.biBitCount = 32;
+    infoHeader.biCompression = BI_RGB;
+    infoHeader.biSizeImage = width * height * 4;
+
+    BITMAPFILEHEADER fileHeader;
+    ZeroMemory(&fileHeader, sizeof(fileHeader));
+    fileHeader.bfType = 0x4D42;
+    fileHeader.bfOffBits = sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER);
+    fileHeader.bfSize = fileHeader.bfOffBits + infoHeader.biSizeImage;
+
+    std::vector<UINT> bgraPixels(pixels.size());
+    for (size_t i = 0; i < pixels.size(); ++i)
+        bgraPixels[i] = SwapRedBlue(pixels[i]);
+
+    std::ofstream file(fileName, std::ios::binary);
+    if (!file.is_open())
+        throw Exception(L"Couldn't open " + std::wstring(fileName) + L" for writing");
+
+    file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    file.write(reinterpret_cast<const char*>(&infoHeader), sizeof(infoHeader));
+    file.write(reinterpret_cast<const char*>(&bgraPixels[0]), infoHeader.biSizeImage);
+}
+
+// Reads a 32-bit .bmp written by WriteBitmap, returning R8G8B8A8 pixels
+void SoftwareSpriteRenderer::ReadBitmap(LPCWSTR fileName, std::vector<UINT>& pixels, UINT& width, UINT& height)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open())
+        throw Exception(L"Couldn't open " + std::wstring(fileName));
+
+    BITMAPFILEHEADER fileHeader;
+    BITMAPINFOHEADER infoHeader;
+    file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader));
+    file.read(reinterpret_cast<char*>(&infoHeader), sizeof(infoHeader));
+    if (!file.good() || fileHeader.bfType != 0x4D42 || infoHeader.biBitCount != 32 || infoHeader.biCompression != BI_RGB)
+        throw Exception(std::wstring(fileName) + L" isn't a 32-bit uncompressed bitmap");
+
+    width = static_cast<UINT>(infoHeader.biWidth);
+    height = static_cast<UINT>(std::abs(infoHeader.biHeight));
+    bool bottomUp = infoHeader.biHeight > 0;
+
+    pixels.resize(width * height);
+    file.seekg(fileHeader.bfOffBits);
+    for (UINT y = 0; y < height; ++y)
+    {
+        UINT dstY = bottomUp ? height - 1 - y : y;
+        file.read(reinterpret_cast<char*>(&pixels[dstY * width]), width * sizeof(UINT));
+    }
+
+    if (!file.good())
+        throw Exception(L"Failed to read the pixels from " + std::wstring(fileName));
+
+    for (size_t i = 0; i < pixels.size(); ++i)
+        pixels[i] = SwapRedBlue(pixels[i]);
+}
+
+}
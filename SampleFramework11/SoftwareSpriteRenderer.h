@@ -0,0 +1,124 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include "SpriteRenderer.h"
+
+namespace SampleFramework11
+{
+
+class SpriteCommandBuffer;
+
+// Executes recorded sprite command buffers on the CPU, producing the same image that
+// SpriteRenderer would on the GPU. Sprites go through the same transform and texcoord
+// math as SpriteVSCommon in Sprite.hlsl, primitives go through PrimitiveVS/PrimitivePS,
+// and the results are blended with premultiplied alpha into an R8G8B8A8 target. The
+// target is split into tiles that are rasterized in parallel, with the draws in each
+// tile processed in submission order so that the result is deterministic.
+//
+// This is used for producing golden images, so that changes to batching, culling or
+// text layout can be checked for pixel-exactness without a GPU. Rasterization follows
+// the D3D11 rules for a single-sampled target: 8-bit sub-pixel precision, the top-left
+// fill rule and attribute evaluation at pixel centers.
+class SoftwareSpriteRenderer
+{
+
+public:
+
+    static const UINT TileSize = 64;
+
+    SoftwareSpriteRenderer();
+    ~SoftwareSpriteRenderer();
+
+    // An sRGB target stores sRGB-encoded pixels and blends in linear space, which matches
+    // drawing to a *_UNORM_SRGB render target view
+    void Initialize(UINT width, UINT height, bool srgbTarget = false);
+
+    void Clear(const XMFLOAT4& color);
+
+    // Textures are looked up using the shader resource view pointers stored in the
+    // command buffers. Texels are in B8G8R8A8 format, to match SpriteFont and TextureAtlas,
+    // and they're decoded from sRGB when the view has a B8G8R8A8_UNORM_SRGB format.
+    void SetTexture(ID3D11ShaderResourceView* texture, UINT width, UINT height, const UINT* texels, UINT pitch);
+
+    // Reads back the contents of a B8G8R8A8 texture through a staging texture
+    void SetTexture(ID3D11ShaderResourceView* texture, ID3D11Device* device, ID3D11DeviceContext* context);
+
+    // Queues a command buffer to be drawn by the next call to Execute. Buffers are
+    // drawn in sort key order, the same way as with SpriteRenderer::Submit.
+    void Submit(const SpriteCommandBuffer& commandBuffer);
+
+    void Execute(SpriteRenderer::FilterMode filterMode = SpriteRenderer::Linear);
+
+    // Returns the number of pixels where any channel differs by more than the tolerance
+    UINT64 Compare(const UINT* pixels, UINT width, UINT height, UINT tolerance = 0) const;
+    UINT64 CompareToBitmap(LPCWSTR fileName, UINT tolerance = 0) const;
+
+    void WriteBitmap(LPCWSTR fileName) const;
+    static void ReadBitmap(LPCWSTR fileName, std::vector<UINT>& pixels, UINT& width, UINT& height);
+
+    // Accessors
+    UINT Width() const { return width; };
+    UINT Height() const { return height; };
+    const UINT* Pixels() const { return pixels.empty() ? NULL : &pixels[0]; };
+
+protected:
+
+    struct Texture
+    {
+        UINT Width;
+        UINT Height;
+        bool SRGB;
+        std::vector<UINT> Texels;
+    };
+
+    // A sprite or primitive, with its quad already transformed to pixel coordinates
+    struct DrawItem
+    {
+        INT64 X[4];
+        INT64 Y[4];
+        XMFLOAT2 Attributes[4];
+        XMFLOAT4 Color;
+        const Texture* Tex;
+        bool DistanceField;
+        UINT PrimitiveType;
+        float Thickness;
+        XMFLOAT2 HalfSize;
+        int MinX;
+        int MinY;
+        int MaxX;
+        int MaxY;
+    };
+
+    void AddSprite(const SpriteRenderer::SpriteDrawData& sprite, const Texture& texture, bool distanceField);
+    void AddPrimitive(const SpriteRenderer::PrimitiveInstance& primitive);
+    void AddQuad(DrawItem& item, const XMFLOAT4* positionsSS);
+    void RenderTile(UINT tileX, UINT tileY, SpriteRenderer::FilterMode filterMode);
+    void RasterizeTriangle(const DrawItem& item, UINT i0, UINT i1, UINT i2,
+                           int minX, int minY, int maxX, int maxY,
+                           SpriteRenderer::FilterMode filterMode);
+    XMFLOAT4 ShadePixel(const DrawItem& item, const XMFLOAT2& attributes, const XMFLOAT2& ddxAttributes,
+                        const XMFLOAT2& ddyAttributes, int x, int y, SpriteRenderer::FilterMode filterMode) const;
+
+    UINT width;
+    UINT height;
+    UINT numTilesX;
+    UINT numTilesY;
+    bool srgbTarget;
+    std::vector<UINT> pixels;
+    std::map<ID3D11ShaderResourceView*, Texture> textures;
+    std::vector<const SpriteCommandBuffer*> submittedBuffers;
+    std::vector<DrawItem> drawItems;
+    std::vector<std::vector<UINT>> tileBins;
+};
+
+}
@@ -0,0 +1,173 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "PCH.h"
+
+#include "SpriteCommandBuffer.h"
+#include "SpriteFont.h"
+#include "GlyphCache.h"
+#include "Exceptions.h"
+
+namespace SampleFramework11
+{
+
+SpriteCommandBuffer::SpriteCommandBuffer()
+    : sortKey(0)
+{
+
+}
+
+SpriteCommandBuffer::~SpriteCommandBuffer()
+{
+
+}
+
+void SpriteCommandBuffer::Reset(UINT64 sortKey)
+{
+    this->sortKey = sortKey;
+    commands.clear();
+    sprites.clear();
+    primitives.clear();
+}
+
+static bool CompareSortKeys(const SpriteCommandBuffer* a, const SpriteCommandBuffer* b)
+{
+    return a->SortKey() < b->SortKey();
+}
+
+void SpriteCommandBuffer::SortForDrawing(std::vector<const SpriteCommandBuffer*>& buffers)
+{
+    std::sort(buffers.begin(), buffers.end(), CompareSortKeys);
+    for (size_t i = 1; i < buffers.size(); ++i)
+        if (buffers[i]->SortKey() == buffers[i - 1]->SortKey())
+            throw Exception(L"Sprite command buffers submitted in the same frame need unique sort keys");
+}
+
+// Returns a command that new sprites can be appended to, merging with the
+// previous command when it uses the same texture and shader. Passing a NULL
+// texture returns a command for primitives.
+SpriteCommandBuffer::Command& SpriteCommandBuffer::GetCommand(ID3D11ShaderResourceView* texture, bool distanceField)
+{
+    if (commands.empty() || commands.back().Texture != texture || commands.back().DistanceField != distanceField)
+    {
+        Command command;
+        command.Texture = texture;
+        command.FirstSprite = texture != NULL ? sprites.size() : primitives.size();
+        command.NumSprites = 0;
+        command.DistanceField = distanceField;
+        commands.push_back(command);
+    }
+
+    return commands.back();
+}
+
+void SpriteCommandBuffer::Render(ID3D11ShaderResourceView* texture,
+                                 const XMMATRIX& transform,
+                                 const XMFLOAT4& color,
+                                 const XMFLOAT4* drawRect)
+{
+    SpriteRenderer::SpriteDrawData sprite;
+    sprite.Transform = transform;
+    sprite.Color = color;
+
+    if (drawRect == NULL)
+    {
+        D3D11_TEXTURE2D_DESC desc = SpriteRenderer::GetTextureDesc(texture);
+        sprite.DrawRect = XMFLOAT4(0, 0, static_cast<float>(desc.Width), static_cast<float>(desc.Height));
+    }
+    else
+        sprite.DrawRect = *drawRect;
+
+    Command& command = GetCommand(texture);
+    sprites.push_back(sprite);
+    command.NumSprites++;
+}
+
+void SpriteCommandBuffer::RenderBatch(ID3D11ShaderResourceView* texture,
+                                      const SpriteRenderer::SpriteDrawData* drawData,
+                                      UINT64 numSprites)
+{
+    if (numSprites == 0)
+        return;
+
+    Command& command = GetCommand(texture);
+    sprites.insert(sprites.end(), drawData, drawData + numSprites);
+    command.NumSprites += numSprites;
+}
+
+void SpriteCommandBuffer::RenderText(const SpriteFont& font,
+                                     const WCHAR* text,
+                                     const XMMATRIX& transform,
+                                     const XMFLOAT4& color)
+{
+    SpriteRenderer::LayoutText(font, text, wcslen(text), color, textGlyphs, &dynamicTextGlyphs);
+    AppendGlyphs(font.SRView(), textGlyphs, transform, font.IsDistanceField());
+    if (font.DynamicGlyphs() != NULL)
+        AppendGlyphs(font.DynamicGlyphs()->SRView(), dynamicTextGlyphs, transform, false);
+}
+
+void SpriteCommandBuffer::AppendGlyphs(ID3D11ShaderResourceView* texture,
+                                       const std::vector<SpriteRenderer::SpriteDrawData>& glyphs,
+                                       const XMMATRIX& transform,
+                                       bool distanceField)
+{
+    if (glyphs.empty())
+        return;
+
+    // Append the glyphs, then move them into place
+    UINT64 numGlyphs = glyphs.size();
+    Command& command = GetCommand(texture, distanceField);
+    size_t start = sprites.size();
+    sprites.insert(sprites.end(), glyphs.begin(), glyphs.end());
+    SpriteRenderer::TransformGlyphs(&glyphs[0], numGlyphs, transform, &sprites[start]);
+    command.NumSprites += numGlyphs;
+}
+
+void SpriteCommandBuffer::RenderRect(const XMFLOAT2& topLeft,
+                                     const XMFLOAT2& size,
+                                     const XMFLOAT4& color,
+                                     float thickness)
+{
+    Command& command = GetCommand(NULL);
+    primitives.push_back(SpriteRenderer::CreateRect(topLeft, size, color, thickness));
+    command.NumSprites++;
+}
+
+void SpriteCommandBuffer::RenderLine(const XMFLOAT2& start,
+                                     const XMFLOAT2& end,
+                                     const XMFLOAT4& color,
+                                     float thickness)
+{
+    Command& command = GetCommand(NULL);
+    primitives.push_back(SpriteRenderer::CreateLine(start, end, color, thickness));
+    command.NumSprites++;
+}
+
+void SpriteCommandBuffer::RenderCircle(const XMFLOAT2& center,
+                                       float radius,
+                                       const XMFLOAT4& color,
+                                       float thickness)
+{
+    Command& command = GetCommand(NULL);
+    primitives.push_back(SpriteRenderer::CreateCircle(center, radius, color, thickness));
+    command.NumSprites++;
+}
+
+void SpriteCommandBuffer::RenderPrimitives(const SpriteRenderer::PrimitiveInstance* primitives,
+                                           UINT64 numPrimitives)
+{
+    if (numPrimitives == 0)
+        return;
+
+    Command& command = GetCommand(NULL);
+    this->primitives.insert(this->primitives.end(), primitives, primitives + numPrimitives);
+    command.NumSprites += numPrimitives;
+}
+
+}
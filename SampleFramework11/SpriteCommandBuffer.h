@@ -0,0 +1,105 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include "SpriteRenderer.h"
+
+namespace SampleFramework11
+{
+
+class SpriteFont;
+
+// Records sprite draws without touching a device context, so that worker threads
+// can each fill their own buffer in parallel. Recorded buffers are handed to
+// SpriteRenderer::Submit, and drawn at SpriteRenderer::End ordered by sort key.
+class SpriteCommandBuffer
+{
+
+public:
+
+    // Commands without a texture draw primitives, and index into Primitives()
+    // instead of Sprites()
+    struct Command
+    {
+        ID3D11ShaderResourceView* Texture;
+        UINT64 FirstSprite;
+        UINT64 NumSprites;
+        bool DistanceField;
+    };
+
+    SpriteCommandBuffer();
+    ~SpriteCommandBuffer();
+
+    // Clears all recorded commands. Buffers with a lower sort key are drawn first. Every
+    // buffer submitted in the same frame needs its own key, so that the order they're
+    // drawn in never depends on which thread recorded or submitted them first.
+    void Reset(UINT64 sortKey);
+
+    // Sorts buffers into the order they're drawn in, and throws if two share a sort key
+    static void SortForDrawing(std::vector<const SpriteCommandBuffer*>& buffers);
+
+    void Render(ID3D11ShaderResourceView* texture,
+                const XMMATRIX& transform,
+                const XMFLOAT4& color = XMFLOAT4(1, 1, 1, 1),
+                const XMFLOAT4* drawRect = NULL);
+
+    void RenderBatch(ID3D11ShaderResourceView* texture,
+                     const SpriteRenderer::SpriteDrawData* drawData,
+                     UINT64 numSprites);
+
+    void RenderText(const SpriteFont& font,
+                    const WCHAR* text,
+                    const XMMATRIX& transform,
+                    const XMFLOAT4& color = XMFLOAT4(1, 1, 1, 1));
+
+    void RenderRect(const XMFLOAT2& topLeft,
+                    const XMFLOAT2& size,
+                    const XMFLOAT4& color,
+                    float thickness = 0.0f);
+
+    void RenderLine(const XMFLOAT2& start,
+                    const XMFLOAT2& end,
+                    const XMFLOAT4& color,
+                    float thickness = 1.0f);
+
+    void RenderCircle(const XMFLOAT2& center,
+                      float radius,
+                      const XMFLOAT4& color,
+                      float thickness = 0.0f);
+
+    void RenderPrimitives(const SpriteRenderer::PrimitiveInstance* primitives, UINT64 numPrimitives);
+
+    // Accessors
+    UINT64 SortKey() const { return sortKey; };
+    const std::vector<Command>& Commands() const { return commands; };
+    const SpriteRenderer::SpriteDrawData* Sprites() const { return sprites.empty() ? NULL : &sprites[0]; };
+    UINT64 NumSprites() const { return sprites.size(); };
+    const SpriteRenderer::PrimitiveInstance* Primitives() const { return primitives.empty() ? NULL : &primitives[0]; };
+    UINT64 NumPrimitives() const { return primitives.size(); };
+
+protected:
+
+    Command& GetCommand(ID3D11ShaderResourceView* texture, bool distanceField = false);
+    void AppendGlyphs(ID3D11ShaderResourceView* texture,
+                      const std::vector<SpriteRenderer::SpriteDrawData>& glyphs,
+                      const XMMATRIX& transform,
+                      bool distanceField);
+
+    UINT64 sortKey;
+    std::vector<Command> commands;
+    std::vector<SpriteRenderer::SpriteDrawData> sprites;
+    std::vector<SpriteRenderer::PrimitiveInstance> primitives;
+    std::vector<SpriteRenderer::SpriteDrawData> textGlyphs;
+    std::vector<SpriteRenderer::SpriteDrawData> dynamicTextGlyphs;
+};
+
+}
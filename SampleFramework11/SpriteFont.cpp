@@ -10,7 +10,14 @@
 #include "PCH.h"
 
 #include "SpriteFont.h"
-
+#include "FontCache.h"
+#include "GlyphCache.h"
+
+#include "RectPacker.h"
+#include "TrueTypeFont.h"
+#include "DistanceField.h"
+#include "Parallel.h"
+#include "Exceptions.h"
 #include "Utility.h"
 
 using namespace Gdiplus;
@@ -20,11 +27,106 @@ using std::vector;
 namespace SampleFramework11
 {
 
+// The rows are OR'ed together 4 texels at a time into a mask with one entry per
+// column, and each row is OR-reduced to see whether it's empty, so the bitmap
+// only needs to be locked and read once.
+void SpriteFont::ExtractGlyph(Bitmap& bitmap, vector<UINT>& columnMask, int& minX, int& maxX,
+                              int& minY, int& maxY, vector<UINT>& texels)
+{
+    const int width = static_cast<int>(bitmap.GetWidth());
+    const int height = static_cast<int>(bitmap.GetHeight());
+    _ASSERT(columnMask.size() >= static_cast<size_t>(width));
+
+    BitmapData bmData;
+    GdiPlusCall(bitmap.LockBits(&Rect(0, 0, width, height), ImageLockModeRead, PixelFormat32bppARGB, &bmData));
+
+    UINT* mask = &columnMask[0];
+    const int numVectors = width / 4;
+    for (int x = 0; x < numVectors * 4; x += 4)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mask + x), _mm_setzero_si128());
+    for (int x = numVectors * 4; x < width; ++x)
+        mask[x] = 0;
+
+    // Alpha is in the top byte
+    const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+    const BYTE* rowStart = reinterpret_cast<const BYTE*>(bmData.Scan0);
+    minX = 0;
+    maxX = width - 1;
+    minY = height;
+    maxY = -1;
+    for (int y = 0; y < height; ++y)
+    {
+        const UINT* row = reinterpret_cast<const UINT*>(rowStart + y * bmData.Stride);
+        __m128i rowBits = _mm_setzero_si128();
+        for (int x = 0; x < numVectors * 4; x += 4)
+        {
+            __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+            __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mask + x), _mm_or_si128(current, texels));
+            rowBits = _mm_or_si128(rowBits, texels);
+        }
+
+        rowBits = _mm_and_si128(rowBits, alphaMask);
+        bool rowHasAlpha = _mm_movemask_epi8(_mm_cmpeq_epi32(rowBits, _mm_setzero_si128())) != 0xFFFF;
+        for (int x = numVectors * 4; x < width; ++x)
+        {
+            mask[x] |= row[x];
+            rowHasAlpha |= (row[x] & 0xFF000000) != 0;
+        }
+
+        if (rowHasAlpha)
+        {
+            minY = min(minY, y);
+            maxY = y;
+        }
+    }
+
+    if (maxY >= 0)
+    {
+        int x = 0;
+        while ((mask[x] & 0xFF000000) == 0)
+            ++x;
+        minX = x;
+
+        x = width - 1;
+        while ((mask[x] & 0xFF000000) == 0)
+            --x;
+        maxX = x;
+    }
+    else
+        minY = 0;
+
+    // Copy out the trimmed texels
+    const int glyphWidth = maxX - minX + 1;
+    const int glyphHeight = maxY - minY + 1;
+    texels.resize(glyphWidth * glyphHeight);
+    for (int y = 0; y < glyphHeight; ++y)
+    {
+        const UINT* row = reinterpret_cast<const UINT*>(rowStart + (minY + y) * bmData.Stride);
+        memcpy(&texels[y * glyphWidth], row + minX, glyphWidth * sizeof(UINT));
+    }
+
+    GdiPlusCall(bitmap.UnlockBits(&bmData));
+}
+
+static volatile LONGLONG numFontIDs = 0;
+
+static UINT64 NewFontID()
+{
+    return static_cast<UINT64>(InterlockedIncrement64(&numFontIDs));
+}
+
 SpriteFont::SpriteFont()
     :   size(0),
+        texWidth(0),
         texHeight(0),
         spaceWidth(0),
-        charHeight(0)
+        charHeight(0),
+        fontStyle(0),
+        antiAliased(false),
+        distanceField(false),
+        fromFontFile(false),
+        id(0)
 {
 
 }
@@ -35,10 +137,164 @@ SpriteFont::~SpriteFont()
 }
 
 void SpriteFont::Initialize(LPCWSTR fontName, float fontSize, UINT fontStyle, bool antiAliased, ID3D11Device* device)
+{
+    FontCacheKey key;
+    key.FontName = fontName;
+    key.FontSize = fontSize;
+    key.FontStyle = fontStyle;
+    key.AntiAliased = antiAliased;
+    key.DistanceField = false;
+    Initialize(key, device);
+}
+
+void SpriteFont::InitializeDistanceField(LPCWSTR fontName, float fontSize, UINT fontStyle, ID3D11Device* device)
+{
+    FontCacheKey key;
+    key.FontName = fontName;
+    key.FontSize = fontSize;
+    key.FontStyle = fontStyle;
+    key.AntiAliased = true;
+    key.DistanceField = true;
+    Initialize(key, device);
+}
+
+void SpriteFont::Initialize(const FontCacheKey& key, ID3D11Device* device)
+{
+    size = key.FontSize;
+    fontName = key.FontName;
+    fontStyle = key.FontStyle;
+    antiAliased = key.AntiAliased;
+    distanceField = key.DistanceField;
+
+    // Create the texture straight from the mapped file if the glyphs were baked before
+    FontCacheFile cacheFile;
+    if (cacheFile.Open(key))
+        CreateFromAtlasData(cacheFile.Data(), device);
+    else
+        RasterizeGlyphs(key, device);
+}
+
+void SpriteFont::InitializeFromFile(LPCWSTR fileName, float fontSize, ID3D11Device* device)
 {
     size = fontSize;
+    fontName = fileName;
+    fontStyle = Regular;
+    antiAliased = true;
+    distanceField = false;
+    fromFontFile = true;
+
+    HANDLE file = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        throw Win32Exception(GetLastError());
+
+    LARGE_INTEGER fileSize;
+    vector<BYTE> fileData;
+    BOOL readSucceeded = GetFileSizeEx(file, &fileSize) && fileSize.HighPart == 0 && fileSize.LowPart > 0;
+    if (readSucceeded)
+    {
+        DWORD bytesRead = 0;
+        fileData.resize(fileSize.LowPart);
+        readSucceeded = ReadFile(file, &fileData[0], fileSize.LowPart, &bytesRead, NULL) && bytesRead == fileSize.LowPart;
+    }
+    CloseHandle(file);
+    if (!readSucceeded)
+        throw Exception(L"Failed to read font file " + fontName);
+
+    TrueTypeFont trueTypeFont;
+    if (!trueTypeFont.Load(&fileData[0], fileData.size()))
+        throw Exception(L"Font file " + fontName + L" isn't a TrueType font");
+
+    TrueTypeFont::GlyphPage page;
+    if (!trueTypeFont.BakeGlyphPage(fontSize, StartChar, NumChars, GlyphPadding, D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION, page))
+        throw Exception(L"Failed to rasterize the glyphs for font " + fontName);
+
+    for (UINT64 i = 0; i < NumChars; ++i)
+    {
+        const TrueTypeFont::GlyphDesc& glyph = page.Glyphs[i];
+        charDescs[i].X = glyph.X;
+        charDescs[i].Y = glyph.Y;
+        charDescs[i].Width = glyph.Width;
+        charDescs[i].Height = glyph.Height;
+        charDescs[i].OffsetX = glyph.OffsetX;
+        charDescs[i].OffsetY = glyph.OffsetY;
+        charDescs[i].Advance = glyph.Advance;
+    }
+
+    FontAtlasData atlasData;
+    atlasData.TexWidth = page.TexWidth;
+    atlasData.TexHeight = page.TexHeight;
+    atlasData.SpaceWidth = page.SpaceWidth;
+    atlasData.CharHeight = page.CharHeight;
+    atlasData.CharDescs = charDescs;
+    atlasData.Texels = &page.Texels[0];
+    CreateFromAtlasData(atlasData, device);
+}
+
+// Turns a glyph that was rasterized at DistanceFieldScale times the font size into a
+// distance field at the font size, with DistanceFieldSpread texels of padding around it.
+// The distance is stored in alpha, with 0.5 at the edge of the glyph.
+static void MakeDistanceFieldGlyph(SpriteFont::CharDesc& desc, vector<UINT>& texels)
+{
+    const int scale = SpriteFont::DistanceFieldScale;
+    const int spread = SpriteFont::DistanceFieldSpread;
+    const int srcWidth = static_cast<int>(desc.Width);
+    const int srcHeight = static_cast<int>(desc.Height);
+
+    desc.OffsetX = -static_cast<float>(spread);
+    desc.OffsetY = desc.OffsetY / scale - spread;
+    desc.Advance = desc.Width / scale + 1;
+    if (srcHeight == 0)
+    {
+        desc.Width = 0;
+        desc.Height = 0;
+        texels.clear();
+        return;
+    }
+
+    const int width = (srcWidth + scale - 1) / scale + spread * 2;
+    const int height = (srcHeight + scale - 1) / scale + spread * 2;
+    desc.Width = static_cast<float>(width);
+    desc.Height = static_cast<float>(height);
+
+    // Compute the distances at the high resolution, with the glyph in the middle of the padding
+    const int hiWidth = width * scale;
+    const int hiHeight = height * scale;
+    vector<BYTE> coverage(hiWidth * hiHeight, 0);
+    for (int y = 0; y < srcHeight; ++y)
+        for (int x = 0; x < srcWidth; ++x)
+            coverage[(y + spread * scale) * hiWidth + x + spread * scale] = static_cast<BYTE>(texels[y * srcWidth + x] >> 24);
+
+    vector<float> distances(hiWidth * hiHeight);
+    ComputeSignedDistanceField(&coverage[0], hiWidth, hiHeight, 128, &distances[0]);
+
+    // Box filter down to the font size
+    texels.resize(width * height);
+    const float distanceScale = 1.0f / (scale * scale * scale * spread * 2.0f);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            float sum = 0.0f;
+            for (int sy = 0; sy < scale; ++sy)
+                for (int sx = 0; sx < scale; ++sx)
+                    sum += distances[(y * scale + sy) * hiWidth + x * scale + sx];
+
+            float alpha = Clamp(0.5f - sum * distanceScale, 0.0f, 1.0f);
+            texels[y * width + x] = (static_cast<UINT>(alpha * 255.0f + 0.5f) << 24) | 0x00FFFFFF;
+        }
+    }
+}
+
+void SpriteFont::RasterizeGlyphs(const FontCacheKey& key, ID3D11Device* device)
+{
+    // Distance field glyphs are drawn larger, and then filtered down
+    const float scale = key.DistanceField ? static_cast<float>(DistanceFieldScale) : 1.0f;
+    const float fontSize = key.FontSize * scale;
+    const bool antiAliased = key.AntiAliased;
 
     TextRenderingHint hint = antiAliased ? TextRenderingHintAntiAliasGridFit : TextRenderingHintSystemDefault;
+    if (key.DistanceField)
+        hint = TextRenderingHintAntiAlias;
 
     // Init GDI+
     ULONG_PTR token = NULL;
@@ -49,33 +305,11 @@ void SpriteFont::Initialize(LPCWSTR fontName, float fontSize, UINT fontStyle, bo
     try
     {
         // Create the font
-        Gdiplus::Font font(fontName, fontSize, fontStyle, UnitPixel, NULL);
+        Gdiplus::Font font(key.FontName.c_str(), fontSize, key.FontStyle, UnitPixel, NULL);
 
         // Check for error during construction
         GdiPlusCall(font.GetLastStatus());
 
-        // Create a temporary Bitmap and Graphics for figuring out the rough size required
-        // for drawing all of the characters
-        int size = static_cast<int>(fontSize * NumChars * 2) + 1;
-        Bitmap sizeBitmap(size, size, PixelFormat32bppARGB);
-        GdiPlusCall(sizeBitmap.GetLastStatus());
-
-        Graphics sizeGraphics(&sizeBitmap);
-        GdiPlusCall(sizeGraphics.GetLastStatus());
-        GdiPlusCall(sizeGraphics.SetTextRenderingHint(hint));
-
-        charHeight = font.GetHeight(&sizeGraphics) * 1.5f;
-
-        WCHAR allChars[NumChars + 1];
-        for(WCHAR i = 0; i < NumChars; ++i)
-            allChars[i] = i + StartChar;
-        allChars[NumChars] = 0;
-
-        RectF sizeRect;
-        GdiPlusCall(sizeGraphics.MeasureString(allChars, NumChars, &font, PointF(0, 0), &sizeRect));
-        int numRows = static_cast<int>(sizeRect.Width / TexWidth) + 1;
-        int texHeight = static_cast<int>(numRows * charHeight) + 1;
-
         // Create a temporary Bitmap and Graphics for drawing the characters one by one
         int tempSize = static_cast<int>(fontSize * 2);
         Bitmap drawBitmap(tempSize, tempSize, PixelFormat32bppARGB);
@@ -85,24 +319,18 @@ void SpriteFont::Initialize(LPCWSTR fontName, float fontSize, UINT fontStyle, bo
         GdiPlusCall(drawGraphics.GetLastStatus());
         GdiPlusCall(drawGraphics.SetTextRenderingHint(hint));
 
-        // Create a temporary Bitmap + Graphics for creating a full character set
-        Bitmap textBitmap (TexWidth, texHeight, PixelFormat32bppARGB);
-        GdiPlusCall(textBitmap.GetLastStatus());
-
-        Graphics textGraphics (&textBitmap);
-        GdiPlusCall(textGraphics.GetLastStatus());
-        GdiPlusCall(textGraphics.Clear(Color(0, 255, 255, 255)));
-        GdiPlusCall(textGraphics.SetCompositingMode(CompositingModeSourceCopy));
+        charHeight = font.GetHeight(&drawGraphics) * 1.5f / scale;
 
         // Solid brush for text rendering
         SolidBrush brush (Color(255, 255, 255, 255));
         GdiPlusCall(brush.GetLastStatus());
 
-        // Draw all of the characters, and copy them to the full character set
+        // Draw all of the characters, and trim them down to their visible texels
+        vector<UINT> columnMask(tempSize);
+        vector<vector<UINT>> glyphTexels(NumChars);
+        vector<RectPacker::Rect> glyphRects(NumChars);
         WCHAR charString [2];
         charString[1] = 0;
-        int currentX = 0;
-        int currentY = 0;
         for(UINT64 i = 0; i < NumChars; ++i)
         {
             charString[0] = static_cast<WCHAR>(i + StartChar);
@@ -110,117 +338,231 @@ void SpriteFont::Initialize(LPCWSTR fontName, float fontSize, UINT fontStyle, bo
             // Draw the character
             GdiPlusCall(drawGraphics.Clear(Color(0, 255, 255, 255)));
             GdiPlusCall(drawGraphics.DrawString(charString, 1, &font, PointF(0, 0), &brush));
+            drawGraphics.Flush(FlushIntentionSync);
 
-            // Figure out the amount of blank space before the character
-            int minX = 0;
-            for(int x = 0; x < tempSize; ++x)
-            {
-                for(int y = 0; y < tempSize; ++y)
-                {
-                    Color color;
-                    GdiPlusCall(drawBitmap.GetPixel(x, y, &color));
-                    if(color.GetAlpha() > 0)
-                    {
-                        minX = x;
-                        x = tempSize;
-                        break;
-                    }
-                }
-            }
-
-            // Figure out the amount of blank space after the character
-            int maxX = tempSize - 1;
-            for(int x = tempSize - 1; x >= 0; --x)
-            {
-                for(int y = 0; y < tempSize; ++y)
-                {
-                    Color color;
-                    GdiPlusCall(drawBitmap.GetPixel(x, y, &color));
-                    if(color.GetAlpha() > 0)
-                    {
-                        maxX = x;
-                        x = -1;
-                        break;
-                    }
-                }
-            }
-
-            int charWidth = maxX - minX + 1;
-
-            // Figure out if we need to move to the next row
-            if (currentX + charWidth >= TexWidth)
+            int minX, maxX, minY, maxY;
+            ExtractGlyph(drawBitmap, columnMask, minX, maxX, minY, maxY, glyphTexels[i]);
+
+            charDescs[i].Width = static_cast<float>(maxX - minX + 1);
+            charDescs[i].Height = static_cast<float>(maxY - minY + 1);
+            charDescs[i].OffsetX = 0.0f;
+            charDescs[i].OffsetY = static_cast<float>(minY);
+            charDescs[i].Advance = charDescs[i].Width + 1;
+        }
+
+        // The distance transforms are independent for each glyph
+        if (key.DistanceField)
+        {
+            ParallelFor(0, static_cast<size_t>(NumChars), [&](size_t i)
             {
-                currentX = 0;
-                currentY += static_cast<int>(charHeight) + 1;
-            }
+                MakeDistanceFieldGlyph(charDescs[i], glyphTexels[i]);
+            });
+        }
 
-            // Fill out the structure describing the character position
-            charDescs[i].X = static_cast<float>(currentX);
-            charDescs[i].Y = static_cast<float>(currentY);
-            charDescs[i].Width = static_cast<float>(charWidth);
-            charDescs[i].Height = static_cast<float>(charHeight);
+        // Leave a texel of space between glyphs, so that they don't bleed into each other
+        for(UINT64 i = 0; i < NumChars; ++i)
+        {
+            glyphRects[i].Width = static_cast<UINT>(charDescs[i].Width) + GlyphPadding;
+            glyphRects[i].Height = static_cast<UINT>(charDescs[i].Height) + GlyphPadding;
+        }
 
-            // Copy the character over
-            int height = static_cast<int>(charHeight + 1);
-            GdiPlusCall(textGraphics.DrawImage(&drawBitmap, currentX, currentY, minX, 0, charWidth, height, UnitPixel));
+        // Pack the glyphs into the smallest power-of-2 texture that fits them
+        UINT32 pageWidth = 0;
+        UINT32 pageHeight = 0;
+        if (!RectPacker::PackPow2(glyphRects, 1, D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION, pageWidth, pageHeight))
+            throw Exception(L"The glyphs for font " + key.FontName + L" don't fit in a single texture");
 
-            currentX += charWidth + 1;
+        // Copy the glyphs into the page, which starts out as transparent white
+        vector<UINT> texels(pageWidth * pageHeight, 0x00FFFFFF);
+        for(UINT64 i = 0; i < NumChars; ++i)
+        {
+            const RectPacker::Rect& rect = glyphRects[i];
+            const UINT glyphWidth = rect.Width - GlyphPadding;
+            const UINT glyphHeight = rect.Height - GlyphPadding;
+            for (UINT y = 0; y < glyphHeight; ++y)
+                memcpy(&texels[(rect.Y + y) * pageWidth + rect.X], &glyphTexels[i][y * glyphWidth], glyphWidth * sizeof(UINT));
+
+            charDescs[i].X = static_cast<float>(rect.X);
+            charDescs[i].Y = static_cast<float>(rect.Y);
         }
 
         // Figure out the width of a space character
+        RectF sizeRect;
         charString[0] = ' ';
         charString[1] = 0;
         GdiPlusCall(drawGraphics.MeasureString(charString, 1, &font, PointF(0, 0), &sizeRect));
-        spaceWidth = sizeRect.Width;
-
-        // Lock the bitmap for direct memory access
-        BitmapData bmData;
-        GdiPlusCall(textBitmap.LockBits(&Rect(0, 0, TexWidth, texHeight), ImageLockModeRead, PixelFormat32bppARGB, &bmData));
-
-        // Create a D3D texture, initalized with the bitmap data
-        D3D11_TEXTURE2D_DESC texDesc;
-        texDesc.Width = TexWidth;
-        texDesc.Height = texHeight;
-        texDesc.MipLevels = 1;
-        texDesc.ArraySize = 1;
-        texDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-        texDesc.SampleDesc.Count = 1;
-        texDesc.SampleDesc.Quality = 0;
-        texDesc.Usage = D3D11_USAGE_IMMUTABLE;
-        texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-        texDesc.CPUAccessFlags = 0;
-        texDesc.MiscFlags = 0;
-
-        D3D11_SUBRESOURCE_DATA data;
-        data.pSysMem = bmData.Scan0;
-        data.SysMemPitch = TexWidth * 4;
-        data.SysMemSlicePitch = 0;
-
-        DXCall(device->CreateTexture2D(&texDesc, &data, &texture));
-
-        GdiPlusCall(textBitmap.UnlockBits(&bmData));
-
-        // Create the shader resource view
-        D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
-        srDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-        srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-        srDesc.Texture2D.MipLevels = 1;
-        srDesc.Texture2D.MostDetailedMip = 0;
-
-        DXCall(device->CreateShaderResourceView(texture, &srDesc, &srView));
+        spaceWidth = sizeRect.Width / scale;
+
+        // Bake the glyphs so that the next run can skip all of this
+        FontAtlasData atlasData;
+        atlasData.TexWidth = pageWidth;
+        atlasData.TexHeight = pageHeight;
+        atlasData.SpaceWidth = spaceWidth;
+        atlasData.CharHeight = charHeight;
+        atlasData.CharDescs = charDescs;
+        atlasData.Texels = &texels[0];
+        FontCacheFile::Write(key, atlasData);
+
+        CreateFromAtlasData(atlasData, device);
     }
-    catch (GdiPlusException e)
+    catch (...)
     {
         // Shutdown GDI+
         if (token != NULL)
             GdiplusShutdown(token);
-        throw e;
+        throw;
     }
 
     // Shutdown GDI+
     GdiplusShutdown(token);
 }
 
+void SpriteFont::CreateFromAtlasData(const FontAtlasData& data, ID3D11Device* device)
+{
+    id = NewFontID();
+    texWidth = data.TexWidth;
+    texHeight = data.TexHeight;
+    spaceWidth = data.SpaceWidth;
+    charHeight = data.CharHeight;
+    if (data.CharDescs != charDescs)
+        memcpy(charDescs, data.CharDescs, sizeof(charDescs));
+
+    // Create a D3D texture, initalized with the glyph page
+    D3D11_TEXTURE2D_DESC texDesc;
+    texDesc.Width = texWidth;
+    texDesc.Height = texHeight;
+    texDesc.MipLevels = 1;
+    texDesc.ArraySize = 1;
+    texDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    texDesc.SampleDesc.Count = 1;
+    texDesc.SampleDesc.Quality = 0;
+    texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    texDesc.CPUAccessFlags = 0;
+    texDesc.MiscFlags = 0;
+
+    D3D11_SUBRESOURCE_DATA initData;
+    initData.pSysMem = data.Texels;
+    initData.SysMemPitch = texWidth * 4;
+    initData.SysMemSlicePitch = 0;
+
+    DXCall(device->CreateTexture2D(&texDesc, &initData, &texture));
+
+    // Create the shader resource view
+    D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
+    srDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srDesc.Texture2D.MipLevels = 1;
+    srDesc.Texture2D.MostDetailedMip = 0;
+
+    DXCall(device->CreateShaderResourceView(texture, &srDesc, &srView));
+
+    CreateGlyphTable(device);
+}
+
+// Matches GPUGlyph in Sprite.hlsl
+struct GPUGlyph
+{
+    XMFLOAT4 DrawRect;
+    XMFLOAT4 Metrics;
+};
+
+// Puts the glyph rects and metrics into a float4 buffer, so that text can be laid out
+// in a vertex shader from nothing but the characters. A typed buffer is used instead of
+// a structured buffer so that it works on feature level 10 hardware.
+void SpriteFont::CreateGlyphTable(ID3D11Device* device)
+{
+    GPUGlyph glyphs [NumGlyphTableEntries];
+    for (UINT i = 0; i < NumGlyphTableEntries; ++i)
+    {
+        if (HasStaticGlyph(static_cast<WCHAR>(i)))
+        {
+            const CharDesc& desc = charDescs[i - StartChar];
+            glyphs[i].DrawRect = XMFLOAT4(desc.X, desc.Y, desc.Width, desc.Height);
+            glyphs[i].Metrics = XMFLOAT4(desc.OffsetX, desc.OffsetY, desc.Advance, 0.0f);
+        }
+        else
+        {
+            glyphs[i].DrawRect = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+            glyphs[i].Metrics = XMFLOAT4(0.0f, 0.0f, spaceWidth, 0.0f);
+        }
+    }
+
+    D3D11_BUFFER_DESC bufferDesc;
+    bufferDesc.ByteWidth = sizeof(glyphs);
+    bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    bufferDesc.CPUAccessFlags = 0;
+    bufferDesc.MiscFlags = 0;
+    bufferDesc.StructureByteStride = 0;
+
+    D3D11_SUBRESOURCE_DATA initData;
+    initData.pSysMem = glyphs;
+    initData.SysMemPitch = 0;
+    initData.SysMemSlicePitch = 0;
+
+    ID3D11BufferPtr glyphTable;
+    DXCall(device->CreateBuffer(&bufferDesc, &initData, &glyphTable));
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
+    srDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    srDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+    srDesc.Buffer.FirstElement = 0;
+    srDesc.Buffer.NumElements = NumGlyphTableEntries * (sizeof(GPUGlyph) / sizeof(XMFLOAT4));
+
+    DXCall(device->CreateShaderResourceView(glyphTable, &srDesc, &glyphTableSRView));
+}
+
+void SpriteFont::InitializeFromAtlas(const SpriteFont& source, ID3D11Texture2D* atlasTexture,
+                                     ID3D11ShaderResourceView* atlasSRView, float offsetX, float offsetY)
+{
+    _ASSERT(!texture);
+    *this = source;
+
+    id = NewFontID();
+    texture = atlasTexture;
+    srView = atlasSRView;
+
+    // The glyph rects are in atlas space now, so the texture size has to match
+    D3D11_TEXTURE2D_DESC texDesc;
+    atlasTexture->GetDesc(&texDesc);
+    texWidth = texDesc.Width;
+    texHeight = texDesc.Height;
+
+    for (UINT64 i = 0; i < NumChars; ++i)
+    {
+        charDescs[i].X += offsetX;
+        charDescs[i].Y += offsetY;
+    }
+
+    // The glyph rects moved, so the table needs to be rebuilt
+    ID3D11DevicePtr device;
+    atlasTexture->GetDevice(&device);
+    CreateGlyphTable(device);
+}
+
+void SpriteFont::EnableDynamicGlyphs(ID3D11Device* device, UINT pageSize)
+{
+    _ASSERT(texture);
+    _ASSERT(!glyphCache);
+
+    // The dynamic page only holds plain coverage glyphs, and looks fonts up by name through GDI+
+    if (distanceField)
+        throw Exception(L"Dynamic glyphs aren't supported for distance field font " + fontName);
+    if (fromFontFile)
+        throw Exception(L"Dynamic glyphs aren't supported for fonts loaded from a file: " + fontName);
+
+    // Glyphs that aren't ready yet are drawn as a box the size of an 'M'
+    glyphCache = std::shared_ptr<GlyphCache>(new GlyphCache());
+    glyphCache->Initialize(fontName, size, fontStyle, antiAliased, GetCharDescriptor('M'), pageSize, device);
+}
+
+void SpriteFont::UpdateDynamicGlyphs(ID3D11DeviceContext* context)
+{
+    if (glyphCache)
+        glyphCache->Update(context);
+}
+
 ID3D11ShaderResourceView* SpriteFont::SRView() const
 {
     return srView;
@@ -233,7 +575,7 @@ const SpriteFont::CharDesc* SpriteFont::CharDescriptors() const
 
 const SpriteFont::CharDesc& SpriteFont::GetCharDescriptor(WCHAR character) const
 {
-    _ASSERT(character >= StartChar && character <= EndChar);
+    _ASSERT(HasStaticGlyph(character));
     return charDescs[character - StartChar];
 }
 
@@ -244,7 +586,7 @@ float SpriteFont::Size() const
 
 UINT SpriteFont::TextureWidth() const
 {
-    return TexWidth;
+    return texWidth;
 }
 
 UINT SpriteFont::TextureHeight() const
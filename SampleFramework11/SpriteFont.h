@@ -16,6 +16,10 @@
 namespace SampleFramework11
 {
 
+struct FontAtlasData;
+struct FontCacheKey;
+class GlyphCache;
+
 class SpriteFont
 {
 
@@ -37,19 +41,68 @@ public:
         float Y;
         float Width;
         float Height;
+
+        // Offset from the pen position to the top-left of the glyph's rect. Glyphs
+        // are trimmed to their visible texels, so OffsetY is the distance from the
+        // top of the line to the top of the glyph.
+        float OffsetX;
+        float OffsetY;
+
+        // How far the pen moves after drawing the glyph
+        float Advance;
     };
 
     static const WCHAR StartChar = '!';
     static const WCHAR EndChar = 127;
     static const UINT64 NumChars = EndChar - StartChar;
-    static const UINT TexWidth = 1024;
+    static const UINT GlyphPadding = 1;
+
+    // The glyph table has an entry for every character below EndChar, plus one at the
+    // end for characters past it. Characters without a glyph advance like a space.
+    static const UINT NumGlyphTableEntries = EndChar + 1;
+
+    // Distance field glyphs are rasterized at DistanceFieldScale times the font size,
+    // and store distances of up to DistanceFieldSpread texels from the glyph's edge
+    static const UINT DistanceFieldScale = 4;
+    static const UINT DistanceFieldSpread = 4;
 
     // Lifetime
     SpriteFont();
     ~SpriteFont();
 
+    // Loads the glyph page from the font cache if it's been baked before, otherwise
+    // rasterizes it with GDI+ and bakes it for the next run
     void Initialize(LPCWSTR fontName, float fontSize, UINT fontStyle, bool antiAliased, ID3D11Device* device);
 
+    // Builds a signed distance field glyph page instead of a bitmap one. The font can then
+    // be drawn at any size by scaling the text transform by the target size over Size().
+    void InitializeDistanceField(LPCWSTR fontName, float fontSize, UINT fontStyle, ID3D11Device* device);
+
+    // Builds the glyph page from a TrueType file with the portable rasterizer instead of
+    // GDI+. The glyphs are antialiased, and the metrics match the ones from Initialize.
+    void InitializeFromFile(LPCWSTR fileName, float fontSize, ID3D11Device* device);
+
+    // Makes this font a copy of the source font that reads its glyphs from a copy of the
+    // source's glyph page inside a texture atlas. The source font isn't changed, so
+    // shared fonts can be added to any number of atlases.
+    void InitializeFromAtlas(const SpriteFont& source, ID3D11Texture2D* atlasTexture,
+                             ID3D11ShaderResourceView* atlasSRView, float offsetX, float offsetY);
+
+    // Lets the font draw characters outside of [StartChar, EndChar). They're rasterized
+    // on demand on a worker thread, and kept in a separate page with LRU eviction.
+    void EnableDynamicGlyphs(ID3D11Device* device, UINT pageSize = 512);
+
+    // Uploads dynamic glyphs that have finished rasterizing. Call this once per frame,
+    // outside of SpriteRenderer::Begin/End.
+    void UpdateDynamicGlyphs(ID3D11DeviceContext* context);
+
+    // Copies out the visible texels of a glyph drawn into a 32bpp bitmap, along
+    // with their bounds. Empty glyphs keep their full width, with a height of 0.
+    static void ExtractGlyph(Gdiplus::Bitmap& bitmap, std::vector<UINT>& columnMask, int& minX, int& maxX,
+                             int& minY, int& maxY, std::vector<UINT>& texels);
+
+    static bool HasStaticGlyph(WCHAR character) { return character >= StartChar && character < EndChar; };
+
     // Accessors
     ID3D11ShaderResourceView* SRView() const;
     const CharDesc* CharDescriptors() const;
@@ -60,16 +113,37 @@ public:
     UINT TextureHeight() const;
     float SpaceWidth() const;
     float CharHeight() const;
+    GlyphCache* DynamicGlyphs() const { return glyphCache.get(); };
+    ID3D11ShaderResourceView* GlyphTableSRView() const { return glyphTableSRView; };
+    bool IsDistanceField() const { return distanceField; };
+
+    // Unique for every set of glyph rects that a font has had, so that it can be used to
+    // cache things that depend on them, even after the font's memory is reused
+    UINT64 ID() const { return id; };
 
 protected:
 
+    void Initialize(const FontCacheKey& key, ID3D11Device* device);
+    void RasterizeGlyphs(const FontCacheKey& key, ID3D11Device* device);
+    void CreateFromAtlasData(const FontAtlasData& data, ID3D11Device* device);
+    void CreateGlyphTable(ID3D11Device* device);
+
     ID3D11Texture2DPtr texture;
     ID3D11ShaderResourceViewPtr srView;
+    ID3D11ShaderResourceViewPtr glyphTableSRView;
     CharDesc charDescs [NumChars];
     float size;
+    UINT texWidth;
     UINT texHeight;
     float spaceWidth;
     float charHeight;
+    std::wstring fontName;
+    UINT fontStyle;
+    bool antiAliased;
+    bool distanceField;
+    bool fromFontFile;
+    std::shared_ptr<GlyphCache> glyphCache;
+    UINT64 id;
 };
 
 }
\ No newline at end of file
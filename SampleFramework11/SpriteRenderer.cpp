@@ -12,19 +12,27 @@
 #include "SpriteRenderer.h"
 #include "ShaderCompilation.h"
 #include "SpriteFont.h"
+#include "GlyphCache.h"
+#include "SpriteCommandBuffer.h"
 
 namespace SampleFramework11
 {
 
 SpriteRenderer::SpriteRenderer()
-    : initialized(false)
+    : initialized(false),
+      batchTexture(NULL),
+      batchDistanceField(false),
+      numBuffered(0),
+      batchStart(0),
+      gpuTextFont(NULL),
+      textCacheFrame(0)
 {
-
+    InitializeCriticalSection(&submitLock);
 }
 
 SpriteRenderer::~SpriteRenderer()
 {
-
+    DeleteCriticalSection(&submitLock);
 }
 
 void SpriteRenderer::Initialize(ID3D11Device* device)
@@ -41,6 +49,17 @@ void SpriteRenderer::Initialize(ID3D11Device* device)
     DXCall(device->CreateVertexShader(compiledVSInstanced->GetBufferPointer(), compiledVSInstanced->GetBufferSize(), NULL, &vertexShaderInstanced));
 
     pixelShader.Attach(CompilePSFromFile(device, L"SampleFramework11\\Shaders\\Sprite.hlsl", "SpritePS"));
+    distanceFieldPS.Attach(CompilePSFromFile(device, L"SampleFramework11\\Shaders\\Sprite.hlsl", "SpriteDistanceFieldPS"));
+
+    ID3D10BlobPtr compiledPrimitiveVS;
+    compiledPrimitiveVS.Attach(CompileShader(L"SampleFramework11\\Shaders\\Sprite.hlsl", "PrimitiveVS", "vs_4_0"));
+    DXCall(device->CreateVertexShader(compiledPrimitiveVS->GetBufferPointer(), compiledPrimitiveVS->GetBufferSize(), NULL, &primitiveVS));
+
+    primitivePS.Attach(CompilePSFromFile(device, L"SampleFramework11\\Shaders\\Sprite.hlsl", "PrimitivePS"));
+
+    ID3D10BlobPtr compiledGPUTextVS;
+    compiledGPUTextVS.Attach(CompileShader(L"SampleFramework11\\Shaders\\Sprite.hlsl", "GPUTextVS", "vs_4_0"));
+    DXCall(device->CreateVertexShader(compiledGPUTextVS->GetBufferPointer(), compiledGPUTextVS->GetBufferSize(), NULL, &gpuTextVS));
 
 	// Define the input layouts
 	D3D11_INPUT_ELEMENT_DESC layout[] =
@@ -65,6 +84,19 @@ void SpriteRenderer::Initialize(ID3D11Device* device)
 
     DXCall(device->CreateInputLayout(layoutInstanced, 8, compiledVSInstanced->GetBufferPointer(), compiledVSInstanced->GetBufferSize(), &inputLayoutInstanced));
 
+    D3D11_INPUT_ELEMENT_DESC layoutPrimitive[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "PRIMPOSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "PRIMPOSITION", 1, DXGI_FORMAT_R32G32_FLOAT, 1, 8, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "PRIMTYPE", 0, DXGI_FORMAT_R16_UINT, 1, 20, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "THICKNESS", 0, DXGI_FORMAT_R16_FLOAT, 1, 22, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+    };
+
+    DXCall(device->CreateInputLayout(layoutPrimitive, 7, compiledPrimitiveVS->GetBufferPointer(), compiledPrimitiveVS->GetBufferSize(), &inputLayoutPrimitive));
+
     // Create the vertex buffer
     SpriteVertex verts[] =
     { { D3DXVECTOR2(0.0f, 0.0f), D3DXVECTOR2(0.0f, 0.0f) },
@@ -90,6 +122,37 @@ void SpriteRenderer::Initialize(ID3D11Device* device)
     desc.ByteWidth = sizeof(SpriteDrawData) * MaxBatchSize;
     DXCall(device->CreateBuffer(&desc, NULL, &instanceDataBuffer));
 
+    desc.ByteWidth = sizeof(PrimitiveInstance) * MaxPrimitiveBatchSize;
+    DXCall(device->CreateBuffer(&desc, NULL, &primitiveBuffer));
+
+    // Create the buffers for GPU text layout. The characters are read through an
+    // R16_UINT view, their pen positions through an R32_FLOAT view, and the line headers
+    // through an R32G32B32A32_FLOAT one, since structured buffers aren't available on
+    // feature level 10 hardware.
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    desc.ByteWidth = sizeof(WCHAR) * MaxGPUTextChars;
+    DXCall(device->CreateBuffer(&desc, NULL, &gpuTextCharBuffer));
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
+    srDesc.Format = DXGI_FORMAT_R16_UINT;
+    srDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+    srDesc.Buffer.FirstElement = 0;
+    srDesc.Buffer.NumElements = MaxGPUTextChars;
+    DXCall(device->CreateShaderResourceView(gpuTextCharBuffer, &srDesc, &gpuTextCharSRView));
+
+    desc.ByteWidth = sizeof(float) * MaxGPUTextChars;
+    DXCall(device->CreateBuffer(&desc, NULL, &gpuTextPenXBuffer));
+
+    srDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    DXCall(device->CreateShaderResourceView(gpuTextPenXBuffer, &srDesc, &gpuTextPenXSRView));
+
+    desc.ByteWidth = sizeof(GPUTextLine) * MaxGPUTextLines;
+    DXCall(device->CreateBuffer(&desc, NULL, &gpuTextLineBuffer));
+
+    srDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    srDesc.Buffer.NumElements = MaxGPUTextLines * (sizeof(GPUTextLine) / sizeof(XMFLOAT4));
+    DXCall(device->CreateShaderResourceView(gpuTextLineBuffer, &srDesc, &gpuTextLineSRView));
+
     // Create the index buffer
     USHORT indices[] = { 0, 1, 2, 3, 0, 2 };
     desc.Usage = D3D11_USAGE_IMMUTABLE;
@@ -109,6 +172,9 @@ void SpriteRenderer::Initialize(ID3D11Device* device)
     desc.ByteWidth = CBSize(sizeof(SpriteDrawData));
     DXCall(device->CreateBuffer(&desc, NULL, &vsPerInstanceCB));
 
+    desc.ByteWidth = CBSize(sizeof(GPUTextCB));
+    DXCall(device->CreateBuffer(&desc, NULL, &gpuTextCB));
+
     // Create our states
     D3D11_RASTERIZER_DESC rastDesc;
     rastDesc.AntialiasedLineEnable = FALSE;
@@ -183,6 +249,15 @@ void SpriteRenderer::Begin(ID3D11DeviceContext* deviceContext, FilterMode filter
     _ASSERT(!context);
     context = deviceContext;
 
+    batchTexture = NULL;
+    batchDistanceField = false;
+    numBuffered = 0;
+    batchStart = 0;
+    gpuTextFont = NULL;
+    gpuTextChars.clear();
+    gpuTextPenX.clear();
+    gpuTextLines.clear();
+
     D3DPERF_BeginEvent(0xFFFFFFFF, L"SpriteRenderer Begin/End");
 
     // Set the index buffer
@@ -207,6 +282,8 @@ void SpriteRenderer::Begin(ID3D11DeviceContext* deviceContext, FilterMode filter
     context->GSSetShader(NULL, NULL, 0);
     context->DSSetShader(NULL, NULL, 0);
     context->HSSetShader(NULL, NULL, 0);
+
+    GetPipelineState(pendingState);
 }
 
 D3D11_TEXTURE2D_DESC SpriteRenderer::SetPerBatchData(ID3D11ShaderResourceView* texture)
@@ -215,18 +292,18 @@ D3D11_TEXTURE2D_DESC SpriteRenderer::SetPerBatchData(ID3D11ShaderResourceView* t
     VSPerBatchCB perBatch;
 
     // Get the viewport dimensions
-    UINT numViewports = 1;
-    D3D11_VIEWPORT vp;
-    context->RSGetViewports(&numViewports, &vp);
-    perBatch.ViewportSize = XMFLOAT2(static_cast<float>(vp.Width), static_cast<float>(vp.Height));
+    perBatch.ViewportSize = GetViewportSize();
 
-    // Get the size of the texture
-    ID3D11Resource* resource;
-    ID3D11Texture2DPtr texResource;
+    // Get the size of the texture. Primitives don't have one, so they get a 1x1 size.
     D3D11_TEXTURE2D_DESC desc;
-    texture->GetResource(&resource);
-    texResource.Attach(reinterpret_cast<ID3D11Texture2D*>(resource));
-    texResource->GetDesc(&desc);
+    if (texture != NULL)
+        desc = GetTextureDesc(texture);
+    else
+    {
+        ZeroMemory(&desc, sizeof(D3D11_TEXTURE2D_DESC));
+        desc.Width = 1;
+        desc.Height = 1;
+    }
     perBatch.TextureSize = XMFLOAT2(static_cast<float>(desc.Width), static_cast<float>(desc.Height));
 
     // Copy it into the buffer
@@ -238,6 +315,181 @@ D3D11_TEXTURE2D_DESC SpriteRenderer::SetPerBatchData(ID3D11ShaderResourceView* t
     return desc;
 }
 
+void SpriteRenderer::GetPipelineState(PipelineState& state)
+{
+    UINT numViewports = 1;
+    ZeroMemory(&state.Viewport, sizeof(D3D11_VIEWPORT));
+    context->RSGetViewports(&numViewports, &state.Viewport);
+
+    context->PSGetShader(&state.PixelShader, NULL, NULL);
+    context->PSGetSamplers(0, 1, &state.Sampler);
+    context->OMGetRenderTargets(1, &state.RenderTarget, &state.DepthStencil);
+}
+
+void SpriteRenderer::SetPipelineState(const PipelineState& state)
+{
+    ID3D11SamplerState* sampler = state.Sampler;
+    ID3D11RenderTargetView* renderTarget = state.RenderTarget;
+    context->RSSetViewports(1, &state.Viewport);
+    context->PSSetShader(state.PixelShader, NULL, 0);
+    context->PSSetSamplers(0, 1, &sampler);
+    context->OMSetRenderTargets(1, &renderTarget, state.DepthStencil);
+}
+
+// Queued draws are only issued later, so when the caller has bound a different viewport,
+// pixel shader, sampler or render target, anything that's still queued is drawn right away
+// with the state that was bound when it was queued
+void SpriteRenderer::StateChanged()
+{
+    _ASSERT(context);
+
+    PipelineState current;
+    GetPipelineState(current);
+
+    if (numBuffered > batchStart || !pendingPrimitives.empty() || !gpuTextLines.empty())
+    {
+        SetPipelineState(pendingState);
+        FlushSprites();
+        FlushPrimitives();
+        FlushGPUText();
+        SetPipelineState(current);
+    }
+
+    pendingState = current;
+}
+
+// Uses the viewport captured at Begin or StateChanged, so that it isn't queried for every draw
+XMFLOAT2 SpriteRenderer::GetViewportSize()
+{
+    return XMFLOAT2(pendingState.Viewport.Width, pendingState.Viewport.Height);
+}
+
+// Returns false if a sprite's quad lies entirely outside of the viewport. Sprite
+// transforms are assumed to be affine, which is always the case for 2D sprites.
+bool SpriteRenderer::IsSpriteVisible(const SpriteDrawData& sprite, const XMFLOAT2& viewportSize)
+{
+    const XMMATRIX& m = sprite.Transform;
+    float w = sprite.DrawRect.z;
+    float h = sprite.DrawRect.w;
+
+    float x0 = m._41;
+    float x1 = m._41 + w * m._11;
+    float x2 = m._41 + h * m._21;
+    float x3 = x1 + h * m._21;
+    float y0 = m._42;
+    float y1 = m._42 + w * m._12;
+    float y2 = m._42 + h * m._22;
+    float y3 = y1 + h * m._22;
+
+    float minX = min(min(x0, x1), min(x2, x3));
+    float maxX = max(max(x0, x1), max(x2, x3));
+    float minY = min(min(y0, y1), min(y2, y3));
+    float maxY = max(max(y0, y1), max(y2, y3));
+
+    return maxX >= 0.0f && minX <= viewportSize.x && maxY >= 0.0f && minY <= viewportSize.y;
+}
+
+// Copies the sprites that overlap the viewport to the output array, and returns how
+// many were copied. Sprites are tested 4 at a time by transposing their transforms
+// and draw rects into SoA form, and computing the screen-space bounds of all four
+// corners at once. The output can alias the input.
+UINT64 SpriteRenderer::CullSprites(const SpriteDrawData* drawData,
+                                   UINT64 numSprites,
+                                   const XMFLOAT2& viewportSize,
+                                   SpriteDrawData* output)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 vpWidth = _mm_set1_ps(viewportSize.x);
+    const __m128 vpHeight = _mm_set1_ps(viewportSize.y);
+
+    UINT64 numVisible = 0;
+    UINT64 i = 0;
+    for (; i + 4 <= numSprites; i += 4)
+    {
+        const SpriteDrawData* sprites = drawData + i;
+
+        __m128 r0x = sprites[0].Transform.r[0];
+        __m128 r0y = sprites[1].Transform.r[0];
+        __m128 r0z = sprites[2].Transform.r[0];
+        __m128 r0w = sprites[3].Transform.r[0];
+        _MM_TRANSPOSE4_PS(r0x, r0y, r0z, r0w);
+
+        __m128 r1x = sprites[0].Transform.r[1];
+        __m128 r1y = sprites[1].Transform.r[1];
+        __m128 r1z = sprites[2].Transform.r[1];
+        __m128 r1w = sprites[3].Transform.r[1];
+        _MM_TRANSPOSE4_PS(r1x, r1y, r1z, r1w);
+
+        __m128 r3x = sprites[0].Transform.r[3];
+        __m128 r3y = sprites[1].Transform.r[3];
+        __m128 r3z = sprites[2].Transform.r[3];
+        __m128 r3w = sprites[3].Transform.r[3];
+        _MM_TRANSPOSE4_PS(r3x, r3y, r3z, r3w);
+
+        __m128 rectX = _mm_loadu_ps(&sprites[0].DrawRect.x);
+        __m128 rectY = _mm_loadu_ps(&sprites[1].DrawRect.x);
+        __m128 rectW = _mm_loadu_ps(&sprites[2].DrawRect.x);
+        __m128 rectH = _mm_loadu_ps(&sprites[3].DrawRect.x);
+        _MM_TRANSPOSE4_PS(rectX, rectY, rectW, rectH);
+
+        // Corners of the quad in screen space
+        __m128 x1 = _mm_add_ps(r3x, _mm_mul_ps(rectW, r0x));
+        __m128 x2 = _mm_add_ps(r3x, _mm_mul_ps(rectH, r1x));
+        __m128 x3 = _mm_add_ps(x1, _mm_mul_ps(rectH, r1x));
+        __m128 y1 = _mm_add_ps(r3y, _mm_mul_ps(rectW, r0y));
+        __m128 y2 = _mm_add_ps(r3y, _mm_mul_ps(rectH, r1y));
+        __m128 y3 = _mm_add_ps(y1, _mm_mul_ps(rectH, r1y));
+
+        __m128 minX = _mm_min_ps(_mm_min_ps(r3x, x1), _mm_min_ps(x2, x3));
+        __m128 maxX = _mm_max_ps(_mm_max_ps(r3x, x1), _mm_max_ps(x2, x3));
+        __m128 minY = _mm_min_ps(_mm_min_ps(r3y, y1), _mm_min_ps(y2, y3));
+        __m128 maxY = _mm_max_ps(_mm_max_ps(r3y, y1), _mm_max_ps(y2, y3));
+
+        __m128 outside = _mm_or_ps(_mm_cmplt_ps(maxX, zero), _mm_cmpgt_ps(minX, vpWidth));
+        outside = _mm_or_ps(outside, _mm_or_ps(_mm_cmplt_ps(maxY, zero), _mm_cmpgt_ps(minY, vpHeight)));
+        int outsideMask = _mm_movemask_ps(outside);
+
+        if (outsideMask == 0 && output + numVisible == sprites)
+        {
+            numVisible += 4;
+            continue;
+        }
+
+        for (UINT lane = 0; lane < 4; ++lane)
+            if ((outsideMask & (1 << lane)) == 0)
+                output[numVisible++] = sprites[lane];
+    }
+
+    for (; i < numSprites; ++i)
+        if (IsSpriteVisible(drawData[i], viewportSize))
+            output[numVisible++] = drawData[i];
+
+    return numVisible;
+}
+
+D3D11_TEXTURE2D_DESC SpriteRenderer::GetTextureDesc(ID3D11ShaderResourceView* texture)
+{
+    ID3D11Resource* resource;
+    ID3D11Texture2DPtr texResource;
+    D3D11_TEXTURE2D_DESC desc;
+    texture->GetResource(&resource);
+    texResource.Attach(reinterpret_cast<ID3D11Texture2D*>(resource));
+    texResource->GetDesc(&desc);
+    return desc;
+}
+
+void SpriteRenderer::ValidateDrawRects(const D3D11_TEXTURE2D_DESC& desc, const SpriteDrawData* drawData, UINT64 numSprites)
+{
+    for (UINT64 i = 0; i < numSprites; ++i)
+    {
+        XMFLOAT4 drawRect = drawData[i].DrawRect;
+        _ASSERT(drawRect.x >= 0 && drawRect.x < desc.Width);
+        _ASSERT(drawRect.y >= 0 && drawRect.y < desc.Height);
+        _ASSERT(drawRect.z > 0 && drawRect.x + drawRect.z <= desc.Width);
+        _ASSERT(drawRect.w > 0 && drawRect.y + drawRect.w <= desc.Height);
+    }
+}
+
 void SpriteRenderer::Render(ID3D11ShaderResourceView* texture,
                             const XMMATRIX& transform,
                             const XMFLOAT4& color,
@@ -246,6 +498,34 @@ void SpriteRenderer::Render(ID3D11ShaderResourceView* texture,
     _ASSERT(context);
     _ASSERT(initialized);
 
+    D3D11_TEXTURE2D_DESC desc = GetTextureDesc(texture);
+
+    // Set per-instance data
+    SpriteDrawData perInstance;
+    perInstance.Transform = transform;
+    perInstance.Color = color;
+
+    // Draw rect
+    if (drawRect == NULL)
+        perInstance.DrawRect = XMFLOAT4(0, 0, static_cast<float>(desc.Width), static_cast<float>(desc.Height));
+    else
+    {
+        _ASSERT(drawRect->x >= 0 && drawRect->x < desc.Width);
+        _ASSERT(drawRect->y >= 0 && drawRect->y < desc.Height);
+        _ASSERT(drawRect->z > 0 && drawRect->x + drawRect->z <= desc.Width);
+        _ASSERT(drawRect->w > 0 && drawRect->y + drawRect->w <= desc.Height);
+        perInstance.DrawRect = *drawRect;
+    }
+
+    // Skip the draw entirely if the sprite is off-screen
+    if (!IsSpriteVisible(perInstance, GetViewportSize()))
+        return;
+
+    FlushSprites();
+    FlushPrimitives();
+
+    perInstance.Transform = XMMatrixTranspose(transform);
+
     D3DPERF_BeginEvent(0xFFFFFFFF, L"SpriteRenderer Render");
 
     // Set the vertex shader
@@ -261,24 +541,7 @@ void SpriteRenderer::Render(ID3D11ShaderResourceView* texture,
     context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
 
     // Set per-batch constants
-    D3D11_TEXTURE2D_DESC desc = SetPerBatchData(texture);
-
-    // Set per-instance data
-    SpriteDrawData perInstance;
-    perInstance.Transform = XMMatrixTranspose(transform);
-    perInstance.Color = color;
-
-    // Draw rect
-    if (drawRect == NULL)
-        perInstance.DrawRect = XMFLOAT4(0, 0, static_cast<float>(desc.Width), static_cast<float>(desc.Height));
-    else
-    {
-        _ASSERT(drawRect->x >= 0 && drawRect->x < desc.Width);
-        _ASSERT(drawRect->y >= 0 && drawRect->y < desc.Height);
-        _ASSERT(drawRect->z > 0 && drawRect->x + drawRect->z < desc.Width);
-        _ASSERT(drawRect->w > 0 && drawRect->y + drawRect->w < desc.Height);
-        perInstance.DrawRect = *drawRect;
-    }
+    SetPerBatchData(texture);
 
     // Copy in the buffer data
     D3D11_MAPPED_SUBRESOURCE mapped;
@@ -304,112 +567,813 @@ void SpriteRenderer::RenderBatch(ID3D11ShaderResourceView* texture,
     _ASSERT(context);
     _ASSERT(initialized);
 
-    D3DPERF_BeginEvent(0xFFFFFFFF, L"SpriteRenderer RenderBatch");
+    if (numSprites == 0)
+        return;
 
-    // Set the vertex shader
-    context->VSSetShader(vertexShaderInstanced, NULL, 0);
+    // Make sure the draw rects are all valid
+    #ifdef _DEBUG
+        ValidateDrawRects(GetTextureDesc(texture), drawData, numSprites);
+    #endif
 
-    // Set the input layout
-    context->IASetInputLayout(inputLayoutInstanced);
+    QueueSprites(texture, drawData, numSprites, GetViewportSize());
+}
 
-    // Set per-batch constants
-    D3D11_TEXTURE2D_DESC desc = SetPerBatchData(texture);
+void SpriteRenderer::RenderText(const SpriteFont& font,
+                                const WCHAR* text,
+            				    const XMMATRIX& transform,
+                                const XMFLOAT4& color)
+{
+    D3DPERF_BeginEvent(0xFFFFFFFF, L"SpriteRenderer RenderText");
 
-    // Make sure the draw rects are all valid
-    for (UINT64 i = 0; i < numSprites; ++i)
+    size_t length = wcslen(text);
+
+    // Grab the laid-out glyphs from the cache (laying them out if needed), and
+    // move them to their final position
+    const TextCacheEntry& layout = GetTextLayout(font, text, length, color);
+    RenderGlyphs(font.SRView(), layout.Glyphs, transform, font.IsDistanceField());
+    if (font.DynamicGlyphs() != NULL)
+        RenderGlyphs(font.DynamicGlyphs()->SRView(), layout.DynamicGlyphs, transform, false);
+
+    D3DPERF_EndEvent();
+}
+
+void SpriteRenderer::RenderGlyphs(ID3D11ShaderResourceView* texture,
+                                  const std::vector<SpriteDrawData>& glyphs,
+                                  const XMMATRIX& transform,
+                                  bool distanceField)
+{
+    UINT64 numGlyphs = glyphs.size();
+    if (numGlyphs == 0)
+        return;
+
+    if (textDrawData.size() < numGlyphs)
+        textDrawData.insert(textDrawData.end(), static_cast<size_t>(numGlyphs - textDrawData.size()), glyphs[0]);
+
+    TransformGlyphs(&glyphs[0], numGlyphs, transform, &textDrawData[0]);
+
+    // Submit a batch
+    #ifdef _DEBUG
+        ValidateDrawRects(GetTextureDesc(texture), &textDrawData[0], numGlyphs);
+    #endif
+
+    QueueSprites(texture, &textDrawData[0], numGlyphs, GetViewportSize(), distanceField);
+}
+
+void SpriteRenderer::RenderGPUText(const SpriteFont& font,
+                                   const WCHAR* text,
+                                   const XMMATRIX& transform,
+                                   const XMFLOAT4& color)
+{
+    _ASSERT(context);
+    _ASSERT(initialized);
+
+    // Lines longer than the character buffer can't be drawn in one go
+    const size_t length = wcslen(text);
+    size_t lineLength = 0;
+    for (size_t i = 0; i < length; ++i)
     {
-        XMFLOAT4 drawRect = drawData[i].DrawRect;
-        _ASSERT(drawRect.x >= 0 && drawRect.x < desc.Width);
-        _ASSERT(drawRect.y >= 0 && drawRect.y < desc.Height);
-        _ASSERT(drawRect.z > 0 && drawRect.x + drawRect.z <= desc.Width);
-        _ASSERT(drawRect.w > 0 && drawRect.y + drawRect.w <= desc.Height);
+        lineLength = text[i] == '\n' ? 0 : lineLength + 1;
+        if (lineLength > MaxGPUTextChars)
+        {
+            RenderText(font, text, transform, color);
+            return;
+        }
     }
 
-    UINT64 numSpritesToDraw = min(numSprites, MaxBatchSize);
+    // Draw anything that was queued before, so that everything stays in order
+    if (numBuffered > batchStart)
+        FlushSprites();
+    FlushPrimitives();
+    if (gpuTextFont != &font)
+        FlushGPUText();
+    gpuTextFont = &font;
+
+    GPUTextLine line;
+    XMStoreFloat4x4(&line.Transform, transform);
+    line.Color = color;
+    line.PenY = 0.0f;
+    line.Padding = 0.0f;
+
+    const WCHAR* lineStart = text;
+    const WCHAR* textEnd = text + length;
+    while (lineStart <= textEnd)
+    {
+        const WCHAR* lineEnd = std::find(lineStart, textEnd, L'\n');
+        const size_t numChars = lineEnd - lineStart;
+        if (numChars > 0)
+        {
+            if (gpuTextChars.size() + numChars > MaxGPUTextChars || gpuTextLines.size() == MaxGPUTextLines)
+            {
+                FlushGPUText();
+                gpuTextFont = &font;
+            }
+
+            line.FirstChar = static_cast<float>(gpuTextChars.size());
+            line.NumChars = static_cast<float>(numChars);
+            gpuTextChars.insert(gpuTextChars.end(), lineStart, lineEnd);
+            gpuTextLines.push_back(line);
+
+            // Sum up the advances here, so that the vertex shader only has to look up
+            // its own character. This uses the same advances as the glyph table.
+            float penX = 0.0f;
+            for (const WCHAR* c = lineStart; c < lineEnd; ++c)
+            {
+                gpuTextPenX.push_back(penX);
+                penX += SpriteFont::HasStaticGlyph(*c) ? font.GetCharDescriptor(*c).Advance : font.SpaceWidth();
+            }
+        }
+
+        line.PenY += font.CharHeight();
+        lineStart = lineEnd + 1;
+    }
+}
+
+void SpriteRenderer::LayoutText(const SpriteFont& font,
+                                const WCHAR* text,
+                                size_t length,
+                                const XMFLOAT4& color,
+                                std::vector<SpriteDrawData>& glyphs)
+{
+    LayoutText(font, text, length, color, glyphs, NULL);
+}
+
+// Lays out a string in text space, producing one sprite per visible glyph. The
+// transform of each sprite is a translation to the glyph's pen position, which
+// TransformGlyphs turns into the final transform.
+void SpriteRenderer::LayoutText(const SpriteFont& font,
+                                const WCHAR* text,
+                                size_t length,
+                                const XMFLOAT4& color,
+                                std::vector<SpriteDrawData>& glyphs,
+                                std::vector<SpriteDrawData>* dynamicGlyphs)
+{
+    glyphs.clear();
+    glyphs.reserve(length);
+    if (dynamicGlyphs != NULL)
+        dynamicGlyphs->clear();
+
+    GlyphCache* glyphCache = dynamicGlyphs != NULL ? font.DynamicGlyphs() : NULL;
+
+    const float spaceWidth = font.SpaceWidth();
+    const float lineHeight = font.CharHeight();
+
+    SpriteDrawData glyph;
+    glyph.Transform = XMMatrixIdentity();
+    glyph.Color = color;
+
+    // The string is processed in blocks so that the advances fit on the stack
+    const size_t BlockSize = 256;
+    __declspec(align(16)) float advances[BlockSize];
+    __declspec(align(16)) float offsets[BlockSize];
+    SpriteFont::CharDesc dynamicDescs[BlockSize];
+
+    float runningSum = 0.0f;
+    float lineStart = 0.0f;
+    float penY = 0.0f;
+    for (size_t blockStart = 0; blockStart < length; blockStart += BlockSize)
+    {
+        const WCHAR* block = text + blockStart;
+        size_t blockSize = min(length - blockStart, BlockSize);
+        size_t paddedSize = (blockSize + 3) & ~3;
+
+        // Gather the advance for each character
+        for (size_t i = 0; i < blockSize; ++i)
+        {
+            WCHAR character = block[i];
+            if (character == ' ')
+                advances[i] = spaceWidth;
+            else if (character == '\n')
+                advances[i] = 0.0f;
+            else if (SpriteFont::HasStaticGlyph(character))
+                advances[i] = font.GetCharDescriptor(character).Advance;
+            else if (glyphCache != NULL)
+            {
+                dynamicDescs[i] = glyphCache->GetGlyph(character);
+                advances[i] = dynamicDescs[i].Advance;
+            }
+            else
+                advances[i] = spaceWidth;
+        }
+
+        for (size_t i = blockSize; i < paddedSize; ++i)
+            advances[i] = 0.0f;
+
+        // Exclusive prefix sum over the advances, 4 at a time. Each group is
+        // summed with two shift + add steps, then offset by the running total.
+        __m128 carry = _mm_set1_ps(runningSum);
+        for (size_t i = 0; i < paddedSize; i += 4)
+        {
+            __m128 adv = _mm_load_ps(advances + i);
+            __m128 sum = _mm_add_ps(adv, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(adv), 4)));
+            sum = _mm_add_ps(sum, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(sum), 8)));
+            __m128 inclusive = _mm_add_ps(sum, carry);
+            _mm_store_ps(offsets + i, _mm_sub_ps(inclusive, adv));
+            carry = _mm_shuffle_ps(inclusive, inclusive, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        runningSum = _mm_cvtss_f32(carry);
+
+        // Emit the glyphs at their pen positions
+        for (size_t i = 0; i < blockSize; ++i)
+        {
+            WCHAR character = block[i];
+            if (character == ' ')
+                continue;
+            else if (character == '\n')
+            {
+                lineStart = offsets[i];
+                penY += lineHeight;
+            }
+            else if (SpriteFont::HasStaticGlyph(character))
+            {
+                // Empty glyphs still advance the pen, but there's nothing to draw
+                const SpriteFont::CharDesc& desc = font.GetCharDescriptor(character);
+                if (desc.Width <= 0.0f || desc.Height <= 0.0f)
+                    continue;
+
+                glyph.Transform._41 = offsets[i] - lineStart + desc.OffsetX;
+                glyph.Transform._42 = penY + desc.OffsetY;
+                glyph.DrawRect = XMFLOAT4(desc.X, desc.Y, desc.Width, desc.Height);
+                glyphs.push_back(glyph);
+            }
+            else if (glyphCache != NULL)
+            {
+                const SpriteFont::CharDesc& desc = dynamicDescs[i];
+                if (desc.Width <= 0.0f || desc.Height <= 0.0f)
+                    continue;
+
+                glyph.Transform._41 = offsets[i] - lineStart + desc.OffsetX;
+                glyph.Transform._42 = penY + desc.OffsetY;
+                glyph.DrawRect = XMFLOAT4(desc.X, desc.Y, desc.Width, desc.Height);
+                dynamicGlyphs->push_back(glyph);
+            }
+        }
+    }
+}
+
+// Applies a transform to glyphs produced by LayoutText. Since each glyph transform
+// is a pure translation, only the translation row of the result needs to be computed.
+void SpriteRenderer::TransformGlyphs(const SpriteDrawData* glyphs,
+                                     UINT64 numGlyphs,
+                                     const XMMATRIX& transform,
+                                     SpriteDrawData* output)
+{
+    for (UINT64 i = 0; i < numGlyphs; ++i)
+    {
+        XMVECTOR x = XMVectorReplicate(glyphs[i].Transform._41);
+        XMVECTOR y = XMVectorReplicate(glyphs[i].Transform._42);
+        XMVECTOR translation = XMVectorMultiplyAdd(x, transform.r[0], XMVectorMultiplyAdd(y, transform.r[1], transform.r[3]));
+
+        output[i].Color = glyphs[i].Color;
+        output[i].DrawRect = glyphs[i].DrawRect;
+        output[i].Transform.r[0] = transform.r[0];
+        output[i].Transform.r[1] = transform.r[1];
+        output[i].Transform.r[2] = transform.r[2];
+        output[i].Transform.r[3] = translation;
+    }
+}
+
+static SpriteRenderer::PrimitiveInstance MakePrimitive(SpriteRenderer::PrimitiveType type,
+                                                       const XMFLOAT2& position0,
+                                                       const XMFLOAT2& position1,
+                                                       const XMFLOAT4& color,
+                                                       float thickness)
+{
+    XMUBYTEN4 packedColor;
+    XMStoreUByteN4(&packedColor, XMLoadFloat4(&color));
+
+    SpriteRenderer::PrimitiveInstance primitive;
+    primitive.Position0 = position0;
+    primitive.Position1 = position1;
+    primitive.Color = packedColor.v;
+    primitive.Type = static_cast<USHORT>(type);
+    primitive.Thickness = XMConvertFloatToHalf(thickness);
+    return primitive;
+}
+
+SpriteRenderer::PrimitiveInstance SpriteRenderer::CreateRect(const XMFLOAT2& topLeft, const XMFLOAT2& size,
+                                                             const XMFLOAT4& color, float thickness)
+{
+    XMFLOAT2 bottomRight(topLeft.x + size.x, topLeft.y + size.y);
+    return MakePrimitive(PrimitiveRect, topLeft, bottomRight, color, thickness);
+}
+
+SpriteRenderer::PrimitiveInstance SpriteRenderer::CreateLine(const XMFLOAT2& start, const XMFLOAT2& end,
+                                                             const XMFLOAT4& color, float thickness)
+{
+    return MakePrimitive(PrimitiveLine, start, end, color, thickness);
+}
+
+SpriteRenderer::PrimitiveInstance SpriteRenderer::CreateCircle(const XMFLOAT2& center, float radius,
+                                                               const XMFLOAT4& color, float thickness)
+{
+    return MakePrimitive(PrimitiveCircle, center, XMFLOAT2(radius, 0.0f), color, thickness);
+}
+
+void SpriteRenderer::RenderRect(const XMFLOAT2& topLeft,
+                                const XMFLOAT2& size,
+                                const XMFLOAT4& color,
+                                float thickness)
+{
+    _ASSERT(context);
+    FlushSprites();
+    pendingPrimitives.push_back(CreateRect(topLeft, size, color, thickness));
+}
+
+void SpriteRenderer::RenderLine(const XMFLOAT2& start,
+                                const XMFLOAT2& end,
+                                const XMFLOAT4& color,
+                                float thickness)
+{
+    _ASSERT(context);
+    FlushSprites();
+    pendingPrimitives.push_back(CreateLine(start, end, color, thickness));
+}
+
+void SpriteRenderer::RenderCircle(const XMFLOAT2& center,
+                                  float radius,
+                                  const XMFLOAT4& color,
+                                  float thickness)
+{
+    _ASSERT(context);
+    FlushSprites();
+    pendingPrimitives.push_back(CreateCircle(center, radius, color, thickness));
+}
+
+void SpriteRenderer::RenderPrimitives(const PrimitiveInstance* primitives, UINT64 numPrimitives)
+{
+    _ASSERT(context);
+    FlushSprites();
+    pendingPrimitives.insert(pendingPrimitives.end(), primitives, primitives + numPrimitives);
+}
+
+// Draws the lines queued up with RenderGPUText, with one instance per character
+void SpriteRenderer::FlushGPUText()
+{
+    if (gpuTextLines.empty())
+        return;
+
+    D3DPERF_BeginEvent(0xFFFFFFFF, L"SpriteRenderer FlushGPUText");
+
+    const SpriteFont& font = *gpuTextFont;
 
-    // Copy in the instance data
     D3D11_MAPPED_SUBRESOURCE mapped;
-    DXCall(context->Map(instanceDataBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
-    CopyMemory(mapped.pData, drawData, static_cast<size_t>(sizeof(SpriteDrawData) * numSpritesToDraw));
-    context->Unmap(instanceDataBuffer, 0);
+    DXCall(context->Map(gpuTextCharBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+    CopyMemory(mapped.pData, &gpuTextChars[0], sizeof(WCHAR) * gpuTextChars.size());
+    context->Unmap(gpuTextCharBuffer, 0);
+
+    DXCall(context->Map(gpuTextPenXBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+    CopyMemory(mapped.pData, &gpuTextPenX[0], sizeof(float) * gpuTextPenX.size());
+    context->Unmap(gpuTextPenXBuffer, 0);
+
+    DXCall(context->Map(gpuTextLineBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+    CopyMemory(mapped.pData, &gpuTextLines[0], sizeof(GPUTextLine) * gpuTextLines.size());
+    context->Unmap(gpuTextLineBuffer, 0);
+
+    GPUTextCB textConstants;
+    textConstants.NumLines = static_cast<UINT>(gpuTextLines.size());
+    textConstants.NumGlyphTableEntries = SpriteFont::NumGlyphTableEntries;
+    DXCall(context->Map(gpuTextCB, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+    CopyMemory(mapped.pData, &textConstants, sizeof(GPUTextCB));
+    context->Unmap(gpuTextCB, 0);
+
+    context->VSSetShader(gpuTextVS, NULL, 0);
+    context->IASetInputLayout(inputLayout);
+
+    SetPerBatchData(font.SRView());
+
+    ID3D11Buffer* constantBuffers [3] = { vsPerBatchCB, NULL, gpuTextCB };
+    context->VSSetConstantBuffers(0, 3, constantBuffers);
+
+    UINT stride = sizeof(SpriteVertex);
+    UINT offset = 0;
+    ID3D11Buffer* vb = vertexBuffer.GetInterfacePtr();
+    context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
+
+    ID3D11ShaderResourceView* vsResources [4] = { font.GlyphTableSRView(), gpuTextLineSRView,
+                                                  gpuTextCharSRView, gpuTextPenXSRView };
+    context->VSSetShaderResources(0, 4, vsResources);
+
+    ID3D11ShaderResourceView* texture = font.SRView();
+    context->PSSetShaderResources(0, 1, &texture);
+
+    DrawSprites(static_cast<UINT>(gpuTextChars.size()), 0, font.IsDistanceField());
+
+    ID3D11ShaderResourceView* nullResources [4] = { NULL, NULL, NULL, NULL };
+    context->VSSetShaderResources(0, 4, nullResources);
+
+    gpuTextFont = NULL;
+    gpuTextChars.clear();
+    gpuTextPenX.clear();
+    gpuTextLines.clear();
+
+    D3DPERF_EndEvent();
+}
+
+// Draws all queued primitives, MaxPrimitiveBatchSize at a time
+void SpriteRenderer::FlushPrimitives()
+{
+    if (pendingPrimitives.empty())
+        return;
+
+    D3DPERF_BeginEvent(0xFFFFFFFF, L"SpriteRenderer FlushPrimitives");
+
+    const PrimitiveInstance* primitives = &pendingPrimitives[0];
+    UINT64 numRemaining = pendingPrimitives.size();
+    while (numRemaining > 0)
+    {
+        UINT64 numPrimitives = min(numRemaining, MaxPrimitiveBatchSize);
+
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        DXCall(context->Map(primitiveBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+        CopyMemory(mapped.pData, primitives, static_cast<size_t>(sizeof(PrimitiveInstance) * numPrimitives));
+        context->Unmap(primitiveBuffer, 0);
+
+        DrawPrimitives(primitiveBuffer, numPrimitives);
+
+        primitives += numPrimitives;
+        numRemaining -= numPrimitives;
+    }
+
+    pendingPrimitives.clear();
+
+    D3DPERF_EndEvent();
+}
+
+void SpriteRenderer::DrawPrimitives(ID3D11Buffer* instanceBuffer, UINT64 numPrimitives)
+{
+    context->VSSetShader(primitiveVS, NULL, 0);
+    context->IASetInputLayout(inputLayoutPrimitive);
+
+    SetPerBatchData(NULL);
+
+    ID3D11Buffer* constantBuffers [1] = { vsPerBatchCB };
+    context->VSSetConstantBuffers(0, 1, constantBuffers);
+
+    UINT strides [2] = { sizeof(SpriteVertex), sizeof(PrimitiveInstance) };
+    UINT offsets [2] = { 0, 0 };
+    ID3D11Buffer* vertexBuffers [2] = { vertexBuffer, instanceBuffer };
+    context->IASetVertexBuffers(0, 2, vertexBuffers, strides, offsets);
+
+    // Swap in the primitive pixel shader, and put back whatever was bound before
+    ID3D11PixelShaderPtr prevPixelShader;
+    context->PSGetShader(&prevPixelShader, NULL, NULL);
+    context->PSSetShader(primitivePS, NULL, 0);
+
+    context->DrawIndexedInstanced(6, static_cast<UINT>(numPrimitives), 0, 0, 0);
+
+    context->PSSetShader(prevPixelShader, NULL, 0);
+}
+
+bool SpriteRenderer::TextCacheKey::operator<(const TextCacheKey& other) const
+{
+    if (FontID != other.FontID)
+        return FontID < other.FontID;
+    if (Hash != other.Hash)
+        return Hash < other.Hash;
+    return memcmp(&Color, &other.Color, sizeof(XMFLOAT4)) < 0;
+}
+
+// Returns the laid-out glyphs for a string, from the cache if possible
+const SpriteRenderer::TextCacheEntry& SpriteRenderer::GetTextLayout(const SpriteFont& font,
+                                                                    const WCHAR* text,
+                                                                    size_t length,
+                                                                    const XMFLOAT4& color)
+{
+    // FNV-1a hash of the string
+    UINT64 hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= text[i];
+        hash *= 1099511628211ULL;
+    }
+
+    TextCacheKey key;
+    key.FontID = font.ID();
+    key.Hash = hash;
+    key.Color = color;
+
+    // Keep the list in order of use, with the most recently used entry at the front
+    std::pair<TextCache::iterator, bool> inserted = textCache.insert(std::make_pair(key, TextCacheEntry()));
+    TextCacheEntry& entry = inserted.first->second;
+    if (inserted.second)
+    {
+        textCacheLRU.push_front(key);
+        entry.LRUPosition = textCacheLRU.begin();
+        entry.GlyphGeneration = 0;
+
+        while (textCache.size() > TextCacheMaxEntries)
+        {
+            textCache.erase(textCacheLRU.back());
+            textCacheLRU.pop_back();
+        }
+    }
+    else
+        textCacheLRU.splice(textCacheLRU.begin(), textCacheLRU, entry.LRUPosition);
+    entry.LastUsed = textCacheFrame;
+
+    // Lay out the string if it's new, if it collided with a different string, or if
+    // dynamic glyphs were added or evicted since it was laid out
+    GlyphCache* glyphCache = font.DynamicGlyphs();
+    UINT64 glyphGeneration = glyphCache != NULL ? glyphCache->Generation() : 0;
+    if (entry.Text.length() != length || entry.Text.compare(0, length, text, length) != 0
+        || entry.GlyphGeneration != glyphGeneration)
+    {
+        entry.Text.assign(text, length);
+        entry.GlyphGeneration = glyphGeneration;
+        LayoutText(font, text, length, color, entry.Glyphs, &entry.DynamicGlyphs);
+    }
+    else if (!entry.DynamicGlyphs.empty())
+        glyphCache->Touch(text, length);
+
+    return entry;
+}
+
+// Removes layouts that haven't been drawn in a while, which are all at the back of the list
+void SpriteRenderer::EvictTextLayouts()
+{
+    while (!textCacheLRU.empty())
+    {
+        TextCache::iterator it = textCache.find(textCacheLRU.back());
+        if (textCacheFrame - it->second.LastUsed <= TextCacheMaxAge)
+            break;
+
+        textCache.erase(it);
+        textCacheLRU.pop_back();
+    }
+}
+
+void SpriteRenderer::CreateStaticList(ID3D11ShaderResourceView* texture,
+                                      const SpriteDrawData* drawData,
+                                      UINT64 numSprites,
+                                      StaticSpriteList& list) const
+{
+    _ASSERT(initialized);
+    _ASSERT(texture);
+    _ASSERT(numSprites > 0 && numSprites <= UINT_MAX);
+
+    ValidateDrawRects(GetTextureDesc(texture), drawData, numSprites);
+
+    // The instance data never changes, so it can live in an immutable buffer
+    D3D11_BUFFER_DESC desc;
+    desc.Usage = D3D11_USAGE_IMMUTABLE;
+    desc.ByteWidth = static_cast<UINT>(sizeof(SpriteDrawData) * numSprites);
+    desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    desc.CPUAccessFlags = 0;
+    desc.MiscFlags = 0;
+    D3D11_SUBRESOURCE_DATA initData;
+    initData.pSysMem = drawData;
+    initData.SysMemPitch = 0;
+    initData.SysMemSlicePitch = 0;
+
+    list.InstanceBuffer = NULL;
+    DXCall(device->CreateBuffer(&desc, &initData, &list.InstanceBuffer));
+    list.Texture = texture;
+    list.NumSprites = static_cast<UINT>(numSprites);
+}
+
+void SpriteRenderer::CreateStaticList(const PrimitiveInstance* primitives,
+                                      UINT64 numPrimitives,
+                                      StaticSpriteList& list) const
+{
+    _ASSERT(initialized);
+    _ASSERT(numPrimitives > 0 && numPrimitives <= UINT_MAX);
+
+    D3D11_BUFFER_DESC desc;
+    desc.Usage = D3D11_USAGE_IMMUTABLE;
+    desc.ByteWidth = static_cast<UINT>(sizeof(PrimitiveInstance) * numPrimitives);
+    desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    desc.CPUAccessFlags = 0;
+    desc.MiscFlags = 0;
+    D3D11_SUBRESOURCE_DATA initData;
+    initData.pSysMem = primitives;
+    initData.SysMemPitch = 0;
+    initData.SysMemSlicePitch = 0;
+
+    list.InstanceBuffer = NULL;
+    DXCall(device->CreateBuffer(&desc, &initData, &list.InstanceBuffer));
+    list.Texture = NULL;
+    list.NumSprites = static_cast<UINT>(numPrimitives);
+}
+
+void SpriteRenderer::RenderStaticList(const StaticSpriteList& list)
+{
+    _ASSERT(context);
+    _ASSERT(initialized);
+
+    if (list.NumSprites == 0)
+        return;
+
+    FlushSprites();
+    FlushPrimitives();
+
+    D3DPERF_BeginEvent(0xFFFFFFFF, L"SpriteRenderer RenderStaticList");
+
+    if (list.Texture == NULL)
+    {
+        DrawPrimitives(list.InstanceBuffer, list.NumSprites);
+        D3DPERF_EndEvent();
+        return;
+    }
+
+    // Set the vertex shader
+    context->VSSetShader(vertexShaderInstanced, NULL, 0);
+
+    // Set the input layout
+    context->IASetInputLayout(inputLayoutInstanced);
+
+    // Set per-batch constants
+    SetPerBatchData(list.Texture);
 
     // Set the constant buffer
     ID3D11Buffer* constantBuffers [1] = { vsPerBatchCB };
     context->VSSetConstantBuffers(0, 1, constantBuffers);
 
-    // Set the vertex buffers
+    // Set the vertex buffers, using the pre-recorded instance data
     UINT strides [2] = { sizeof(SpriteVertex), sizeof(SpriteDrawData) };
     UINT offsets [2] = { 0, 0 };
-    ID3D11Buffer* vertexBuffers [2] = { vertexBuffer, instanceDataBuffer };
+    ID3D11Buffer* vertexBuffers [2] = { vertexBuffer, list.InstanceBuffer };
     context->IASetVertexBuffers(0, 2, vertexBuffers, strides, offsets);
 
     // Set the texture
+    ID3D11ShaderResourceView* texture = list.Texture;
     context->PSSetShaderResources(0, 1, &texture);
 
     // Draw
-    context->DrawIndexedInstanced(6, static_cast<UINT>(numSpritesToDraw), 0, 0, 0);
+    context->DrawIndexedInstanced(6, list.NumSprites, 0, 0, 0);
 
     D3DPERF_EndEvent();
+}
 
-    // If there's any left to be rendered, do it recursively
-    if(numSprites > numSpritesToDraw)
-        RenderBatch(texture, drawData + numSpritesToDraw, numSprites - numSpritesToDraw);
+void SpriteRenderer::Submit(const SpriteCommandBuffer& commandBuffer)
+{
+    EnterCriticalSection(&submitLock);
+    submittedBuffers.push_back(&commandBuffer);
+    LeaveCriticalSection(&submitLock);
 }
 
-void SpriteRenderer::RenderText(const SpriteFont& font,
-                                const WCHAR* text,
-            				    const XMMATRIX& transform,
-                                const XMFLOAT4& color)
+// Draws all submitted command buffers in sort key order. The sprites from every
+// buffer go through the same batching as immediate draws, so consecutive commands
+// that use the same texture are drawn together.
+void SpriteRenderer::ExecuteCommandBuffers()
 {
-    D3DPERF_BeginEvent(0xFFFFFFFF, L"SpriteRenderer RenderText");
+    EnterCriticalSection(&submitLock);
+    std::vector<const SpriteCommandBuffer*> buffers;
+    buffers.swap(submittedBuffers);
+    LeaveCriticalSection(&submitLock);
 
-    size_t length = wcslen(text);
+    if (buffers.empty())
+        return;
+
+    D3DPERF_BeginEvent(0xFFFFFFFF, L"SpriteRenderer ExecuteCommandBuffers");
+
+    SpriteCommandBuffer::SortForDrawing(buffers);
 
-    XMMATRIX textTransform = XMMatrixIdentity();
+    XMFLOAT2 viewportSize = GetViewportSize();
 
-    UINT64 numCharsToDraw = min(length, MaxBatchSize);
-    UINT64 currentDraw = 0;
-    for (UINT64 i = 0; i < numCharsToDraw; ++i)
+    for (size_t bufferIdx = 0; bufferIdx < buffers.size(); ++bufferIdx)
     {
-        WCHAR character = text[i];
-        if(character == ' ')
-            textTransform._41 += font.SpaceWidth();
-        else if(character == '\n')
+        const SpriteCommandBuffer& buffer = *buffers[bufferIdx];
+        const std::vector<SpriteCommandBuffer::Command>& commands = buffer.Commands();
+        for (size_t cmdIdx = 0; cmdIdx < commands.size(); ++cmdIdx)
         {
-            textTransform._42 += font.CharHeight();
-            textTransform._41 = 0;
-        }
-        else
-        {
-            SpriteFont::CharDesc desc = font.GetCharDescriptor(character);
+            const SpriteCommandBuffer::Command& command = commands[cmdIdx];
+            if (command.Texture == NULL)
+            {
+                RenderPrimitives(buffer.Primitives() + command.FirstSprite, command.NumSprites);
+                continue;
+            }
+
+            const SpriteDrawData* drawData = buffer.Sprites() + command.FirstSprite;
 
-            textDrawData[currentDraw].Transform = XMMatrixMultiply(textTransform, transform);
-            textDrawData[currentDraw].Color = color;
-            textDrawData[currentDraw].DrawRect.x = desc.X;
-            textDrawData[currentDraw].DrawRect.y = desc.Y;
-            textDrawData[currentDraw].DrawRect.z = desc.Width;
-            textDrawData[currentDraw].DrawRect.w = desc.Height;
-            currentDraw++;
+            #ifdef _DEBUG
+                ValidateDrawRects(GetTextureDesc(command.Texture), drawData, command.NumSprites);
+            #endif
 
-            textTransform._41 += desc.Width + 1;
+            QueueSprites(command.Texture, drawData, command.NumSprites, viewportSize, command.DistanceField);
         }
     }
 
-    // Submit a batch
-    RenderBatch(font.SRView(), textDrawData, currentDraw);
+    FlushSprites();
+    FlushPrimitives();
 
     D3DPERF_EndEvent();
+}
+
+// Appends sprites to the shared instance buffer, skipping any that are off-screen.
+// Queued sprites are drawn together until the texture or pixel shader changes, the
+// buffer fills up, the caller changes the state they depend on, or something else
+// needs to be drawn.
+void SpriteRenderer::QueueSprites(ID3D11ShaderResourceView* texture,
+                                  const SpriteDrawData* drawData,
+                                  UINT64 numSprites,
+                                  const XMFLOAT2& viewportSize,
+                                  bool distanceField)
+{
+    FlushPrimitives();
+    FlushGPUText();
 
-    if(length > numCharsToDraw)
-        RenderText(font, text + numCharsToDraw, textTransform, color);
+    while (numSprites > 0)
+    {
+        // Kick off the pending draw if the texture changes or we run out of room
+        if (texture != batchTexture || distanceField != batchDistanceField || numBuffered == MaxBatchSize)
+        {
+            FlushSprites();
+            if (numBuffered == MaxBatchSize)
+            {
+                numBuffered = 0;
+                batchStart = 0;
+            }
+            batchTexture = texture;
+            batchDistanceField = distanceField;
+        }
+
+        // Append without overwriting instances that are still pending, and
+        // discard the buffer when we wrap around
+        UINT64 numToProcess = min(numSprites, MaxBatchSize - numBuffered);
+        D3D11_MAP mapType = numBuffered == 0 ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        DXCall(context->Map(instanceDataBuffer, 0, mapType, 0, &mapped));
+        SpriteDrawData* dst = reinterpret_cast<SpriteDrawData*>(mapped.pData) + numBuffered;
+        numBuffered += CullSprites(drawData, numToProcess, viewportSize, dst);
+        context->Unmap(instanceDataBuffer, 0);
+
+        drawData += numToProcess;
+        numSprites -= numToProcess;
+    }
+}
+
+// Draws the sprites and text queued up since the last flush
+void SpriteRenderer::FlushSprites()
+{
+    DrawInstances(batchTexture, batchStart, numBuffered - batchStart, batchDistanceField);
+    batchStart = numBuffered;
+    FlushGPUText();
+}
+
+// Draws a range of sprites that were already copied into the instance buffer
+void SpriteRenderer::DrawInstances(ID3D11ShaderResourceView* texture, UINT64 startInstance, UINT64 numInstances,
+                                   bool distanceField)
+{
+    if (numInstances == 0)
+        return;
+
+    context->VSSetShader(vertexShaderInstanced, NULL, 0);
+    context->IASetInputLayout(inputLayoutInstanced);
+
+    SetPerBatchData(texture);
+
+    ID3D11Buffer* constantBuffers [1] = { vsPerBatchCB };
+    context->VSSetConstantBuffers(0, 1, constantBuffers);
+
+    UINT strides [2] = { sizeof(SpriteVertex), sizeof(SpriteDrawData) };
+    UINT offsets [2] = { 0, 0 };
+    ID3D11Buffer* vertexBuffers [2] = { vertexBuffer, instanceDataBuffer };
+    context->IASetVertexBuffers(0, 2, vertexBuffers, strides, offsets);
+
+    context->PSSetShaderResources(0, 1, &texture);
+
+    DrawSprites(static_cast<UINT>(numInstances), static_cast<UINT>(startInstance), distanceField);
+}
+
+// Issues an instanced draw of sprite quads with whatever's already bound
+void SpriteRenderer::DrawSprites(UINT numInstances, UINT startInstance, bool distanceField)
+{
+    // Distance fields need bilinear filtering no matter what filter mode Begin was given
+    if (distanceField)
+    {
+        ID3D11PixelShaderPtr prevPixelShader;
+        ID3D11SamplerStatePtr prevSampler;
+        context->PSGetShader(&prevPixelShader, NULL, NULL);
+        context->PSGetSamplers(0, 1, &prevSampler);
+        context->PSSetShader(distanceFieldPS, NULL, 0);
+        context->PSSetSamplers(0, 1, &(linearSamplerState.GetInterfacePtr()));
+
+        context->DrawIndexedInstanced(6, numInstances, 0, 0, startInstance);
+
+        context->PSSetShader(prevPixelShader, NULL, 0);
+        context->PSSetSamplers(0, 1, &(prevSampler.GetInterfacePtr()));
+    }
+    else
+        context->DrawIndexedInstanced(6, numInstances, 0, 0, startInstance);
 }
 
 void SpriteRenderer::End()
 {
     _ASSERT(context);
     _ASSERT(initialized);
+
+    FlushSprites();
+    FlushPrimitives();
+    ExecuteCommandBuffers();
+
+    // Don't hold on to the caller's render targets between frames
+    pendingState = PipelineState();
     context = NULL;
 
+    ++textCacheFrame;
+    if (textCacheFrame % TextCacheEvictInterval == 0)
+        EvictTextLayouts();
+
     D3DPERF_EndEvent();
 }
 
@@ -11,6 +11,8 @@
 
 #include "PCH.h"
 
+#include <list>
+
 #include "Exceptions.h"
 #include "Utility.h"
 #include "InterfacePointers.h"
@@ -19,6 +21,7 @@ namespace SampleFramework11
 {
 
 class SpriteFont;
+class SpriteCommandBuffer;
 
 class SpriteRenderer
 {
@@ -32,7 +35,17 @@ public:
         Point = 2
     };
 
+    enum PrimitiveType
+    {
+        PrimitiveRect = 0,
+        PrimitiveLine = 1,
+        PrimitiveCircle = 2
+    };
+
     static const UINT64 MaxBatchSize = 1000;
+    static const UINT64 MaxPrimitiveBatchSize = 4096;
+    static const UINT64 MaxGPUTextChars = 65536;
+    static const UINT64 MaxGPUTextLines = 4096;
 
     struct SpriteDrawData
     {
@@ -41,6 +54,30 @@ public:
         XMFLOAT4 DrawRect;
     };
 
+    // Instance data for an untextured primitive, packed into 24 bytes. Rects use the
+    // top-left and bottom-right corners, lines use the two end points, and circles
+    // use the center and (radius, 0). A thickness of 0 means a filled rect or circle.
+    struct PrimitiveInstance
+    {
+        XMFLOAT2 Position0;
+        XMFLOAT2 Position1;
+        UINT Color;
+        USHORT Type;
+        HALF Thickness;
+    };
+
+    // A list of sprites recorded once into an immutable instance buffer, which
+    // can then be replayed every frame with a single instanced draw. Lists
+    // without a texture hold primitives instead of sprites.
+    struct StaticSpriteList
+    {
+        ID3D11BufferPtr InstanceBuffer;
+        ID3D11ShaderResourceViewPtr Texture;
+        UINT NumSprites;
+
+        StaticSpriteList() : NumSprites(0) {}
+    };
+
 	SpriteRenderer();
 	~SpriteRenderer();
 
@@ -53,6 +90,10 @@ public:
                 const XMFLOAT4& color = XMFLOAT4(1, 1, 1, 1),
                 const XMFLOAT4* drawRect = NULL);
 
+    // Sprites drawn with RenderBatch and RenderText are batched, and drawn together
+    // with the following sprites that use the same texture. Use a texture atlas
+    // to get as many sprites as possible into one batch. Call StateChanged after
+    // binding a different viewport, pixel shader, sampler or render target between draws.
     void RenderBatch(ID3D11ShaderResourceView* texture,
                      const SpriteDrawData* drawData,
                      UINT64 numSprites);
@@ -62,23 +103,153 @@ public:
 				    const XMMATRIX& transform,
                     const XMFLOAT4& color = XMFLOAT4(1, 1, 1, 1));
 
+    // Draws text that's laid out in the vertex shader. Only the characters and their pen
+    // positions (6 bytes each) and one 96-byte header per line are uploaded, and the shader
+    // looks up each glyph's offset and size in the font's glyph table. Lines are queued up and drawn together until
+    // something else is drawn, or the font changes. Characters outside of the font's
+    // static glyph page advance like a space.
+    void RenderGPUText(const SpriteFont& font,
+                       const WCHAR* text,
+                       const XMMATRIX& transform,
+                       const XMFLOAT4& color = XMFLOAT4(1, 1, 1, 1));
+
+    static void LayoutText(const SpriteFont& font,
+                           const WCHAR* text,
+                           size_t length,
+                           const XMFLOAT4& color,
+                           std::vector<SpriteDrawData>& glyphs);
+
+    // Glyphs from the font's dynamic glyph page go into a separate list, since they
+    // use a different texture. Characters the font can't draw are skipped.
+    static void LayoutText(const SpriteFont& font,
+                           const WCHAR* text,
+                           size_t length,
+                           const XMFLOAT4& color,
+                           std::vector<SpriteDrawData>& glyphs,
+                           std::vector<SpriteDrawData>* dynamicGlyphs);
+
+    static void TransformGlyphs(const SpriteDrawData* glyphs,
+                                UINT64 numGlyphs,
+                                const XMMATRIX& transform,
+                                SpriteDrawData* output);
+
+    // Untextured primitives are queued up, and drawn together the next time
+    // a textured sprite is drawn or at End
+    void RenderRect(const XMFLOAT2& topLeft,
+                    const XMFLOAT2& size,
+                    const XMFLOAT4& color,
+                    float thickness = 0.0f);
+
+    void RenderLine(const XMFLOAT2& start,
+                    const XMFLOAT2& end,
+                    const XMFLOAT4& color,
+                    float thickness = 1.0f);
+
+    void RenderCircle(const XMFLOAT2& center,
+                      float radius,
+                      const XMFLOAT4& color,
+                      float thickness = 0.0f);
+
+    void RenderPrimitives(const PrimitiveInstance* primitives, UINT64 numPrimitives);
+
+    static PrimitiveInstance CreateRect(const XMFLOAT2& topLeft, const XMFLOAT2& size,
+                                        const XMFLOAT4& color, float thickness = 0.0f);
+    static PrimitiveInstance CreateLine(const XMFLOAT2& start, const XMFLOAT2& end,
+                                        const XMFLOAT4& color, float thickness = 1.0f);
+    static PrimitiveInstance CreateCircle(const XMFLOAT2& center, float radius,
+                                          const XMFLOAT4& color, float thickness = 0.0f);
+
+    void CreateStaticList(ID3D11ShaderResourceView* texture,
+                          const SpriteDrawData* drawData,
+                          UINT64 numSprites,
+                          StaticSpriteList& list) const;
+
+    void CreateStaticList(const PrimitiveInstance* primitives,
+                          UINT64 numPrimitives,
+                          StaticSpriteList& list) const;
+
+    void RenderStaticList(const StaticSpriteList& list);
+
+    // Queues a recorded command buffer to be drawn at End. Can be called from any
+    // thread, and the buffer must not be modified until End has been called.
+    void Submit(const SpriteCommandBuffer& commandBuffer);
+
+    // Draws anything that's still queued with the viewport, pixel shader, sampler and render
+    // target that were bound at Begin or the previous StateChanged, and then picks up the
+    // ones that are bound now. Only the state is checked here, never on every draw.
+    void StateChanged();
+
     void End();
 
+    static D3D11_TEXTURE2D_DESC GetTextureDesc(ID3D11ShaderResourceView* texture);
+
+    static bool IsSpriteVisible(const SpriteDrawData& sprite, const XMFLOAT2& viewportSize);
+    static UINT64 CullSprites(const SpriteDrawData* drawData,
+                              UINT64 numSprites,
+                              const XMFLOAT2& viewportSize,
+                              SpriteDrawData* output);
+
 protected:
 
+    // The state that queued draws depend on, which callers can change between draws
+    // as long as they call StateChanged
+    struct PipelineState
+    {
+        D3D11_VIEWPORT Viewport;
+        ID3D11PixelShaderPtr PixelShader;
+        ID3D11SamplerStatePtr Sampler;
+        ID3D11RenderTargetViewPtr RenderTarget;
+        ID3D11DepthStencilViewPtr DepthStencil;
+    };
+
+    void GetPipelineState(PipelineState& state);
+    void SetPipelineState(const PipelineState& state);
+
     D3D11_TEXTURE2D_DESC SetPerBatchData(ID3D11ShaderResourceView* texture);
+    XMFLOAT2 GetViewportSize();
+    static void ValidateDrawRects(const D3D11_TEXTURE2D_DESC& desc, const SpriteDrawData* drawData, UINT64 numSprites);
+
+    struct TextCacheEntry;
+    const TextCacheEntry& GetTextLayout(const SpriteFont& font, const WCHAR* text,
+                                        size_t length, const XMFLOAT4& color);
+    void RenderGlyphs(ID3D11ShaderResourceView* texture, const std::vector<SpriteDrawData>& glyphs,
+                      const XMMATRIX& transform, bool distanceField);
+    void EvictTextLayouts();
+    void ExecuteCommandBuffers();
+    void QueueSprites(ID3D11ShaderResourceView* texture, const SpriteDrawData* drawData,
+                      UINT64 numSprites, const XMFLOAT2& viewportSize, bool distanceField = false);
+    void FlushSprites();
+    void DrawInstances(ID3D11ShaderResourceView* texture, UINT64 startInstance, UINT64 numInstances,
+                       bool distanceField);
+    void DrawSprites(UINT numInstances, UINT startInstance, bool distanceField);
+    void FlushGPUText();
+    void FlushPrimitives();
+    void DrawPrimitives(ID3D11Buffer* instanceBuffer, UINT64 numPrimitives);
 
 	ID3D11DevicePtr device;
 	ID3D11VertexShaderPtr vertexShader;
     ID3D11VertexShaderPtr vertexShaderInstanced;
 	ID3D11PixelShaderPtr pixelShader;
+    ID3D11PixelShaderPtr distanceFieldPS;
+    ID3D11VertexShaderPtr gpuTextVS;
+    ID3D11VertexShaderPtr primitiveVS;
+    ID3D11PixelShaderPtr primitivePS;
 	ID3D11BufferPtr vertexBuffer;
 	ID3D11BufferPtr indexBuffer;
     ID3D11BufferPtr vsPerBatchCB;
     ID3D11BufferPtr vsPerInstanceCB;
     ID3D11BufferPtr instanceDataBuffer;
+    ID3D11BufferPtr primitiveBuffer;
+    ID3D11BufferPtr gpuTextCharBuffer;
+    ID3D11BufferPtr gpuTextPenXBuffer;
+    ID3D11BufferPtr gpuTextLineBuffer;
+    ID3D11BufferPtr gpuTextCB;
+    ID3D11ShaderResourceViewPtr gpuTextCharSRView;
+    ID3D11ShaderResourceViewPtr gpuTextPenXSRView;
+    ID3D11ShaderResourceViewPtr gpuTextLineSRView;
 	ID3D11InputLayoutPtr inputLayout;
     ID3D11InputLayoutPtr inputLayoutInstanced;
+    ID3D11InputLayoutPtr inputLayoutPrimitive;
     ID3D11DeviceContextPtr context;
 
     ID3D11RasterizerStatePtr rastState;
@@ -89,7 +260,71 @@ protected:
 
     bool initialized;
 
-    SpriteDrawData textDrawData [MaxBatchSize];
+    // Sprites in the instance buffer that haven't been drawn yet
+    ID3D11ShaderResourceView* batchTexture;
+    bool batchDistanceField;
+    UINT64 numBuffered;
+    UINT64 batchStart;
+
+    std::vector<SpriteDrawData> textDrawData;
+    std::vector<PrimitiveInstance> pendingPrimitives;
+
+    // What was bound when the pending sprites, primitives or text were queued
+    PipelineState pendingState;
+
+    // Matches GPUTextLine in Sprite.hlsl. The shader reads it as 6 float4's, so the
+    // character indices are stored as floats (which are exact up to MaxGPUTextChars).
+    struct GPUTextLine
+    {
+        XMFLOAT4X4 Transform;
+        XMFLOAT4 Color;
+        float FirstChar;
+        float NumChars;
+        float PenY;
+        float Padding;
+    };
+
+    // Lines queued up with RenderGPUText, which all use the same font
+    const SpriteFont* gpuTextFont;
+    std::vector<WCHAR> gpuTextChars;
+    std::vector<float> gpuTextPenX;
+    std::vector<GPUTextLine> gpuTextLines;
+
+    // Laid-out glyphs for strings that were drawn recently, keyed by font + text + color.
+    // Fonts are identified by SpriteFont::ID, since a freed font's address can be reused.
+    struct TextCacheKey
+    {
+        UINT64 FontID;
+        UINT64 Hash;
+        XMFLOAT4 Color;
+
+        bool operator<(const TextCacheKey& other) const;
+    };
+
+    struct TextCacheEntry
+    {
+        std::wstring Text;
+        std::vector<SpriteDrawData> Glyphs;
+        std::vector<SpriteDrawData> DynamicGlyphs;
+        UINT64 GlyphGeneration;
+        UINT64 LastUsed;
+        std::list<TextCacheKey>::iterator LRUPosition;
+    };
+
+    typedef std::map<TextCacheKey, TextCacheEntry> TextCache;
+
+    // Entries are evicted once they haven't been drawn for TextCacheMaxAge frames, or
+    // least recently used first once there are more than TextCacheMaxEntries of them
+    static const UINT64 TextCacheMaxAge = 256;
+    static const UINT64 TextCacheEvictInterval = 64;
+    static const UINT64 TextCacheMaxEntries = 1024;
+
+    TextCache textCache;
+    std::list<TextCacheKey> textCacheLRU;
+    UINT64 textCacheFrame;
+
+    std::vector<const SpriteCommandBuffer*> submittedBuffers;
+    CRITICAL_SECTION submitLock;
 
     struct SpriteVertex
     {
@@ -103,6 +338,12 @@ protected:
         XMFLOAT2 ViewportSize;
     };
 
+    struct GPUTextCB
+    {
+        UINT NumLines;
+        UINT NumGlyphTableEntries;
+    };
+
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,632 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "TangentSpace.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace SampleFramework11
+{
+
+// Work is handed out to the threads in blocks, so that tiny iterations don't get swamped
+// by the scheduling overhead
+static const size_t BlockSize = 4096;
+
+static const uint32_t EmptyBucket = 0xFFFFFFFF;
+
+template<typename TFunc> static void ParallelForBlocks(size_t count, const TFunc& func)
+{
+    ParallelFor(0, (count + BlockSize - 1) / BlockSize, [&](size_t block)
+    {
+        const size_t end = std::min(count, (block + 1) * BlockSize);
+        for (size_t i = block * BlockSize; i < end; ++i)
+            func(i);
+    });
+}
+
+// FNV-1a
+static uint32_t HashBytes(const void* data, size_t size, uint32_t hash = 2166136261u)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+// Makes an open addressing hash table with room for at least twice as many ids as it will hold
+static void InitHashTable(std::vector<uint32_t>& table, size_t numIds)
+{
+    size_t size = 16;
+    while (size < numIds * 2)
+        size *= 2;
+    table.assign(size, EmptyBucket);
+}
+
+// Returns the id already in the table that's equal to id, or inserts id and returns it
+template<typename TEqual> static uint32_t FindOrInsert(std::vector<uint32_t>& table, uint32_t id,
+                                                       uint32_t hash, const TEqual& equal)
+{
+    const size_t mask = table.size() - 1;
+    for (size_t bucket = hash & mask; ; bucket = (bucket + 1) & mask)
+    {
+        if (table[bucket] == EmptyBucket)
+        {
+            table[bucket] = id;
+            return id;
+        }
+
+        if (equal(table[bucket], id))
+            return table[bucket];
+    }
+}
+
+static const float* Attribute(const float* stream, uint32_t stride, uint32_t vertex)
+{
+    return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(stream) + size_t(vertex) * stride);
+}
+
+void WeldVertices(const VertexStreams& streams, uint32_t* weldedVertices)
+{
+    const float* attributes[3] = { streams.Positions, streams.Normals, streams.TexCoords };
+    const size_t sizes[3] = { 3 * sizeof(float), 3 * sizeof(float), 2 * sizeof(float) };
+
+    std::vector<uint32_t> hashes(streams.NumVertices);
+    ParallelForBlocks(streams.NumVertices, [&](size_t v)
+    {
+        uint32_t hash = 2166136261u;
+        for (uint32_t a = 0; a < 3; ++a)
+            if (attributes[a] != NULL)
+                hash = HashBytes(Attribute(attributes[a], streams.VertexStride, uint32_t(v)), sizes[a], hash);
+        hashes[v] = hash;
+    });
+
+    auto equal = [&](uint32_t v0, uint32_t v1) -> bool
+    {
+        for (uint32_t a = 0; a < 3; ++a)
+        {
+            if (attributes[a] != NULL && memcmp(Attribute(attributes[a], streams.VertexStride, v0),
+                                                Attribute(attributes[a], streams.VertexStride, v1), sizes[a]) != 0)
+                return false;
+        }
+        return true;
+    };
+
+    // Inserting in order makes the first vertex of each group the one that the others weld to
+    std::vector<uint32_t> table;
+    InitHashTable(table, streams.NumVertices);
+    for (uint32_t v = 0; v < streams.NumVertices; ++v)
+        weldedVertices[v] = FindOrInsert(table, v, hashes[v], equal);
+}
+
+struct Float3
+{
+    float x, y, z;
+
+    Float3() {}
+    Float3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+    explicit Float3(const float* v) : x(v[0]), y(v[1]), z(v[2]) {}
+
+    Float3 operator+(const Float3& v) const { return Float3(x + v.x, y + v.y, z + v.z); }
+    Float3 operator-(const Float3& v) const { return Float3(x - v.x, y - v.y, z - v.z); }
+    Float3 operator*(float s) const { return Float3(x * s, y * s, z * s); }
+};
+
+static float Dot(const Float3& a, const Float3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static Float3 Cross(const Float3& a, const Float3& b)
+{
+    return Float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+// Returns zero for zero length vectors
+static Float3 Normalize(const Float3& v)
+{
+    const float length = std::sqrt(Dot(v, v));
+    return length > 0.0f ? v * (1.0f / length) : Float3(0.0f, 0.0f, 0.0f);
+}
+
+// Removes the part of v that's along the unit vector n
+static Float3 Project(const Float3& v, const Float3& n)
+{
+    return Normalize(v - n * Dot(n, v));
+}
+
+// Picks the axis that's furthest from n, for when nothing better is available
+static Float3 AnyPerpendicular(const Float3& n)
+{
+    const float ax = std::abs(n.x), ay = std::abs(n.y), az = std::abs(n.z);
+    Float3 axis(0.0f, 0.0f, 1.0f);
+    if (ax <= ay && ax <= az)
+        axis = Float3(1.0f, 0.0f, 0.0f);
+    else if (ay <= az)
+        axis = Float3(0.0f, 1.0f, 0.0f);
+    return Project(axis, n);
+}
+
+// Buckets the corners by welded vertex, keeping them in index order within each bucket.
+// The corners of vertex v end up in vertexCorners[cornerOffsets[v]] to vertexCorners[cornerOffsets[v + 1]].
+static void BucketCorners(const uint32_t* indices, size_t numIndices, const uint32_t* weldedVertices,
+                          uint32_t numVertices, std::vector<uint32_t>& cornerOffsets,
+                          std::vector<uint32_t>& vertexCorners)
+{
+    cornerOffsets.assign(numVertices + 1, 0);
+    for (size_t i = 0; i < numIndices; ++i)
+        ++cornerOffsets[weldedVertices[indices[i]] + 1];
+    for (uint32_t v = 0; v < numVertices; ++v)
+        cornerOffsets[v + 1] += cornerOffsets[v];
+
+    vertexCorners.resize(numIndices);
+    std::vector<uint32_t> nextCorner(cornerOffsets.begin(), cornerOffsets.end() - 1);
+    for (size_t i = 0; i < numIndices; ++i)
+        vertexCorners[nextCorner[weldedVertices[indices[i]]]++] = uint32_t(i);
+}
+
+// The triangle has a texture space that preserves the orientation of the surface
+static const uint8_t OrientationPreserving = 1;
+
+// The triangle has no texture space, so it takes its tangents from its neighbors
+static const uint8_t DegenerateTexCoords = 2;
+
+// An edge between two welded vertices, going from corner Corner to the next corner of its triangle
+struct DirectedEdge
+{
+    uint32_t From;
+    uint32_t To;
+    uint32_t Corner;
+
+    bool operator<(const DirectedEdge& other) const
+    {
+        if (From != other.From)
+            return From < other.From;
+        if (To != other.To)
+            return To < other.To;
+        return Corner < other.Corner;
+    }
+};
+
+// Finds the triangle across each edge, where edge i of a triangle goes from its corner i to
+// corner i + 1. Triangles are only neighbors if they use the edge in opposite directions,
+// and triangles that use a welded vertex more than once don't get any. When more than two
+// triangles share an edge, they're paired up in order.
+static void FindNeighbors(const uint32_t* indices, size_t numIndices, const uint32_t* weldedVertices,
+                          std::vector<uint32_t>& neighbors)
+{
+    std::vector<DirectedEdge> edges;
+    edges.reserve(numIndices);
+    for (size_t triangle = 0; triangle < numIndices / 3; ++triangle)
+    {
+        uint32_t v[3];
+        for (uint32_t i = 0; i < 3; ++i)
+            v[i] = weldedVertices[indices[triangle * 3 + i]];
+        if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0])
+            continue;
+
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            DirectedEdge edge = { v[i], v[(i + 1) % 3], uint32_t(triangle * 3 + i) };
+            edges.push_back(edge);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    neighbors.assign(numIndices, EmptyBucket);
+    for (size_t e = 0; e < edges.size(); ++e)
+    {
+        const DirectedEdge& edge = edges[e];
+        if (neighbors[edge.Corner] != EmptyBucket)
+            continue;
+
+        const DirectedEdge reversed = { edge.To, edge.From, 0 };
+        for (auto other = std::lower_bound(edges.begin(), edges.end(), reversed);
+             other != edges.end() && other->From == edge.To && other->To == edge.From; ++other)
+        {
+            if (neighbors[other->Corner] == EmptyBucket)
+            {
+                neighbors[edge.Corner] = other->Corner / 3;
+                neighbors[other->Corner] = edge.Corner / 3;
+                break;
+            }
+        }
+    }
+}
+
+// Splits the corners around each welded vertex into groups the way MikkTSpace does. A group
+// starts at the first corner that isn't in one yet, and grows across the edges around its
+// vertex to every triangle with the same orientation. Triangles without a texture space
+// take on the orientation of the first group that reaches them. Since that depends on the
+// order that the groups are made in, this runs on one thread. Corners that don't end up
+// in a group get EmptyBucket.
+static void GroupCorners(const uint32_t* indices, size_t numIndices, const uint32_t* weldedVertices,
+                         const std::vector<uint32_t>& neighbors, std::vector<uint8_t>& triangleFlags,
+                         std::vector<uint32_t>& cornerGroups, std::vector<uint8_t>& groupOrientations)
+{
+    cornerGroups.assign(numIndices, EmptyBucket);
+    groupOrientations.clear();
+
+    std::vector<uint32_t> stack;
+    for (size_t firstCorner = 0; firstCorner < numIndices; ++firstCorner)
+    {
+        if ((triangleFlags[firstCorner / 3] & DegenerateTexCoords) || cornerGroups[firstCorner] != EmptyBucket)
+            continue;
+
+        const uint32_t group = uint32_t(groupOrientations.size());
+        const uint32_t vertex = weldedVertices[indices[firstCorner]];
+        const uint8_t orientation = triangleFlags[firstCorner / 3] & OrientationPreserving;
+        groupOrientations.push_back(orientation);
+
+        stack.push_back(uint32_t(firstCorner / 3));
+        while (!stack.empty())
+        {
+            const uint32_t triangle = stack.back();
+            stack.pop_back();
+
+            uint32_t i = 0;
+            while (weldedVertices[indices[triangle * 3 + i]] != vertex)
+                ++i;
+            const size_t corner = triangle * 3 + i;
+            if (cornerGroups[corner] != EmptyBucket)
+                continue;
+
+            uint8_t& flags = triangleFlags[triangle];
+            if ((flags & DegenerateTexCoords) && cornerGroups[triangle * 3] == EmptyBucket
+                && cornerGroups[triangle * 3 + 1] == EmptyBucket && cornerGroups[triangle * 3 + 2] == EmptyBucket)
+                flags = (flags & ~OrientationPreserving) | orientation;
+            if ((flags & OrientationPreserving) != orientation)
+                continue;
+
+            cornerGroups[corner] = group;
+
+            // Both of the triangle's edges that touch the vertex
+            const uint32_t left = neighbors[triangle * 3 + (i + 2) % 3];
+            const uint32_t right = neighbors[corner];
+            if (left != EmptyBucket)
+                stack.push_back(left);
+            if (right != EmptyBucket)
+                stack.push_back(right);
+        }
+    }
+}
+
+void ComputeTangents(const VertexStreams& streams, const uint32_t* indices, size_t numIndices,
+                     float* cornerTangents)
+{
+    const uint32_t stride = streams.VertexStride;
+    const size_t numTriangles = numIndices / 3;
+
+    std::vector<uint32_t> weldedVertices(streams.NumVertices);
+    WeldVertices(streams, &weldedVertices[0]);
+
+    // Work out each corner's angle weighted tangent, one triangle at a time
+    std::vector<Float3> contributions(numIndices);
+    std::vector<uint8_t> triangleFlags(numTriangles);
+    ParallelForBlocks(numTriangles, [&](size_t triangle)
+    {
+        const uint32_t* triIndices = indices + triangle * 3;
+        Float3 p[3];
+        const float* uv[3];
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            p[i] = Float3(Attribute(streams.Positions, stride, triIndices[i]));
+            uv[i] = Attribute(streams.TexCoords, stride, triIndices[i]);
+        }
+
+        // The direction of increasing u, signed so that it agrees with the triangle's orientation
+        const Float3 d1 = p[1] - p[0];
+        const Float3 d2 = p[2] - p[0];
+        const float t21x = uv[1][0] - uv[0][0], t21y = uv[1][1] - uv[0][1];
+        const float t31x = uv[2][0] - uv[0][0], t31y = uv[2][1] - uv[0][1];
+        const float signedArea = t21x * t31y - t21y * t31x;
+        Float3 faceTangent = d1 * t31y - d2 * t21y;
+        if (signedArea < 0.0f)
+            faceTangent = faceTangent * -1.0f;
+        faceTangent = Normalize(faceTangent);
+
+        uint8_t flags = signedArea > 0.0f ? OrientationPreserving : 0;
+        if (signedArea == 0.0f || Dot(faceTangent, faceTangent) == 0.0f)
+            flags |= DegenerateTexCoords;
+        triangleFlags[triangle] = flags;
+
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            const Float3 n(Attribute(streams.Normals, stride, triIndices[i]));
+            const Float3 edge0 = Project(p[(i + 2) % 3] - p[i], n);
+            const Float3 edge1 = Project(p[(i + 1) % 3] - p[i], n);
+            const float angle = std::acos(std::max(-1.0f, std::min(1.0f, Dot(edge0, edge1))));
+            contributions[triangle * 3 + i] = (flags & DegenerateTexCoords) ? Float3(0.0f, 0.0f, 0.0f)
+                                                                            : Project(faceTangent, n) * angle;
+        }
+    });
+
+    std::vector<uint32_t> neighbors;
+    FindNeighbors(indices, numIndices, &weldedVertices[0], neighbors);
+
+    std::vector<uint32_t> cornerGroups;
+    std::vector<uint8_t> groupOrientations;
+    GroupCorners(indices, numIndices, &weldedVertices[0], neighbors, triangleFlags, cornerGroups, groupOrientations);
+    const uint32_t numGroups = uint32_t(groupOrientations.size());
+
+    // Bucket the corners by group, keeping them in index order within each one
+    std::vector<uint32_t> groupOffsets(numGroups + 1, 0);
+    for (size_t i = 0; i < numIndices; ++i)
+        if (cornerGroups[i] != EmptyBucket)
+            ++groupOffsets[cornerGroups[i] + 1];
+    for (uint32_t g = 0; g < numGroups; ++g)
+        groupOffsets[g + 1] += groupOffsets[g];
+
+    std::vector<uint32_t> groupCorners(groupOffsets[numGroups]);
+    std::vector<uint32_t> nextCorner(groupOffsets.begin(), groupOffsets.end() - 1);
+    for (size_t i = 0; i < numIndices; ++i)
+        if (cornerGroups[i] != EmptyBucket)
+            groupCorners[nextCorner[cornerGroups[i]]++] = uint32_t(i);
+
+    // Sum up each group's corners
+    std::vector<Float3> groupTangents(numGroups);
+    ParallelForBlocks(numGroups, [&](size_t g)
+    {
+        Float3 sum(0.0f, 0.0f, 0.0f);
+        for (uint32_t i = groupOffsets[g]; i < groupOffsets[g + 1]; ++i)
+            sum = sum + contributions[groupCorners[i]];
+
+        groupTangents[g] = Normalize(sum);
+        if (Dot(groupTangents[g], groupTangents[g]) == 0.0f)
+        {
+            const uint32_t vertex = indices[groupCorners[groupOffsets[g]]];
+            groupTangents[g] = AnyPerpendicular(Float3(Attribute(streams.Normals, stride, vertex)));
+        }
+    });
+
+    // Corners that aren't in a group use the first group at their vertex, like MikkTSpace
+    // does for degenerate triangles
+    std::vector<uint32_t> vertexGroups(streams.NumVertices, EmptyBucket);
+    for (size_t i = 0; i < numIndices; ++i)
+    {
+        uint32_t& vertexGroup = vertexGroups[weldedVertices[indices[i]]];
+        if (vertexGroup == EmptyBucket)
+            vertexGroup = cornerGroups[i];
+    }
+
+    ParallelForBlocks(numIndices, [&](size_t corner)
+    {
+        uint32_t group = cornerGroups[corner];
+        if (group == EmptyBucket)
+            group = vertexGroups[weldedVertices[indices[corner]]];
+
+        Float3 tangentDir;
+        float sign = 1.0f;
+        if (group != EmptyBucket)
+        {
+            tangentDir = groupTangents[group];
+            sign = groupOrientations[group] ? 1.0f : -1.0f;
+        }
+        else
+            tangentDir = AnyPerpendicular(Float3(Attribute(streams.Normals, stride, indices[corner])));
+
+        float* tangent = cornerTangents + corner * 4;
+        tangent[0] = tangentDir.x;
+        tangent[1] = tangentDir.y;
+        tangent[2] = tangentDir.z;
+        tangent[3] = sign;
+    });
+}
+
+// How many times wider than the weld epsilon the spatial hash cells are
+static const float WeldCellScale = 16.0f;
+
+// Cell coordinates are clamped so that they always fit in an int32_t, even for huge positions
+static int32_t CellCoordinate(float position, float cellScale)
+{
+    const float cell = std::floor(position * cellScale);
+    return int32_t(std::max(-1073741824.0f, std::min(1073741824.0f, cell)));
+}
+
+void WeldPositions(const VertexStreams& streams, float epsilon, uint32_t* weldedVertices)
+{
+    if (epsilon <= 0.0f)
+    {
+        VertexStreams positionStreams = { streams.Positions, NULL, NULL, streams.VertexStride, streams.NumVertices };
+        WeldVertices(positionStreams, weldedVertices);
+        return;
+    }
+
+    // The cells are much wider than epsilon, so that most vertices only need to look in
+    // their own cell, and only the ones near a cell's edge need to look across it
+    const float cellScale = 1.0f / (epsilon * WeldCellScale);
+    const float epsilonSq = epsilon * epsilon;
+    std::vector<int32_t> cells(streams.NumVertices * 3);
+    ParallelForBlocks(streams.NumVertices, [&](size_t v)
+    {
+        const float* position = Attribute(streams.Positions, streams.VertexStride, uint32_t(v));
+        for (uint32_t i = 0; i < 3; ++i)
+            cells[v * 3 + i] = CellCoordinate(position[i], cellScale);
+    });
+
+    // Each bucket holds a list of the vertices that weren't welded to anything, linked
+    // through nextVertex. Vertices are added in order, and weld to the lowest vertex
+    // within epsilon, so the results are always the same.
+    std::vector<uint32_t> buckets;
+    InitHashTable(buckets, streams.NumVertices);
+    const size_t mask = buckets.size() - 1;
+    std::vector<uint32_t> nextVertex(streams.NumVertices, EmptyBucket);
+
+    for (uint32_t v = 0; v < streams.NumVertices; ++v)
+    {
+        const float* p = Attribute(streams.Positions, streams.VertexStride, v);
+        const Float3 position(p);
+        const int32_t* cell = &cells[v * 3];
+        uint32_t weldedVertex = EmptyBucket;
+
+        int32_t minCell[3];
+        int32_t maxCell[3];
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            minCell[i] = CellCoordinate(p[i] - epsilon, cellScale);
+            maxCell[i] = CellCoordinate(p[i] + epsilon, cellScale);
+        }
+
+        int32_t neighbor[3];
+        for (neighbor[2] = minCell[2]; neighbor[2] <= maxCell[2]; ++neighbor[2])
+        {
+            for (neighbor[1] = minCell[1]; neighbor[1] <= maxCell[1]; ++neighbor[1])
+            {
+                for (neighbor[0] = minCell[0]; neighbor[0] <= maxCell[0]; ++neighbor[0])
+                {
+                    const size_t bucket = HashBytes(neighbor, sizeof(neighbor)) & mask;
+                    for (uint32_t other = buckets[bucket]; other != EmptyBucket; other = nextVertex[other])
+                    {
+                        if (other >= weldedVertex || memcmp(&cells[other * 3], neighbor, sizeof(neighbor)) != 0)
+                            continue;
+
+                        const Float3 delta = Float3(Attribute(streams.Positions, streams.VertexStride, other)) - position;
+                        if (Dot(delta, delta) <= epsilonSq)
+                            weldedVertex = other;
+                    }
+                }
+            }
+        }
+
+        if (weldedVertex == EmptyBucket)
+        {
+            const size_t bucket = HashBytes(cell, sizeof(int32_t) * 3) & mask;
+            nextVertex[v] = buckets[bucket];
+            buckets[bucket] = v;
+            weldedVertex = v;
+        }
+
+        weldedVertices[v] = weldedVertex;
+    }
+}
+
+void ComputeNormals(const VertexStreams& streams, const uint32_t* indices, size_t numIndices,
+                    float weldEpsilon, float creaseAngle, float* cornerNormals)
+{
+    const uint32_t stride = streams.VertexStride;
+    const size_t numTriangles = numIndices / 3;
+
+    std::vector<uint32_t> weldedVertices(streams.NumVertices);
+    WeldPositions(streams, weldEpsilon, &weldedVertices[0]);
+
+    // Work out each triangle's normal and the angle at each of its corners
+    std::vector<Float3> faceNormals(numTriangles);
+    std::vector<float> cornerAngles(numIndices);
+    ParallelForBlocks(numTriangles, [&](size_t triangle)
+    {
+        const uint32_t* triIndices = indices + triangle * 3;
+        Float3 p[3];
+        for (uint32_t i = 0; i < 3; ++i)
+            p[i] = Float3(Attribute(streams.Positions, stride, triIndices[i]));
+
+        faceNormals[triangle] = Normalize(Cross(p[1] - p[0], p[2] - p[0]));
+
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            const Float3 edge0 = Normalize(p[(i + 2) % 3] - p[i]);
+            const Float3 edge1 = Normalize(p[(i + 1) % 3] - p[i]);
+            cornerAngles[triangle * 3 + i] = std::acos(std::max(-1.0f, std::min(1.0f, Dot(edge0, edge1))));
+        }
+    });
+
+    std::vector<uint32_t> cornerOffsets;
+    std::vector<uint32_t> vertexCorners;
+    BucketCorners(indices, numIndices, &weldedVertices[0], streams.NumVertices, cornerOffsets, vertexCorners);
+
+    // Each corner adds up the triangles around its vertex that are within the crease angle
+    // of its own triangle. When nothing is creased, they all get the same sum.
+    const float creaseCos = std::cos(creaseAngle);
+    const bool smoothAll = creaseAngle >= 3.14159265f;
+    ParallelForBlocks(streams.NumVertices, [&](size_t v)
+    {
+        const uint32_t begin = cornerOffsets[v];
+        const uint32_t end = cornerOffsets[v + 1];
+
+        Float3 smoothNormal(0.0f, 0.0f, 0.0f);
+        if (smoothAll)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+                smoothNormal = smoothNormal + faceNormals[vertexCorners[i] / 3] * cornerAngles[vertexCorners[i]];
+            smoothNormal = Normalize(smoothNormal);
+        }
+
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const uint32_t corner = vertexCorners[i];
+            const Float3& faceNormal = faceNormals[corner / 3];
+
+            Float3 normal = smoothNormal;
+            if (!smoothAll)
+            {
+                // Degenerate triangles have no normal of their own, so they take everything
+                const bool degenerate = Dot(faceNormal, faceNormal) == 0.0f;
+                for (uint32_t j = begin; j < end; ++j)
+                {
+                    const uint32_t otherCorner = vertexCorners[j];
+                    const Float3& otherNormal = faceNormals[otherCorner / 3];
+                    if (degenerate || Dot(faceNormal, otherNormal) >= creaseCos)
+                        normal = normal + otherNormal * cornerAngles[otherCorner];
+                }
+                normal = Normalize(normal);
+            }
+
+            if (Dot(normal, normal) == 0.0f)
+                normal = Dot(faceNormal, faceNormal) > 0.0f ? faceNormal : Float3(0.0f, 0.0f, 1.0f);
+
+            float* dst = cornerNormals + size_t(corner) * 3;
+            dst[0] = normal.x;
+            dst[1] = normal.y;
+            dst[2] = normal.z;
+        }
+    });
+}
+
+uint32_t SplitVertices(const uint32_t* indices, size_t numIndices, const void* cornerData,
+                       uint32_t cornerDataSize, uint32_t* newIndices, uint32_t* sourceVertices)
+{
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(cornerData);
+
+    std::vector<uint32_t> hashes(numIndices);
+    ParallelForBlocks(numIndices, [&](size_t i)
+    {
+        hashes[i] = HashBytes(data + i * cornerDataSize, cornerDataSize, HashBytes(&indices[i], sizeof(uint32_t)));
+    });
+
+    auto equal = [&](uint32_t c0, uint32_t c1) -> bool
+    {
+        return indices[c0] == indices[c1]
+               && memcmp(data + size_t(c0) * cornerDataSize, data + size_t(c1) * cornerDataSize, cornerDataSize) == 0;
+    };
+
+    // The table holds the first corner of each new vertex, and cornerVertices maps those
+    // corners to their new vertex
+    std::vector<uint32_t> table;
+    InitHashTable(table, numIndices);
+    std::vector<uint32_t> cornerVertices(numIndices);
+    uint32_t numNewVertices = 0;
+    for (size_t i = 0; i < numIndices; ++i)
+    {
+        const uint32_t corner = uint32_t(i);
+        const uint32_t firstCorner = FindOrInsert(table, corner, hashes[i], equal);
+        if (firstCorner == corner)
+        {
+            cornerVertices[i] = numNewVertices;
+            sourceVertices[numNewVertices++] = indices[i];
+        }
+
+        newIndices[i] = cornerVertices[firstCorner];
+    }
+
+    return numNewVertices;
+}
+
+}
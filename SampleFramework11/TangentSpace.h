@@ -0,0 +1,73 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+// This header doesn't use the precompiled header, so that it can be shared by
+// the code that also builds outside of Windows
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SampleFramework11
+{
+
+// Interleaved vertex attributes, where each attribute is read from every VertexStride
+// bytes. Positions and normals are float3, and texture coordinates are float2.
+struct VertexStreams
+{
+    const float* Positions;
+    const float* Normals;
+    const float* TexCoords;
+    uint32_t VertexStride;
+    uint32_t NumVertices;
+};
+
+// Gives every vertex the index of the first vertex whose position, normal and texture
+// coordinate are exactly the same, using a hash table. Attributes that are NULL in the
+// streams are ignored.
+void WeldVertices(const VertexStreams& streams, uint32_t* weldedVertices);
+
+// Gives every vertex the index of the lowest vertex whose position is within epsilon of its
+// own, using a spatial hash with cells that are epsilon wide. Only the positions in the
+// streams are used, and an epsilon of 0 only welds identical positions.
+void WeldPositions(const VertexStreams& streams, float epsilon, uint32_t* weldedVertices);
+
+// Computes a normal for every corner of a triangle list, by adding up the normals of the
+// triangles around the corner's welded position weighted by their angle at that position.
+// Only the triangles whose normals are within creaseAngle radians of the corner's own
+// triangle are added, so that hard edges stay hard, and a crease angle of Pi or more
+// smooths everything. Triangles are processed in parallel, and the sums are always added
+// up in index order so that the results don't depend on the number of threads. Only the
+// positions in the streams are used.
+void ComputeNormals(const VertexStreams& streams, const uint32_t* indices, size_t numIndices,
+                    float weldEpsilon, float creaseAngle, float* cornerNormals);
+
+// Computes a tangent for every corner of a triangle list, following Morten Mikkelsen's
+// MikkTSpace. Each triangle's tangent is projected onto the plane of each corner's normal
+// and weighted by the corner angle. The corners around each welded vertex are split into
+// groups of triangles that are connected through their edges and have the same texture
+// space orientation, and the tangents are summed within each group. Triangles without a
+// texture space join the first group that reaches them, or else use the first group at
+// their vertex. The tangents are float4, where w is the sign of the bitangent:
+// bitangent = w * cross(normal, tangent). Triangles are processed in parallel, and the
+// sums are always added up in index order so that the results don't depend on the
+// number of threads.
+void ComputeTangents(const VertexStreams& streams, const uint32_t* indices, size_t numIndices,
+                     float* cornerTangents);
+
+// Gives every combination of a vertex and the per-corner data that's used with it its own
+// vertex, so that per-corner attributes can be written into the vertex stream. The new
+// vertices are numbered in the order that the indices first use them, newIndices receives
+// the new index for every corner, and sourceVertices receives the original vertex for
+// every new vertex (it needs room for numIndices entries). Returns the number of new vertices.
+uint32_t SplitVertices(const uint32_t* indices, size_t numIndices, const void* cornerData,
+                       uint32_t cornerDataSize, uint32_t* newIndices, uint32_t* sourceVertices);
+
+}
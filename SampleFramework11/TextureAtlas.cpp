@@ -0,0 +1,245 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "PCH.h"
+
+#include "TextureAtlas.h"
+#include "SpriteFont.h"
+#include "SpriteRenderer.h"
+#include "RectPacker.h"
+#include "Exceptions.h"
+#include "Utility.h"
+
+namespace SampleFramework11
+{
+
+TextureAtlas::TextureAtlas()
+{
+
+}
+
+TextureAtlas::~TextureAtlas()
+{
+
+}
+
+void TextureAtlas::AddImage(const std::wstring& name, LPCWSTR fileName, ID3D11Device* device)
+{
+    // Load the image without mips. The texels are copied as-is, and the sRGB view
+    // of the atlas does the conversion when they're sampled.
+    D3DX11_IMAGE_INFO srcInfo;
+    D3DX11_IMAGE_LOAD_INFO info;
+    info.Width = D3DX11_DEFAULT;
+    info.Height = D3DX11_DEFAULT;
+    info.Depth = D3DX11_DEFAULT;
+    info.FirstMipLevel = 0;
+    info.MipLevels = 1;
+    info.Usage = D3D11_USAGE_DEFAULT;
+    info.BindFlags = 0;
+    info.CpuAccessFlags = 0;
+    info.MiscFlags = 0;
+    info.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    info.Filter = D3DX11_DEFAULT;
+    info.MipFilter = D3DX11_DEFAULT;
+    info.pSrcInfo = &srcInfo;
+
+    ID3D11ResourcePtr resource;
+    DXCall(D3DX11CreateTextureFromFileW(device, fileName, &info, NULL, &resource, NULL));
+
+    AddImage(name, resource, srcInfo.Width, srcInfo.Height, NULL);
+}
+
+void TextureAtlas::AddTexture(const std::wstring& name, ID3D11ShaderResourceView* texture)
+{
+    D3D11_TEXTURE2D_DESC desc = SpriteRenderer::GetTextureDesc(texture);
+    if (desc.Format != DXGI_FORMAT_B8G8R8A8_UNORM && desc.Format != DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+        && desc.Format != DXGI_FORMAT_B8G8R8A8_TYPELESS)
+        throw Exception(L"Texture " + name + L" can't be copied into the texture atlas, it must use a B8G8R8A8 format");
+
+    ID3D11ResourcePtr resource;
+    texture->GetResource(&resource);
+    AddImage(name, resource, desc.Width, desc.Height, NULL);
+}
+
+void TextureAtlas::AddFont(const SpriteFont& font)
+{
+    // Shared fonts can be added more than once, but they only need one copy
+    for (size_t i = 0; i < images.size(); ++i)
+        if (images[i].Font == &font)
+            return;
+
+    D3D11_TEXTURE2D_DESC desc;
+    font.Texture()->GetDesc(&desc);
+    AddImage(L"Font" + ToString(images.size()), font.Texture(), desc.Width, desc.Height, &font);
+}
+
+void TextureAtlas::AddFont(const std::shared_ptr<SpriteFont>& font)
+{
+    sharedFonts.push_back(font);
+    AddFont(*font);
+}
+
+void TextureAtlas::AddImage(const std::wstring& name, ID3D11Resource* resource, UINT width, UINT height, const SpriteFont* font)
+{
+    _ASSERT(!texture);
+    _ASSERT(width > 0 && height > 0);
+
+    Image image;
+    image.Name = name;
+    image.Resource = resource;
+    image.Font = font;
+    image.Width = width;
+    image.Height = height;
+    image.X = 0;
+    image.Y = 0;
+    images.push_back(image);
+}
+
+void TextureAtlas::Build(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    _ASSERT(!texture);
+    _ASSERT(!images.empty());
+
+    // Pack the images into the smallest power-of-2 texture that fits them
+    std::vector<RectPacker::Rect> packedRects(images.size());
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        packedRects[i].Width = images[i].Width + Padding * 2;
+        packedRects[i].Height = images[i].Height + Padding * 2;
+    }
+
+    UINT32 width = 0;
+    UINT32 height = 0;
+    if (!RectPacker::PackPow2(packedRects, 1, D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION, width, height))
+        throw Exception(L"The images don't fit in a single texture atlas");
+
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        images[i].X = packedRects[i].X + Padding;
+        images[i].Y = packedRects[i].Y + Padding;
+    }
+
+    // Create the atlas texture, cleared to transparent black
+    std::vector<UINT> clearData(width * height, 0);
+    D3D11_SUBRESOURCE_DATA initData;
+    initData.pSysMem = &clearData[0];
+    initData.SysMemPitch = width * 4;
+    initData.SysMemSlicePitch = 0;
+
+    D3D11_TEXTURE2D_DESC texDesc;
+    texDesc.Width = width;
+    texDesc.Height = height;
+    texDesc.MipLevels = 1;
+    texDesc.ArraySize = 1;
+    texDesc.Format = DXGI_FORMAT_B8G8R8A8_TYPELESS;
+    texDesc.SampleDesc.Count = 1;
+    texDesc.SampleDesc.Quality = 0;
+    texDesc.Usage = D3D11_USAGE_DEFAULT;
+    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    texDesc.CPUAccessFlags = 0;
+    texDesc.MiscFlags = 0;
+    DXCall(device->CreateTexture2D(&texDesc, &initData, &texture));
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
+    srDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+    srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srDesc.Texture2D.MipLevels = 1;
+    srDesc.Texture2D.MostDetailedMip = 0;
+    DXCall(device->CreateShaderResourceView(texture, &srDesc, &srView));
+
+    srDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    DXCall(device->CreateShaderResourceView(texture, &srDesc, &linearSRView));
+
+    // Copy in the images, and make the remapped copies of the fonts
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        const Image& image = images[i];
+        CopyImage(context, image);
+
+        XMFLOAT4 rect(static_cast<float>(image.X), static_cast<float>(image.Y),
+                      static_cast<float>(image.Width), static_cast<float>(image.Height));
+        rects[image.Name] = rect;
+
+        if (image.Font != NULL)
+        {
+            std::shared_ptr<SpriteFont> font(new SpriteFont());
+            font->InitializeFromAtlas(*image.Font, texture, srView, rect.x, rect.y);
+            fonts[image.Font] = font;
+        }
+    }
+
+    // The source images aren't needed anymore
+    images.clear();
+}
+
+// Copies an image into its spot in the atlas, and extrudes its edges into the padding
+void TextureAtlas::CopyImage(ID3D11DeviceContext* context, const Image& image)
+{
+    ID3D11Resource* dst = texture;
+    ID3D11Resource* src = image.Resource;
+    const UINT w = image.Width;
+    const UINT h = image.Height;
+    const UINT x = image.X;
+    const UINT y = image.Y;
+
+    D3D11_BOX box;
+    box.front = 0;
+    box.back = 1;
+    auto copyRegion = [&](UINT srcX, UINT srcY, UINT regionWidth, UINT regionHeight, UINT dstX, UINT dstY)
+    {
+        box.left = srcX;
+        box.top = srcY;
+        box.right = srcX + regionWidth;
+        box.bottom = srcY + regionHeight;
+        context->CopySubresourceRegion(dst, 0, dstX, dstY, 0, src, 0, &box);
+    };
+
+    copyRegion(0, 0, w, h, x, y);
+
+    for (UINT p = 1; p <= Padding; ++p)
+    {
+        // Edges
+        copyRegion(0, 0, w, 1, x, y - p);
+        copyRegion(0, h - 1, w, 1, x, y + h - 1 + p);
+        copyRegion(0, 0, 1, h, x - p, y);
+        copyRegion(w - 1, 0, 1, h, x + w - 1 + p, y);
+
+        // Corners
+        for (UINT q = 1; q <= Padding; ++q)
+        {
+            copyRegion(0, 0, 1, 1, x - p, y - q);
+            copyRegion(w - 1, 0, 1, 1, x + w - 1 + p, y - q);
+            copyRegion(0, h - 1, 1, 1, x - p, y + h - 1 + q);
+            copyRegion(w - 1, h - 1, 1, 1, x + w - 1 + p, y + h - 1 + q);
+        }
+    }
+}
+
+bool TextureAtlas::HasImage(const std::wstring& name) const
+{
+    return rects.find(name) != rects.end();
+}
+
+const XMFLOAT4& TextureAtlas::GetRect(const std::wstring& name) const
+{
+    std::map<std::wstring, XMFLOAT4>::const_iterator it = rects.find(name);
+    if (it == rects.end())
+        throw Exception(L"Texture atlas doesn't contain an image named " + name);
+    return it->second;
+}
+
+const SpriteFont& TextureAtlas::GetFont(const SpriteFont& font) const
+{
+    std::map<const SpriteFont*, std::shared_ptr<SpriteFont>>::const_iterator it = fonts.find(&font);
+    if (it == fonts.end())
+        throw Exception(L"Texture atlas doesn't contain a copy of the font");
+    return *it->second;
+}
+
+}
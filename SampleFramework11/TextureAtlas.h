@@ -0,0 +1,86 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include "InterfacePointers.h"
+
+namespace SampleFramework11
+{
+
+class SpriteFont;
+
+// Packs small UI images and font glyph pages into a single texture at load time, so
+// that sprites using any of them can be drawn together in one batch. Images are
+// added by name, and their source rect in the atlas is looked up with GetRect.
+// Images are color art, so SRView reads the atlas as sRGB. Fonts read it through the same
+// view so that text is batched with the images. That's safe because glyph texels are
+// white with the coverage or distance in alpha, which the sRGB conversion doesn't touch.
+// LinearSRView reads the atlas without the conversion, for anything that needs raw values.
+class TextureAtlas
+{
+
+public:
+
+    // Each image is surrounded by a border of copies of its edge texels, so that
+    // linear filtering never picks up texels from a neighbouring image
+    static const UINT Padding = 2;
+
+    TextureAtlas();
+    ~TextureAtlas();
+
+    void AddImage(const std::wstring& name, LPCWSTR fileName, ID3D11Device* device);
+    void AddTexture(const std::wstring& name, ID3D11ShaderResourceView* texture);
+
+    // Adds the font's glyph page. Once the atlas is built, GetFont returns the atlas's own
+    // copy of the font, which has its character descriptors remapped to point into the atlas.
+    void AddFont(const SpriteFont& font);
+
+    // Same as above, but the atlas holds on to the font, so that FontRegistry keeps handing
+    // out the same one and GetFont can be used with it for as long as the atlas is alive
+    void AddFont(const std::shared_ptr<SpriteFont>& font);
+
+    void Build(ID3D11Device* device, ID3D11DeviceContext* context);
+
+    // Accessors
+    ID3D11ShaderResourceView* SRView() const { return srView; };
+    ID3D11ShaderResourceView* LinearSRView() const { return linearSRView; };
+    ID3D11Texture2D* Texture() const { return texture; };
+    bool HasImage(const std::wstring& name) const;
+    const XMFLOAT4& GetRect(const std::wstring& name) const;
+    const SpriteFont& GetFont(const SpriteFont& font) const;
+
+protected:
+
+    struct Image
+    {
+        std::wstring Name;
+        ID3D11ResourcePtr Resource;
+        const SpriteFont* Font;
+        UINT Width;
+        UINT Height;
+        UINT X;
+        UINT Y;
+    };
+
+    void AddImage(const std::wstring& name, ID3D11Resource* resource, UINT width, UINT height, const SpriteFont* font);
+    void CopyImage(ID3D11DeviceContext* context, const Image& image);
+
+    std::vector<Image> images;
+    std::map<std::wstring, XMFLOAT4> rects;
+    std::map<const SpriteFont*, std::shared_ptr<SpriteFont>> fonts;
+    std::vector<std::shared_ptr<SpriteFont>> sharedFonts;
+    ID3D11Texture2DPtr texture;
+    ID3D11ShaderResourceViewPtr srView;
+    ID3D11ShaderResourceViewPtr linearSRView;
+};
+
+}
@@ -0,0 +1,842 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "TrueTypeFont.h"
+#include "RectPacker.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace SampleFramework11
+{
+
+// Composite glyphs can nest, but real fonts never go more than a few levels deep
+static const uint32_t MaxCompositeDepth = 8;
+
+// Everything in a TrueType file is big-endian
+static uint16_t ReadU16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static int16_t ReadS16(const uint8_t* p)
+{
+    return static_cast<int16_t>(ReadU16(p));
+}
+
+static uint32_t ReadU32(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+           | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+// Accumulates the signed area that each edge covers in every pixel. Walking a row
+// left to right and summing up the accumulation buffer gives the coverage of each
+// pixel, without having to sort or clip the edges.
+class CoverageRasterizer
+{
+
+public:
+
+    CoverageRasterizer(uint32_t width, uint32_t height)
+        :   width(width),
+            height(height),
+            accumulation(width * height + 2, 0.0f)
+    {
+    }
+
+    void DrawLine(float x0, float y0, float x1, float y1)
+    {
+        if (y0 == y1)
+            return;
+
+        // Always walk downwards, and flip the sign for edges that go up
+        float dir = 1.0f;
+        if (y0 > y1)
+        {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+            dir = -1.0f;
+        }
+
+        const float dxdy = (x1 - x0) / (y1 - y0);
+        float x = x0;
+        if (y0 < 0.0f)
+        {
+            x -= y0 * dxdy;
+            y0 = 0.0f;
+        }
+
+        const uint32_t rowEnd = std::min(height, static_cast<uint32_t>(std::ceil(y1)));
+        for (uint32_t y = static_cast<uint32_t>(y0); y < rowEnd; ++y)
+        {
+            float* row = &accumulation[y * width];
+            const float dy = std::min(static_cast<float>(y + 1), y1) - std::max(static_cast<float>(y), y0);
+            const float xNext = x + dxdy * dy;
+            const float d = dy * dir;
+
+            const float left = std::min(x, xNext);
+            const float right = std::max(x, xNext);
+            const float leftFloor = std::floor(left);
+            const int32_t leftIdx = static_cast<int32_t>(leftFloor);
+            const float rightCeil = std::ceil(right);
+            const int32_t rightIdx = static_cast<int32_t>(rightCeil);
+
+            if (rightIdx <= leftIdx + 1)
+            {
+                // The edge stays within one pixel, so split it by its average x
+                const float mid = 0.5f * (x + xNext) - leftFloor;
+                row[leftIdx] += d - d * mid;
+                row[leftIdx + 1] += d * mid;
+            }
+            else
+            {
+                // The edge crosses several pixels. The first and last get a triangle,
+                // and every pixel in between gets a constant slice.
+                const float invWidth = 1.0f / (right - left);
+                const float leftFrac = left - leftFloor;
+                const float firstArea = 0.5f * invWidth * (1.0f - leftFrac) * (1.0f - leftFrac);
+                const float rightFrac = right - rightCeil + 1.0f;
+                const float lastArea = 0.5f * invWidth * rightFrac * rightFrac;
+
+                row[leftIdx] += d * firstArea;
+                if (rightIdx == leftIdx + 2)
+                {
+                    row[leftIdx + 1] += d * (1.0f - firstArea - lastArea);
+                }
+                else
+                {
+                    const float secondArea = invWidth * (1.5f - leftFrac);
+                    row[leftIdx + 1] += d * (secondArea - firstArea);
+                    for (int32_t i = leftIdx + 2; i < rightIdx - 1; ++i)
+                        row[i] += d * invWidth;
+                    const float innerArea = secondArea + (rightIdx - leftIdx - 3) * invWidth;
+                    row[rightIdx - 1] += d * (1.0f - innerArea - lastArea);
+                }
+                row[rightIdx] += d * lastArea;
+            }
+
+            x = xNext;
+        }
+    }
+
+    // Splits a quadratic curve into enough lines that the error is well under a pixel
+    void DrawQuad(float x0, float y0, float x1, float y1, float x2, float y2)
+    {
+        const float devX = x0 - 2.0f * x1 + x2;
+        const float devY = y0 - 2.0f * y1 + y2;
+        const float devSq = devX * devX + devY * devY;
+        if (devSq < 0.333f)
+        {
+            DrawLine(x0, y0, x2, y2);
+            return;
+        }
+
+        const uint32_t numLines = 1 + static_cast<uint32_t>(std::sqrt(std::sqrt(3.0f * devSq)));
+        float prevX = x0;
+        float prevY = y0;
+        for (uint32_t i = 1; i <= numLines; ++i)
+        {
+            const float t = static_cast<float>(i) / numLines;
+            const float it = 1.0f - t;
+            const float x = it * it * x0 + 2.0f * it * t * x1 + t * t * x2;
+            const float y = it * it * y0 + 2.0f * it * t * y1 + t * t * y2;
+            DrawLine(prevX, prevY, x, y);
+            prevX = x;
+            prevY = y;
+        }
+    }
+
+    // Sums up the accumulated areas. The sum returns to 0 at the end of every row, so
+    // one running total works for the whole buffer.
+    void Resolve(std::vector<uint8_t>& coverage) const
+    {
+        coverage.resize(width * height);
+        float sum = 0.0f;
+        for (uint32_t i = 0; i < width * height; ++i)
+        {
+            sum += accumulation[i];
+            const float value = std::min(std::fabs(sum), 1.0f);
+            coverage[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+        }
+    }
+
+protected:
+
+    uint32_t width;
+    uint32_t height;
+    std::vector<float> accumulation;
+};
+
+TrueTypeFont::TrueTypeFont()
+    :   fontOffset(0),
+        numGlyphs(0),
+        unitsPerEm(0),
+        numHMetrics(0),
+        longLocaOffsets(false),
+        ascent(0),
+        lineSpacing(0),
+        glyfOffset(0),
+        locaOffset(0),
+        hmtxOffset(0),
+        cmapOffset(0),
+        cmapFormat(0)
+{
+}
+
+bool TrueTypeFont::LoadFromFile(const char* fileName)
+{
+    FILE* file = NULL;
+#if defined(_MSC_VER)
+    if (fopen_s(&file, fileName, "rb") != 0)
+        file = NULL;
+#else
+    file = fopen(fileName, "rb");
+#endif
+    if (file == NULL)
+        return false;
+
+    std::vector<uint8_t> fileData;
+    uint8_t buffer[65536];
+    size_t bytesRead = 0;
+    while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        fileData.insert(fileData.end(), buffer, buffer + bytesRead);
+    fclose(file);
+
+    if (fileData.empty())
+        return false;
+
+    return Load(&fileData[0], fileData.size());
+}
+
+bool TrueTypeFont::Load(const uint8_t* fileData, size_t fileSize)
+{
+    data.assign(fileData, fileData + fileSize);
+    if (data.size() < 12)
+        return false;
+
+    // Collections start with their own header, so just use the first font in them
+    fontOffset = 0;
+    if (memcmp(&data[0], "ttcf", 4) == 0)
+    {
+        if (data.size() < 16)
+            return false;
+        fontOffset = ReadU32(&data[12]);
+        if (fontOffset + 12 > data.size())
+            return false;
+    }
+
+    uint32_t headOffset, headLength, maxpOffset, maxpLength, hheaOffset, hheaLength;
+    uint32_t length = 0;
+    if (!FindTable("head", headOffset, headLength) || headLength < 54
+        || !FindTable("maxp", maxpOffset, maxpLength) || maxpLength < 6
+        || !FindTable("hhea", hheaOffset, hheaLength) || hheaLength < 36
+        || !FindTable("hmtx", hmtxOffset, length)
+        || !FindTable("loca", locaOffset, length)
+        || !FindTable("glyf", glyfOffset, length))
+        return false;
+
+    unitsPerEm = ReadU16(&data[headOffset + 18]);
+    longLocaOffsets = ReadS16(&data[headOffset + 50]) != 0;
+    numGlyphs = ReadU16(&data[maxpOffset + 4]);
+    numHMetrics = ReadU16(&data[hheaOffset + 34]);
+    if (unitsPerEm == 0 || numGlyphs == 0 || numHMetrics == 0)
+        return false;
+
+    // Match the cell ascent and line spacing that GDI+ uses, which come from the
+    // Windows metrics in the OS/2 table when it's there
+    const int32_t hheaAscent = ReadS16(&data[hheaOffset + 4]);
+    const int32_t hheaDescent = ReadS16(&data[hheaOffset + 6]);
+    const int32_t hheaLineGap = ReadS16(&data[hheaOffset + 8]);
+    ascent = hheaAscent;
+    lineSpacing = hheaAscent - hheaDescent + hheaLineGap;
+
+    uint32_t os2Offset, os2Length;
+    if (FindTable("OS/2", os2Offset, os2Length) && os2Length >= 78)
+    {
+        const int32_t winAscent = ReadU16(&data[os2Offset + 74]);
+        const int32_t winDescent = ReadU16(&data[os2Offset + 76]);
+        ascent = winAscent;
+        lineSpacing = std::max(lineSpacing, winAscent + winDescent);
+    }
+
+    return FindCharacterMap();
+}
+
+bool TrueTypeFont::FindTable(const char* tag, uint32_t& offset, uint32_t& length) const
+{
+    const uint32_t numTables = ReadU16(&data[fontOffset + 4]);
+    for (uint32_t i = 0; i < numTables; ++i)
+    {
+        const uint32_t record = fontOffset + 12 + i * 16;
+        if (record + 16 > data.size())
+            return false;
+
+        if (memcmp(&data[record], tag, 4) == 0)
+        {
+            offset = ReadU32(&data[record + 8]);
+            length = ReadU32(&data[record + 12]);
+            return offset <= data.size() && length <= data.size() - offset;
+        }
+    }
+
+    return false;
+}
+
+// Picks the Unicode subtable, preferring the full-range format 12 over format 4
+bool TrueTypeFont::FindCharacterMap()
+{
+    uint32_t tableOffset, tableLength;
+    if (!FindTable("cmap", tableOffset, tableLength) || tableLength < 4)
+        return false;
+
+    cmapOffset = 0;
+    cmapFormat = 0;
+    const uint32_t numSubtables = ReadU16(&data[tableOffset + 2]);
+    for (uint32_t i = 0; i < numSubtables; ++i)
+    {
+        const uint32_t record = tableOffset + 4 + i * 8;
+        if (record + 8 > tableOffset + tableLength)
+            return false;
+
+        const uint32_t platform = ReadU16(&data[record]);
+        const uint32_t encoding = ReadU16(&data[record + 2]);
+        const uint32_t subtable = tableOffset + ReadU32(&data[record + 4]);
+        if (subtable + 16 > data.size())
+            continue;
+
+        const bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+        const uint32_t format = ReadU16(&data[subtable]);
+        if (unicode && format == 12)
+        {
+            cmapOffset = subtable;
+            cmapFormat = format;
+            return true;
+        }
+        else if (unicode && format == 4 && cmapFormat == 0)
+        {
+            cmapOffset = subtable;
+            cmapFormat = format;
+        }
+    }
+
+    return cmapFormat != 0;
+}
+
+uint32_t TrueTypeFont::GlyphIndex(uint32_t character) const
+{
+    if (cmapFormat == 4)
+    {
+        if (character > 0xFFFF)
+            return 0;
+
+        // Segments are sorted by their end code, so binary search for the first one that
+        // ends at or after the character
+        const uint32_t segCount = ReadU16(&data[cmapOffset + 6]) / 2;
+        const uint32_t endCodes = cmapOffset + 14;
+        const uint32_t startCodes = endCodes + segCount * 2 + 2;
+        const uint32_t idDeltas = startCodes + segCount * 2;
+        const uint32_t idRangeOffsets = idDeltas + segCount * 2;
+        if (idRangeOffsets + segCount * 2 > data.size())
+            return 0;
+
+        uint32_t lo = 0;
+        uint32_t hi = segCount;
+        while (lo < hi)
+        {
+            const uint32_t mid = (lo + hi) / 2;
+            if (ReadU16(&data[endCodes + mid * 2]) < character)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo == segCount)
+            return 0;
+
+        const uint32_t startCode = ReadU16(&data[startCodes + lo * 2]);
+        if (character < startCode)
+            return 0;
+
+        const uint32_t idDelta = ReadU16(&data[idDeltas + lo * 2]);
+        const uint32_t idRangeOffset = ReadU16(&data[idRangeOffsets + lo * 2]);
+        if (idRangeOffset == 0)
+            return (character + idDelta) & 0xFFFF;
+
+        const uint32_t glyphAddress = idRangeOffsets + lo * 2 + idRangeOffset + (character - startCode) * 2;
+        if (glyphAddress + 2 > data.size())
+            return 0;
+        const uint32_t glyph = ReadU16(&data[glyphAddress]);
+        return glyph != 0 ? (glyph + idDelta) & 0xFFFF : 0;
+    }
+    else if (cmapFormat == 12)
+    {
+        const uint32_t numGroups = ReadU32(&data[cmapOffset + 12]);
+        const uint32_t groups = cmapOffset + 16;
+        if (groups + static_cast<uint64_t>(numGroups) * 12 > data.size())
+            return 0;
+
+        uint32_t lo = 0;
+        uint32_t hi = numGroups;
+        while (lo < hi)
+        {
+            const uint32_t mid = (lo + hi) / 2;
+            const uint8_t* group = &data[groups + mid * 12];
+            if (character < ReadU32(group))
+                hi = mid;
+            else if (character > ReadU32(group + 4))
+                lo = mid + 1;
+            else
+                return ReadU32(group + 8) + (character - ReadU32(group));
+        }
+    }
+
+    return 0;
+}
+
+float TrueTypeFont::LineHeight(float fontSize) const
+{
+    return lineSpacing * fontSize / unitsPerEm;
+}
+
+float TrueTypeFont::AdvanceWidth(uint32_t glyphIndex, float fontSize) const
+{
+    // Glyphs past the end of the long metrics share the last advance
+    const uint32_t metric = std::min(glyphIndex, numHMetrics - 1);
+    const uint32_t address = hmtxOffset + metric * 4;
+    if (address + 2 > data.size())
+        return 0.0f;
+    return ReadU16(&data[address]) * fontSize / unitsPerEm;
+}
+
+// Decodes a glyph's outline into contours in font units. Composite glyphs are flattened
+// into the contours of their components, with the component transforms applied.
+bool TrueTypeFont::GetGlyphContours(uint32_t glyphIndex, std::vector<Contour>& contours, uint32_t depth) const
+{
+    if (glyphIndex >= numGlyphs || depth > MaxCompositeDepth)
+        return false;
+
+    uint32_t start, end;
+    if (longLocaOffsets)
+    {
+        if (locaOffset + (glyphIndex + 2) * 4 > data.size())
+            return false;
+        start = ReadU32(&data[locaOffset + glyphIndex * 4]);
+        end = ReadU32(&data[locaOffset + glyphIndex * 4 + 4]);
+    }
+    else
+    {
+        if (locaOffset + (glyphIndex + 2) * 2 > data.size())
+            return false;
+        start = ReadU16(&data[locaOffset + glyphIndex * 2]) * 2;
+        end = ReadU16(&data[locaOffset + glyphIndex * 2 + 2]) * 2;
+    }
+
+    // Glyphs without an outline, like the space, have no data at all
+    if (end <= start)
+        return true;
+
+    const uint32_t glyph = glyfOffset + start;
+    const uint32_t glyphEnd = glyfOffset + end;
+    if (glyphEnd > data.size() || glyph + 10 > glyphEnd)
+        return false;
+
+    const int32_t numContours = ReadS16(&data[glyph]);
+    if (numContours >= 0)
+    {
+        // Simple glyph: end point indices, instructions, then packed flags and coordinates
+        uint32_t p = glyph + 10;
+        if (p + numContours * 2 + 2 > glyphEnd)
+            return false;
+
+        std::vector<uint32_t> endPoints(numContours);
+        for (int32_t i = 0; i < numContours; ++i)
+            endPoints[i] = ReadU16(&data[p + i * 2]);
+        p += numContours * 2;
+
+        const uint32_t numPoints = numContours > 0 ? endPoints[numContours - 1] + 1 : 0;
+        p += 2 + ReadU16(&data[p]);
+
+        enum { OnCurve = 1, XShort = 2, YShort = 4, Repeat = 8, XSame = 16, YSame = 32 };
+
+        std::vector<uint8_t> flags(numPoints);
+        for (uint32_t i = 0; i < numPoints; )
+        {
+            if (p >= glyphEnd)
+                return false;
+            const uint8_t flag = data[p++];
+            flags[i++] = flag;
+            if (flag & Repeat)
+            {
+                if (p >= glyphEnd)
+                    return false;
+                for (uint32_t count = data[p++]; count > 0 && i < numPoints; --count)
+                    flags[i++] = flag;
+            }
+        }
+
+        std::vector<Point> points(numPoints);
+        int32_t x = 0;
+        for (uint32_t i = 0; i < numPoints; ++i)
+        {
+            if (flags[i] & XShort)
+            {
+                if (p + 1 > glyphEnd)
+                    return false;
+                x += (flags[i] & XSame) ? data[p] : -static_cast<int32_t>(data[p]);
+                p += 1;
+            }
+            else if (!(flags[i] & XSame))
+            {
+                if (p + 2 > glyphEnd)
+                    return false;
+                x += ReadS16(&data[p]);
+                p += 2;
+            }
+            points[i].X = static_cast<float>(x);
+            points[i].OnCurve = (flags[i] & OnCurve) != 0;
+        }
+
+        int32_t y = 0;
+        for (uint32_t i = 0; i < numPoints; ++i)
+        {
+            if (flags[i] & YShort)
+            {
+                if (p + 1 > glyphEnd)
+                    return false;
+                y += (flags[i] & YSame) ? data[p] : -static_cast<int32_t>(data[p]);
+                p += 1;
+            }
+            else if (!(flags[i] & YSame))
+            {
+                if (p + 2 > glyphEnd)
+                    return false;
+                y += ReadS16(&data[p]);
+                p += 2;
+            }
+            points[i].Y = static_cast<float>(y);
+        }
+
+        uint32_t first = 0;
+        for (int32_t i = 0; i < numContours; ++i)
+        {
+            if (endPoints[i] < first || endPoints[i] >= numPoints)
+                return false;
+
+            Contour contour;
+            contour.Points.assign(points.begin() + first, points.begin() + endPoints[i] + 1);
+            contours.push_back(contour);
+            first = endPoints[i] + 1;
+        }
+
+        return true;
+    }
+
+    // Composite glyph: a list of other glyphs, each with an offset and optional scale
+    enum
+    {
+        ArgsAreWords = 0x1,
+        ArgsAreXYValues = 0x2,
+        HaveScale = 0x8,
+        MoreComponents = 0x20,
+        HaveXYScale = 0x40,
+        HaveTwoByTwo = 0x80
+    };
+
+    uint32_t p = glyph + 10;
+    uint32_t flags = MoreComponents;
+    while (flags & MoreComponents)
+    {
+        if (p + 4 > glyphEnd)
+            return false;
+        flags = ReadU16(&data[p]);
+        const uint32_t component = ReadU16(&data[p + 2]);
+        p += 4;
+
+        float dx = 0.0f;
+        float dy = 0.0f;
+        if (flags & ArgsAreWords)
+        {
+            if (p + 4 > glyphEnd)
+                return false;
+            dx = ReadS16(&data[p]);
+            dy = ReadS16(&data[p + 2]);
+            p += 4;
+        }
+        else
+        {
+            if (p + 2 > glyphEnd)
+                return false;
+            dx = static_cast<int8_t>(data[p]);
+            dy = static_cast<int8_t>(data[p + 1]);
+            p += 2;
+        }
+
+        // Components positioned by matching up points aren't supported, so they're
+        // drawn without an offset
+        if (!(flags & ArgsAreXYValues))
+        {
+            dx = 0.0f;
+            dy = 0.0f;
+        }
+
+        // The scales are 2.14 fixed point
+        float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f;
+        const float fixedScale = 1.0f / 16384.0f;
+        if (flags & HaveScale)
+        {
+            if (p + 2 > glyphEnd)
+                return false;
+            a = d = ReadS16(&data[p]) * fixedScale;
+            p += 2;
+        }
+        else if (flags & HaveXYScale)
+        {
+            if (p + 4 > glyphEnd)
+                return false;
+            a = ReadS16(&data[p]) * fixedScale;
+            d = ReadS16(&data[p + 2]) * fixedScale;
+            p += 4;
+        }
+        else if (flags & HaveTwoByTwo)
+        {
+            if (p + 8 > glyphEnd)
+                return false;
+            a = ReadS16(&data[p]) * fixedScale;
+            b = ReadS16(&data[p + 2]) * fixedScale;
+            c = ReadS16(&data[p + 4]) * fixedScale;
+            d = ReadS16(&data[p + 6]) * fixedScale;
+            p += 8;
+        }
+
+        const size_t firstContour = contours.size();
+        if (!GetGlyphContours(component, contours, depth + 1))
+            return false;
+
+        for (size_t i = firstContour; i < contours.size(); ++i)
+        {
+            std::vector<Point>& points = contours[i].Points;
+            for (size_t j = 0; j < points.size(); ++j)
+            {
+                const float x = points[j].X;
+                const float y = points[j].Y;
+                points[j].X = a * x + c * y + dx;
+                points[j].Y = b * x + d * y + dy;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool TrueTypeFont::RasterizeGlyph(uint32_t glyphIndex, float fontSize, GlyphBitmap& bitmap) const
+{
+    bitmap.Width = 0;
+    bitmap.Height = 0;
+    bitmap.Top = 0.0f;
+    bitmap.Advance = AdvanceWidth(glyphIndex, fontSize);
+    bitmap.Coverage.clear();
+
+    std::vector<Contour> contours;
+    if (!GetGlyphContours(glyphIndex, contours, 0))
+        return false;
+
+    // Flip to y-down with the baseline at the cell ascent, the same place GDI+ puts it
+    // when drawing at the top of a bitmap
+    const float scale = fontSize / unitsPerEm;
+    const float baseline = ascent * scale;
+    float minX = 0.0f, maxX = 0.0f, minY = 0.0f, maxY = 0.0f;
+    bool first = true;
+    for (size_t i = 0; i < contours.size(); ++i)
+    {
+        std::vector<Point>& points = contours[i].Points;
+        for (size_t j = 0; j < points.size(); ++j)
+        {
+            points[j].X = points[j].X * scale;
+            points[j].Y = baseline - points[j].Y * scale;
+            minX = first ? points[j].X : std::min(minX, points[j].X);
+            maxX = first ? points[j].X : std::max(maxX, points[j].X);
+            minY = first ? points[j].Y : std::min(minY, points[j].Y);
+            maxY = first ? points[j].Y : std::max(maxY, points[j].Y);
+            first = false;
+        }
+    }
+
+    if (first)
+        return true;
+
+    // Curves stay inside the hull of their control points, so these bounds cover everything
+    const float originX = std::floor(minX);
+    const float originY = std::floor(minY);
+    const uint32_t width = static_cast<uint32_t>(std::ceil(maxX) - originX) + 1;
+    const uint32_t height = static_cast<uint32_t>(std::ceil(maxY) - originY) + 1;
+
+    CoverageRasterizer rasterizer(width, height);
+    for (size_t i = 0; i < contours.size(); ++i)
+    {
+        const std::vector<Point>& points = contours[i].Points;
+        const size_t numPoints = points.size();
+        if (numPoints < 2)
+            continue;
+
+        // Start from an on-curve point. If there aren't any, start between the first
+        // two off-curve points, where there's an implied on-curve point.
+        size_t startIdx = 0;
+        while (startIdx < numPoints && !points[startIdx].OnCurve)
+            ++startIdx;
+
+        float startX, startY;
+        if (startIdx == numPoints)
+        {
+            startIdx = 0;
+            startX = 0.5f * (points[0].X + points[1].X) - originX;
+            startY = 0.5f * (points[0].Y + points[1].Y) - originY;
+        }
+        else
+        {
+            startX = points[startIdx].X - originX;
+            startY = points[startIdx].Y - originY;
+        }
+
+        float penX = startX;
+        float penY = startY;
+        bool haveControl = false;
+        float controlX = 0.0f;
+        float controlY = 0.0f;
+        for (size_t j = 1; j <= numPoints; ++j)
+        {
+            const Point& point = points[(startIdx + j) % numPoints];
+            const float x = point.X - originX;
+            const float y = point.Y - originY;
+
+            if (point.OnCurve)
+            {
+                if (haveControl)
+                    rasterizer.DrawQuad(penX, penY, controlX, controlY, x, y);
+                else
+                    rasterizer.DrawLine(penX, penY, x, y);
+
+                penX = x;
+                penY = y;
+                haveControl = false;
+            }
+            else
+            {
+                // Two off-curve points in a row have an on-curve point between them
+                if (haveControl)
+                {
+                    const float midX = 0.5f * (controlX + x);
+                    const float midY = 0.5f * (controlY + y);
+                    rasterizer.DrawQuad(penX, penY, controlX, controlY, midX, midY);
+                    penX = midX;
+                    penY = midY;
+                }
+                controlX = x;
+                controlY = y;
+                haveControl = true;
+            }
+        }
+
+        // Contours that started on an implied point still need to be closed
+        if (haveControl)
+            rasterizer.DrawQuad(penX, penY, controlX, controlY, startX, startY);
+        else if (penX != startX || penY != startY)
+            rasterizer.DrawLine(penX, penY, startX, startY);
+    }
+
+    std::vector<uint8_t> coverage;
+    rasterizer.Resolve(coverage);
+
+    // Trim to the visible pixels, the same way SpriteFont::ExtractGlyph does
+    uint32_t inkMinX = width, inkMaxX = 0, inkMinY = height, inkMaxY = 0;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            if (coverage[y * width + x] == 0)
+                continue;
+            inkMinX = std::min(inkMinX, x);
+            inkMaxX = std::max(inkMaxX, x);
+            inkMinY = std::min(inkMinY, y);
+            inkMaxY = std::max(inkMaxY, y);
+        }
+    }
+
+    if (inkMinX > inkMaxX)
+        return true;
+
+    bitmap.Width = inkMaxX - inkMinX + 1;
+    bitmap.Height = inkMaxY - inkMinY + 1;
+    bitmap.Top = originY + inkMinY;
+    bitmap.Coverage.resize(bitmap.Width * bitmap.Height);
+    for (uint32_t y = 0; y < bitmap.Height; ++y)
+        memcpy(&bitmap.Coverage[y * bitmap.Width], &coverage[(y + inkMinY) * width + inkMinX], bitmap.Width);
+
+    return true;
+}
+
+bool TrueTypeFont::BakeGlyphPage(float fontSize, uint32_t firstChar, uint32_t numChars, uint32_t padding,
+                                 uint32_t maxTexSize, GlyphPage& page) const
+{
+    std::vector<GlyphBitmap> bitmaps(numChars);
+    std::vector<uint8_t> succeeded(numChars, 0);
+    ParallelFor(0, numChars, [&](size_t i)
+    {
+        const uint32_t glyphIndex = GlyphIndex(firstChar + static_cast<uint32_t>(i));
+        succeeded[i] = RasterizeGlyph(glyphIndex, fontSize, bitmaps[i]) ? 1 : 0;
+    });
+
+    if (std::find(succeeded.begin(), succeeded.end(), 0) != succeeded.end())
+        return false;
+
+    // Same metrics as the GDI+ path: glyphs are drawn at the pen position, and the pen
+    // moves one texel past the visible part of the glyph
+    page.Glyphs.resize(numChars);
+    std::vector<RectPacker::Rect> rects(numChars);
+    for (uint32_t i = 0; i < numChars; ++i)
+    {
+        GlyphDesc& desc = page.Glyphs[i];
+        desc.Width = static_cast<float>(bitmaps[i].Width);
+        desc.Height = static_cast<float>(bitmaps[i].Height);
+        desc.OffsetX = 0.0f;
+        desc.OffsetY = bitmaps[i].Top;
+        desc.Advance = desc.Width + 1;
+
+        rects[i].Width = bitmaps[i].Width + padding;
+        rects[i].Height = bitmaps[i].Height + padding;
+    }
+
+    if (!RectPacker::PackPow2(rects, 1, maxTexSize, page.TexWidth, page.TexHeight))
+        return false;
+
+    page.Texels.assign(page.TexWidth * page.TexHeight, 0x00FFFFFF);
+    for (uint32_t i = 0; i < numChars; ++i)
+    {
+        const GlyphBitmap& bitmap = bitmaps[i];
+        for (uint32_t y = 0; y < bitmap.Height; ++y)
+        {
+            uint32_t* dst = &page.Texels[(rects[i].Y + y) * page.TexWidth + rects[i].X];
+            for (uint32_t x = 0; x < bitmap.Width; ++x)
+                dst[x] = (static_cast<uint32_t>(bitmap.Coverage[y * bitmap.Width + x]) << 24) | 0x00FFFFFF;
+        }
+
+        page.Glyphs[i].X = static_cast<float>(rects[i].X);
+        page.Glyphs[i].Y = static_cast<float>(rects[i].Y);
+    }
+
+    // SpriteFont spaces lines out by 1.5x the font's line height
+    page.SpaceWidth = AdvanceWidth(GlyphIndex(' '), fontSize);
+    page.CharHeight = LineHeight(fontSize) * 1.5f;
+
+    return true;
+}
+
+}
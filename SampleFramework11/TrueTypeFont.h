@@ -0,0 +1,123 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+// This header doesn't use the precompiled header, so that it can be shared by
+// the code that also builds outside of Windows
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SampleFramework11
+{
+
+// Reads glyph outlines straight out of a TrueType file, and rasterizes them without
+// going through GDI+. Coverage is computed analytically from the signed area that each
+// outline edge covers in a pixel, so the results are antialiased without supersampling.
+// Only TrueType outlines (the 'glyf' table) are supported, not CFF.
+class TrueTypeFont
+{
+
+public:
+
+    // Metrics laid out the same way as SpriteFont::CharDesc
+    struct GlyphDesc
+    {
+        float X;
+        float Y;
+        float Width;
+        float Height;
+        float OffsetX;
+        float OffsetY;
+        float Advance;
+    };
+
+    // A rasterized glyph, trimmed to its visible pixels. Top is the distance from the
+    // top of the line to the first row, and Advance is the font's own advance width.
+    struct GlyphBitmap
+    {
+        uint32_t Width;
+        uint32_t Height;
+        float Top;
+        float Advance;
+        std::vector<uint8_t> Coverage;
+    };
+
+    // A glyph page for the characters [firstChar, firstChar + numChars). Texels are
+    // B8G8R8A8 white with coverage in alpha, the same as the pages made with GDI+.
+    struct GlyphPage
+    {
+        uint32_t TexWidth;
+        uint32_t TexHeight;
+        float SpaceWidth;
+        float CharHeight;
+        std::vector<GlyphDesc> Glyphs;
+        std::vector<uint32_t> Texels;
+    };
+
+    TrueTypeFont();
+
+    // Both return false if the data isn't a TrueType font that can be read
+    bool LoadFromFile(const char* fileName);
+    bool Load(const uint8_t* fileData, size_t fileSize);
+
+    // Returns 0 (the missing glyph) for characters that aren't in the font
+    uint32_t GlyphIndex(uint32_t character) const;
+
+    // Sizes are em sizes in pixels, which matches GDI+ fonts created with UnitPixel
+    float LineHeight(float fontSize) const;
+    float AdvanceWidth(uint32_t glyphIndex, float fontSize) const;
+    bool RasterizeGlyph(uint32_t glyphIndex, float fontSize, GlyphBitmap& bitmap) const;
+
+    // Rasterizes and packs a range of characters. The glyphs are rasterized in parallel,
+    // and the font can be shared between threads that bake different sizes.
+    bool BakeGlyphPage(float fontSize, uint32_t firstChar, uint32_t numChars, uint32_t padding,
+                       uint32_t maxTexSize, GlyphPage& page) const;
+
+    // Accessors
+    uint32_t NumGlyphs() const { return numGlyphs; };
+    uint32_t UnitsPerEm() const { return unitsPerEm; };
+
+protected:
+
+    struct Point
+    {
+        float X;
+        float Y;
+        bool OnCurve;
+    };
+
+    struct Contour
+    {
+        std::vector<Point> Points;
+    };
+
+    bool FindTable(const char* tag, uint32_t& offset, uint32_t& length) const;
+    bool FindCharacterMap();
+    bool GetGlyphContours(uint32_t glyphIndex, std::vector<Contour>& contours, uint32_t depth) const;
+
+    std::vector<uint8_t> data;
+    uint32_t fontOffset;
+    uint32_t numGlyphs;
+    uint32_t unitsPerEm;
+    uint32_t numHMetrics;
+    bool longLocaOffsets;
+    int32_t ascent;
+    int32_t lineSpacing;
+
+    uint32_t glyfOffset;
+    uint32_t locaOffset;
+    uint32_t hmtxOffset;
+    uint32_t cmapOffset;
+    uint32_t cmapFormat;
+};
+
+}
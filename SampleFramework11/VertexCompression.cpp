@@ -0,0 +1,265 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#include "VertexCompression.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+    #define VERTEX_COMPRESSION_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define VERTEX_COMPRESSION_SSE2 0
+#endif
+
+namespace SampleFramework11
+{
+
+static const float* SourceAttribute(const float* src, uint32_t srcStride, size_t idx)
+{
+    return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(src) + idx * srcStride);
+}
+
+template<typename T> static T* DestAttribute(T* dst, uint32_t dstStride, size_t idx)
+{
+    return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(dst) + idx * dstStride);
+}
+
+static int32_t RoundToInt(float value)
+{
+    return static_cast<int32_t>(std::floor(value + 0.5f));
+}
+
+static void EncodeOctahedralScalar(const float* v, int16_t* dst)
+{
+    float l1 = std::fabs(v[0]) + std::fabs(v[1]) + std::fabs(v[2]);
+    float x = l1 > 0.0f ? v[0] / l1 : 0.0f;
+    float y = l1 > 0.0f ? v[1] / l1 : 0.0f;
+
+    // The lower hemisphere gets folded over the diagonals
+    if (v[2] < 0.0f)
+    {
+        float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    dst[0] = static_cast<int16_t>(RoundToInt(x * 32767.0f));
+    dst[1] = static_cast<int16_t>(RoundToInt(y * 32767.0f));
+}
+
+// Converts the same way as the SSE2 version below: the float is rebiased by multiplying
+// it into the half exponent range, which also handles denormals, and rounded by adding
+// half of the lowest mantissa bit that's kept.
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = bits & 0x80000000;
+    uint32_t absBits = bits ^ sign;
+
+    uint16_t half;
+    if (absBits >= 0x7F800000)
+        half = absBits > 0x7F800000 ? 0x7E00 : 0x7C00;
+    else
+    {
+        uint32_t truncated = absBits & ~0xFFFu;
+        float scaled;
+        memcpy(&scaled, &truncated, sizeof(scaled));
+        scaled *= 1.925929944e-34f;
+
+        uint32_t scaledBits;
+        memcpy(&scaledBits, &scaled, sizeof(scaledBits));
+        scaledBits = scaledBits < (31u << 23) - 0x1000 ? scaledBits : (31u << 23) - 0x1000;
+        half = static_cast<uint16_t>((scaledBits + 0x1000) >> 13);
+    }
+
+    return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+#if VERTEX_COMPRESSION_SSE2
+
+// Packs the low 16 bits of each unsigned 32-bit value, which SSE2 can only do with
+// signed saturation
+static __m128i PackUInt16(__m128i lo, __m128i hi)
+{
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16(-0x8000);
+    __m128i packed = _mm_packs_epi32(_mm_sub_epi32(lo, bias32), _mm_sub_epi32(hi, bias32));
+    return _mm_add_epi16(packed, bias16);
+}
+
+static __m128i FloatToHalfSSE2(__m128 value)
+{
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+    const __m128 roundMask = _mm_castsi128_ps(_mm_set1_epi32(~0xFFF));
+    const __m128i infinity32 = _mm_set1_epi32(0x7F800000);
+    const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(15 << 23));
+    const __m128 clampMax = _mm_castsi128_ps(_mm_set1_epi32((31 << 23) - 0x1000));
+
+    __m128 sign = _mm_and_ps(value, signMask);
+    __m128 absValue = _mm_xor_ps(value, sign);
+    __m128i absBits = _mm_castps_si128(absValue);
+
+    __m128i isNaN = _mm_cmpgt_epi32(absBits, infinity32);
+    __m128i isFinite = _mm_cmpgt_epi32(infinity32, absBits);
+    __m128i infOrNaN = _mm_or_si128(_mm_and_si128(isNaN, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7C00));
+
+    __m128 scaled = _mm_mul_ps(_mm_and_ps(absValue, roundMask), magic);
+    __m128 clamped = _mm_min_ps(scaled, clampMax);
+    __m128i rounded = _mm_sub_epi32(_mm_castps_si128(clamped), _mm_castps_si128(roundMask));
+    __m128i finite = _mm_and_si128(_mm_srli_epi32(rounded, 13), isFinite);
+
+    __m128i half = _mm_or_si128(finite, _mm_andnot_si128(isFinite, infOrNaN));
+    return _mm_or_si128(half, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+}
+
+static void Store32(void* dst, __m128i value)
+{
+    int32_t lane = _mm_cvtsi128_si32(value);
+    memcpy(dst, &lane, sizeof(lane));
+}
+
+#endif
+
+void QuantizePositions(const float* positions, uint32_t srcStride, size_t numVertices,
+                       const float* boxMin, const float* boxMax, uint16_t* dst, uint32_t dstStride)
+{
+    float scale[3];
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        float extent = boxMax[i] - boxMin[i];
+        scale[i] = extent > 0.0f ? 65535.0f / extent : 0.0f;
+    }
+
+#if VERTEX_COMPRESSION_SSE2
+    const __m128 offsetVec = _mm_set_ps(0.0f, boxMin[2], boxMin[1], boxMin[0]);
+    const __m128 scaleVec = _mm_set_ps(0.0f, scale[2], scale[1], scale[0]);
+    const __m128 maxVec = _mm_set1_ps(65535.0f);
+
+    for (size_t i = 0; i < numVertices; ++i)
+    {
+        const float* pos = SourceAttribute(positions, srcStride, i);
+        __m128 p = _mm_set_ps(0.0f, pos[2], pos[1], pos[0]);
+        p = _mm_mul_ps(_mm_sub_ps(p, offsetVec), scaleVec);
+        p = _mm_min_ps(_mm_max_ps(p, _mm_setzero_ps()), maxVec);
+
+        __m128i q = _mm_cvtps_epi32(p);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(DestAttribute(dst, dstStride, i)), PackUInt16(q, q));
+    }
+#else
+    for (size_t i = 0; i < numVertices; ++i)
+    {
+        const float* pos = SourceAttribute(positions, srcStride, i);
+        uint16_t quantized[4] = { 0, 0, 0, 0 };
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            float q = (pos[j] - boxMin[j]) * scale[j];
+            q = q < 0.0f ? 0.0f : (q > 65535.0f ? 65535.0f : q);
+            quantized[j] = static_cast<uint16_t>(RoundToInt(q));
+        }
+        memcpy(DestAttribute(dst, dstStride, i), quantized, sizeof(quantized));
+    }
+#endif
+}
+
+void EncodeOctahedral(const float* vectors, uint32_t srcStride, size_t numVertices,
+                      int16_t* dst, uint32_t dstStride)
+{
+    size_t i = 0;
+
+#if VERTEX_COMPRESSION_SSE2
+    // Four vectors at a time, with one component in each register
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 snormScale = _mm_set1_ps(32767.0f);
+
+    for (; i + 4 <= numVertices; i += 4)
+    {
+        const float* v0 = SourceAttribute(vectors, srcStride, i);
+        const float* v1 = SourceAttribute(vectors, srcStride, i + 1);
+        const float* v2 = SourceAttribute(vectors, srcStride, i + 2);
+        const float* v3 = SourceAttribute(vectors, srcStride, i + 3);
+        __m128 x = _mm_set_ps(v3[0], v2[0], v1[0], v0[0]);
+        __m128 y = _mm_set_ps(v3[1], v2[1], v1[1], v0[1]);
+        __m128 z = _mm_set_ps(v3[2], v2[2], v1[2], v0[2]);
+
+        __m128 absX = _mm_andnot_ps(signMask, x);
+        __m128 absY = _mm_andnot_ps(signMask, y);
+        __m128 absZ = _mm_andnot_ps(signMask, z);
+        __m128 l1 = _mm_add_ps(_mm_add_ps(absX, absY), absZ);
+        __m128 nonZero = _mm_cmpgt_ps(l1, _mm_setzero_ps());
+        __m128 invL1 = _mm_and_ps(_mm_div_ps(one, _mm_max_ps(l1, _mm_set1_ps(1e-30f))), nonZero);
+        x = _mm_mul_ps(x, invL1);
+        y = _mm_mul_ps(y, invL1);
+        absX = _mm_mul_ps(absX, invL1);
+        absY = _mm_mul_ps(absY, invL1);
+
+        // Fold the lower hemisphere, keeping the sign of x and y with +0 counting as positive
+        __m128 signX = _mm_and_ps(x, signMask);
+        __m128 signY = _mm_and_ps(y, signMask);
+        __m128 foldedX = _mm_or_ps(_mm_sub_ps(one, absY), signX);
+        __m128 foldedY = _mm_or_ps(_mm_sub_ps(one, absX), signY);
+        __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+        x = _mm_or_ps(_mm_and_ps(lower, foldedX), _mm_andnot_ps(lower, x));
+        y = _mm_or_ps(_mm_and_ps(lower, foldedY), _mm_andnot_ps(lower, y));
+
+        __m128i xi = _mm_cvtps_epi32(_mm_mul_ps(x, snormScale));
+        __m128i yi = _mm_cvtps_epi32(_mm_mul_ps(y, snormScale));
+        __m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(xi, yi), _mm_unpackhi_epi32(xi, yi));
+
+        Store32(DestAttribute(dst, dstStride, i), packed);
+        Store32(DestAttribute(dst, dstStride, i + 1), _mm_srli_si128(packed, 4));
+        Store32(DestAttribute(dst, dstStride, i + 2), _mm_srli_si128(packed, 8));
+        Store32(DestAttribute(dst, dstStride, i + 3), _mm_srli_si128(packed, 12));
+    }
+#endif
+
+    for (; i < numVertices; ++i)
+    {
+        int16_t encoded[2];
+        EncodeOctahedralScalar(SourceAttribute(vectors, srcStride, i), encoded);
+        memcpy(DestAttribute(dst, dstStride, i), encoded, sizeof(encoded));
+    }
+}
+
+void EncodeHalf2(const float* values, uint32_t srcStride, size_t numVertices,
+                 uint16_t* dst, uint32_t dstStride)
+{
+    size_t i = 0;
+
+#if VERTEX_COMPRESSION_SSE2
+    for (; i + 4 <= numVertices; i += 4)
+    {
+        const float* v0 = SourceAttribute(values, srcStride, i);
+        const float* v1 = SourceAttribute(values, srcStride, i + 1);
+        const float* v2 = SourceAttribute(values, srcStride, i + 2);
+        const float* v3 = SourceAttribute(values, srcStride, i + 3);
+        __m128i lo = FloatToHalfSSE2(_mm_set_ps(v1[1], v1[0], v0[1], v0[0]));
+        __m128i hi = FloatToHalfSSE2(_mm_set_ps(v3[1], v3[0], v2[1], v2[0]));
+        __m128i packed = PackUInt16(lo, hi);
+
+        Store32(DestAttribute(dst, dstStride, i), packed);
+        Store32(DestAttribute(dst, dstStride, i + 1), _mm_srli_si128(packed, 4));
+        Store32(DestAttribute(dst, dstStride, i + 2), _mm_srli_si128(packed, 8));
+        Store32(DestAttribute(dst, dstStride, i + 3), _mm_srli_si128(packed, 12));
+    }
+#endif
+
+    for (; i < numVertices; ++i)
+    {
+        const float* v = SourceAttribute(values, srcStride, i);
+        uint16_t encoded[2] = { FloatToHalf(v[0]), FloatToHalf(v[1]) };
+        memcpy(DestAttribute(dst, dstStride, i), encoded, sizeof(encoded));
+    }
+}
+
+}
@@ -0,0 +1,42 @@
+//======================================================================
+//
+//	MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//======================================================================
+
+#pragma once
+
+// This header doesn't use the precompiled header, so that it can be shared by
+// the code that also builds outside of Windows
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SampleFramework11
+{
+
+// Encoders for compact vertex formats. Each one reads a float attribute from every
+// srcStride bytes and writes the encoded attribute to every dstStride bytes, so that
+// they work directly on interleaved vertices. The source and destination can't overlap.
+// They use SSE2 when it's available. The matching decoders are in Shaders\VertexCompression.hlsl.
+
+// Converts float3 positions to R16G16B16A16_UNORM relative to the bounding box, with
+// w set to 0. Decode with boxMin + value * (boxMax - boxMin).
+void QuantizePositions(const float* positions, uint32_t srcStride, size_t numVertices,
+                       const float* boxMin, const float* boxMax, uint16_t* dst, uint32_t dstStride);
+
+// Converts float3 unit vectors to R16G16_SNORM, using the octahedral mapping from
+// Meyer et al's "On Floating-Point Normal Vectors"
+void EncodeOctahedral(const float* vectors, uint32_t srcStride, size_t numVertices,
+                      int16_t* dst, uint32_t dstStride);
+
+// Converts float2 values to R16G16_FLOAT, rounding to the nearest half
+void EncodeHalf2(const float* values, uint32_t srcStride, size_t numVertices,
+                 uint16_t* dst, uint32_t dstStride);
+
+uint16_t FloatToHalf(float value);
+
+}
@@ -18,6 +18,7 @@
 #include "SampleFramework11/DeviceManager.h"
 #include "SampleFramework11/Input.h"
 #include "SampleFramework11/SpriteRenderer.h"
+#include "SampleFramework11/FontRegistry.h"
 #include "SampleFramework11/Model.h"
 #include "SampleFramework11/Utility.h"
 #include "SampleFramework11/Camera.h"
@@ -80,6 +81,7 @@ void SamplePattern::BeforeReset()
 
 void SamplePattern::AfterReset()
 {
+    CreatePixelGrid();
 }
 
 void SamplePattern::LoadContent()
@@ -89,12 +91,19 @@ void SamplePattern::LoadContent()
 
     // Create a font + SpriteRenderer
     font.Initialize(L"Consolas", 18, SpriteFont::Regular, true, device);
-    smallFont.Initialize(L"Microsoft Sans Serif", 8.5f, SpriteFont::Regular, true, device);
+    font.EnableDynamicGlyphs(device);
+    smallFont = FontRegistry::GetFont(L"Microsoft Sans Serif", 8.5f, SpriteFont::Regular, true, device);
     spriteRenderer.Initialize(device);
 
-    // Load the 1x1 white texture
+    // Load the 1x1 white texture. The sample grid sprites are small enough that their texture
+    // coordinates reach several texels past their rect, so they can't share the atlas.
     DXCall(D3DX11CreateShaderResourceViewFromFile(device, L"Content\\White.png", NULL, NULL, &whiteTexture, NULL));
 
+    // Pack the fonts into one atlas, so that the HUD can be batched
+    uiAtlas.AddFont(font);
+    uiAtlas.AddFont(*smallFont);
+    uiAtlas.Build(device, deviceContext);
+
     // Enumerate MSAA modes
     for (UINT numSamples = 1; numSamples <= D3D11_MAX_MULTISAMPLE_SAMPLE_COUNT; ++numSamples)
     {
@@ -125,6 +134,8 @@ void SamplePattern::LoadContent()
 
     SetupMSAAMode();
 
+    CreateSampleGrid();
+
 #if UseNVAPI_
 	if(NvAPI_Initialize() != NVAPI_OK)
 		return;
@@ -287,6 +298,71 @@ void SamplePattern::SetupMSAAMode()
     DXCall(device->CreateTexture2D(&texDesc, NULL, &stagingTexture));
 }
 
+// Records the grid of sub-pixel sprites used for detecting the sample pattern
+void SamplePattern::CreateSampleGrid()
+{
+    std::vector<SpriteRenderer::SpriteDrawData> sprites;
+    sprites.reserve(4 * SampleRes * SampleRes);
+
+    XMMATRIX scale = XMMatrixScaling(1.0f / SampleRes, 1.0f / SampleRes, 1.0f);
+	for(UINT quadPixelIdx = 0; quadPixelIdx < 4; ++quadPixelIdx)
+	{
+		float quadOffsetX = float(quadPixelIdx % 2);
+		float quadOffsetY = float(quadPixelIdx / 2);
+
+		for (UINT y = 0; y < SampleRes; y++)
+		{
+			for (UINT x = 0; x < SampleRes; x++)
+			{
+				SpriteRenderer::SpriteDrawData sprite;
+				sprite.Transform = scale * XMMatrixTranslation((x - 0.5f) / SampleRes + quadOffsetX, (y - 0.5f) / SampleRes + quadOffsetY, 0);
+				sprite.Color.x = float(x) / SampleRes;
+				sprite.Color.y = float(y) / SampleRes;
+				sprite.Color.z = 1.0f;
+				sprite.Color.w = 1.0f;
+				sprite.DrawRect = XMFLOAT4(0, 0, 1, 1);
+				sprites.push_back(sprite);
+			}
+		}
+	}
+
+    spriteRenderer.CreateStaticList(whiteTexture, &sprites[0], sprites.size(), sampleGridList);
+}
+
+// Records the enlarged quad pixels and their borders, which only change when the back buffer is resized
+void SamplePattern::CreatePixelGrid()
+{
+    std::vector<SpriteRenderer::PrimitiveInstance> primitives;
+
+	for(UINT quadPixelIdx = 0; quadPixelIdx < 4; ++quadPixelIdx)
+	{
+		UINT quadOffsetX = quadPixelIdx % 2;
+		UINT quadOffsetY = quadPixelIdx / 2;
+
+		// Draw a great big pixel
+		float pixelSize = deviceManager.BackBufferHeight() * 0.6f * 0.5f;
+		float pixelDrawY = deviceManager.BackBufferHeight() * 0.035f;
+		float pixelDrawX = (deviceManager.BackBufferWidth() / 2.0f) - (pixelSize);
+		pixelDrawX += pixelSize * quadOffsetX;
+		pixelDrawY += pixelSize * quadOffsetY;
+		primitives.push_back(SpriteRenderer::CreateRect(XMFLOAT2(pixelDrawX, pixelDrawY), XMFLOAT2(pixelSize, pixelSize),
+                                                        XMFLOAT4(0.6f, 0.6f, 0.6f, 1.0f)));
+
+		// Draw pixel borders
+		XMFLOAT4 borderColor = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+		float borderWidth = pixelSize * 0.02f;
+		XMFLOAT2 topLeft(pixelDrawX, pixelDrawY);
+		XMFLOAT2 topRight(pixelDrawX + pixelSize, pixelDrawY);
+		XMFLOAT2 bottomLeft(pixelDrawX, pixelDrawY + pixelSize);
+		primitives.push_back(SpriteRenderer::CreateLine(topLeft, bottomLeft, borderColor, borderWidth));
+		primitives.push_back(SpriteRenderer::CreateLine(topRight, XMFLOAT2(topRight.x, bottomLeft.y), borderColor, borderWidth));
+		primitives.push_back(SpriteRenderer::CreateLine(topLeft, topRight, borderColor, borderWidth));
+		primitives.push_back(SpriteRenderer::CreateLine(bottomLeft, XMFLOAT2(topRight.x, bottomLeft.y), borderColor, borderWidth));
+	}
+
+    spriteRenderer.CreateStaticList(&primitives[0], primitives.size(), pixelGridList);
+}
+
 void SamplePattern::Update(const Timer& timer)
 {
     MouseState mouseState = MouseState::GetMouseState(window);
@@ -351,26 +427,7 @@ void SamplePattern::Render(const Timer& timer)
 	if(rsState != NULL)
 		context->RSSetState(rsState);
 
-    XMMATRIX scale = XMMatrixScaling(1.0f / SampleRes, 1.0f / SampleRes, 1.0f);
-	for(UINT quadPixelIdx = 0; quadPixelIdx < 4; ++quadPixelIdx)
-	{
-		float quadOffsetX = float(quadPixelIdx % 2);
-		float quadOffsetY = float(quadPixelIdx / 2);
-
-		for (UINT y = 0; y < SampleRes; y++)
-		{
-			for (UINT x = 0; x < SampleRes; x++)
-			{
-				XMFLOAT4 color;
-				color.x = float(x) / SampleRes;
-				color.y = float(y) / SampleRes;
-				color.z = 1.0f;
-				color.w = 1.0f;
-				XMMATRIX transform = scale * XMMatrixTranslation((x - 0.5f) / SampleRes + quadOffsetX, (y - 0.5f) / SampleRes + quadOffsetY, 0);
-				spriteRenderer.Render(whiteTexture, transform, color);
-			}
-		}
-	}
+    spriteRenderer.RenderStaticList(sampleGridList);
 
     spriteRenderer.End();
 
@@ -389,6 +446,7 @@ void SamplePattern::Render(const Timer& timer)
     for(UINT i = 0; i < desc.Count; ++i)
     {
 		context->PSSetShader(patternDetectShaders[i], NULL, 0);
+		spriteRenderer.StateChanged();
 		for(UINT quadPixelIdx = 0; quadPixelIdx < 4; ++quadPixelIdx)
 		{
 			patternDetectConstants.Data.PixelPosX = quadPixelIdx % 2;
@@ -433,6 +491,8 @@ void SamplePattern::RenderHUD()
 	for(UINT i = 0; i < 4; ++i)
 		quadPatterns[i] = reinterpret_cast<XMFLOAT2*>(reinterpret_cast<UINT8*>(mapped.pData) + mapped.RowPitch * i);
 
+    font.UpdateDynamicGlyphs(deviceManager.ImmediateContext());
+
     spriteRenderer.Begin(deviceManager.ImmediateContext(), SpriteRenderer::Point);
 
     XMMATRIX transform = XMMatrixTranslation(25.0f, deviceManager.BackBufferHeight() * 0.65f, 0);
@@ -446,7 +506,11 @@ void SamplePattern::RenderHUD()
     else
         quality = L"Q" + ToString(desc.Quality);
     mode += ToString(desc.Count) + L"x, " + quality + L" (Press Up/Down or M/N to switch)";
-    spriteRenderer.RenderText(font, mode.c_str(), transform);
+    // Draw the text with the fonts' copies in the atlas, so that it all goes in one batch
+    const SpriteFont& hudFont = uiAtlas.GetFont(font);
+    const SpriteFont& labelFont = uiAtlas.GetFont(*smallFont);
+
+    spriteRenderer.RenderText(hudFont, mode.c_str(), transform);
     transform._42 += 20.0f;
 
 	if(nvExtensionsAvailable)
@@ -454,7 +518,7 @@ void SamplePattern::RenderHUD()
 		wstring customPoints = L"Use Custom Sample Points: ";
 		customPoints += useCustomSampling ? L"Yes" : L"No";
 		customPoints += L" (Press K to switch)";
-		spriteRenderer.RenderText(font, customPoints.c_str(), transform);
+		spriteRenderer.RenderText(hudFont, customPoints.c_str(), transform);
 		transform._42 += 20.0f;
 	}
 
@@ -487,50 +551,24 @@ void SamplePattern::RenderHUD()
         text += L"X: " + samplePosStrings[samplePosX];
 		text += L" Y: " + samplePosStrings[samplePosY];
 
-        spriteRenderer.RenderText(font, text.c_str(), transform);
+        spriteRenderer.RenderText(hudFont, text.c_str(), transform);
 
         transform._42 += 20.0f;
     }
 
+    // Draw the big pixels and their borders
+    spriteRenderer.RenderStaticList(pixelGridList);
+
 	for(UINT quadPixelIdx = 0; quadPixelIdx < 4; ++quadPixelIdx)
 	{
 		UINT quadOffsetX = quadPixelIdx % 2;
 		UINT quadOffsetY = quadPixelIdx / 2;
 
-		// Draw a great big pixel
 		float pixelSize = deviceManager.BackBufferHeight() * 0.6f * 0.5f;
 		float pixelDrawY = deviceManager.BackBufferHeight() * 0.035f;
 		float pixelDrawX = (deviceManager.BackBufferWidth() / 2.0f) - (pixelSize);
 		pixelDrawX += pixelSize * quadOffsetX;
 		pixelDrawY += pixelSize * quadOffsetY;
-		transform = XMMatrixScaling(pixelSize, pixelSize, 1.0f) * XMMatrixTranslation(pixelDrawX, pixelDrawY, 0);
-		spriteRenderer.Render(whiteTexture, transform, XMFLOAT4(0.6f, 0.6f, 0.6f, 1.0f));
-
-		// Draw pixel borders
-		float borderWidth = pixelSize * 0.02f;
-		float borderHeight = pixelSize;
-		float borderCenterX = pixelDrawX;
-		float borderTopLeftX = borderCenterX - borderWidth * 0.5f;
-		float borderTopLeftY = pixelDrawY;
-		XMMATRIX borderTransform = XMMatrixScaling(borderWidth, borderHeight, 1.0f) * XMMatrixTranslation(borderTopLeftX, borderTopLeftY, 0);
-		spriteRenderer.Render(whiteTexture, borderTransform, XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f));
-
-		borderCenterX += pixelSize;
-		borderTopLeftX = borderCenterX - borderWidth * 0.5f;
-		borderTransform = XMMatrixScaling(borderWidth, borderHeight, 1.0f) * XMMatrixTranslation(borderTopLeftX, borderTopLeftY, 0);
-		spriteRenderer.Render(whiteTexture, borderTransform, XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f));
-
-		std::swap(borderWidth, borderHeight);
-		borderTopLeftX = pixelDrawX;
-		float borderCenterY = pixelDrawY;
-		borderTopLeftY = borderCenterY - borderHeight * 0.5f;
-		borderTransform = XMMatrixScaling(borderWidth, borderHeight, 1.0f) * XMMatrixTranslation(borderTopLeftX, borderTopLeftY, 0);
-		spriteRenderer.Render(whiteTexture, borderTransform, XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f));
-
-		borderCenterY += pixelSize;
-		borderTopLeftY = borderCenterY - borderHeight * 0.5f;
-		borderTransform = XMMatrixScaling(borderWidth, borderHeight, 1.0f) * XMMatrixTranslation(borderTopLeftX, borderTopLeftY, 0);
-		spriteRenderer.Render(whiteTexture, borderTransform, XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f));
 
 		float samplesize = pixelSize / SampleRes;
 		float halfSampleSize = samplesize * 0.5f;
@@ -540,23 +578,25 @@ void SamplePattern::RenderHUD()
 		{
 			float centerPosX = pixelDrawX + (pixelSize * 0.5f) - halfSampleSize;
 			float centerPosY = pixelDrawY + (pixelSize * 0.5f) - halfSampleSize;
-			transform = XMMatrixScaling(samplesize, samplesize, 1.0f) * XMMatrixTranslation(centerPosX, centerPosY, 0);
-			spriteRenderer.Render(whiteTexture, transform, XMFLOAT4(0.9f, 0.9f, 0.2f, 0.5f));
-			transform = XMMatrixTranslation(centerPosX + halfSampleSize, centerPosY + halfSampleSize, 0);
+			spriteRenderer.RenderRect(XMFLOAT2(centerPosX, centerPosY), XMFLOAT2(samplesize, samplesize), XMFLOAT4(0.9f, 0.9f, 0.2f, 0.5f));
 		}
 
-		// Draw the sample points
+		// Draw the sample points, then their labels, so that the points are all drawn together
+		XMFLOAT2 samplePositions[D3D11_MAX_MULTISAMPLE_SAMPLE_COUNT];
 		for (UINT sample = 0; sample < desc.Count; ++sample)
 		{
 			XMFLOAT2 samplePos = quadPatterns[quadPixelIdx][sample];
 			samplePos.x = std::floor(samplePos.x * SampleRes + 0.5f) / SampleRes;
 			samplePos.y = std::floor(samplePos.y * SampleRes + 0.5f) / SampleRes;
-			float samplePosX = pixelDrawX + (pixelSize * samplePos.x) - halfSampleSize;
-			float samplePosY = pixelDrawY + (pixelSize * samplePos.y) - halfSampleSize;
-			transform = XMMatrixScaling(samplesize, samplesize, 1.0f) * XMMatrixTranslation(samplePosX, samplePosY, 0);
-			spriteRenderer.Render(whiteTexture, transform, XMFLOAT4(0.9f, 0.2f, 0.2f, 0.5f));
-			transform = XMMatrixTranslation(samplePosX + halfSampleSize * 0.5f, samplePosY + halfSampleSize * 0.5f, 0);
-			spriteRenderer.RenderText(smallFont, ToString(sample).c_str(), transform, XMFLOAT4(1, 1, 1, 1));
+			samplePositions[sample].x = pixelDrawX + (pixelSize * samplePos.x) - halfSampleSize;
+			samplePositions[sample].y = pixelDrawY + (pixelSize * samplePos.y) - halfSampleSize;
+			spriteRenderer.RenderRect(samplePositions[sample], XMFLOAT2(samplesize, samplesize), XMFLOAT4(0.9f, 0.2f, 0.2f, 0.5f));
+		}
+
+		for (UINT sample = 0; sample < desc.Count; ++sample)
+		{
+			transform = XMMatrixTranslation(samplePositions[sample].x + halfSampleSize * 0.5f, samplePositions[sample].y + halfSampleSize * 0.5f, 0);
+			spriteRenderer.RenderText(labelFont, ToString(sample).c_str(), transform, XMFLOAT4(1, 1, 1, 1));
 		}
 	}
 
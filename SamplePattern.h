@@ -21,6 +21,7 @@
 #include "SampleFramework11/Skybox.h"
 #include "SampleFramework11/GraphicsTypes.h"
 #include "SampleFramework11/Slider.h"
+#include "SampleFramework11/TextureAtlas.h"
 
 using namespace SampleFramework11;
 
@@ -30,14 +31,18 @@ class SamplePattern : public App
 protected:       
 
     SpriteFont font;
-    SpriteFont smallFont;
+    std::shared_ptr<SpriteFont> smallFont;
     SpriteRenderer spriteRenderer;    
 
     RenderTarget2D sampleTarget;    
     RenderTarget2D patternTarget;
     ID3D11Texture2DPtr stagingTexture;
 
+    TextureAtlas uiAtlas;
     ID3D11ShaderResourceViewPtr whiteTexture;
+
+    SpriteRenderer::StaticSpriteList sampleGridList;
+    SpriteRenderer::StaticSpriteList pixelGridList;
     
     UINT currMSAAMode;
     ID3D11PixelShaderPtr patternDetectShaders[D3D11_MAX_MULTISAMPLE_SAMPLE_COUNT];
@@ -65,6 +70,8 @@ protected:
     virtual void AfterReset();
     
     void SetupMSAAMode();
+    void CreateSampleGrid();
+    void CreatePixelGrid();
         
     void RenderHUD();
 